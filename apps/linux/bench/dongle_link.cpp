@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////
+// dongle_link.cpp - blue_keyboard.ino's protocol side, for mtls-bench
+//
+// See dongle_link.h. Everything runs on the caller's thread (the
+// bench's), except the tasks the firmware starts itself (HID emitter,
+// key pool), so the dongle's work per record is measured right there.
+////////////////////////////////////////////////////////////////////
+#include "dongle_link.h"
+#include "commands.h"
+#include "mtls.h"
+#include "tx_queue.h"
+#include <vector>
+
+using namespace std;
+
+extern void mtls_tick();
+extern "C" void mtls_onDisconnect();
+
+// --- what blue_keyboard.ino defines for the other modules ---
+Preferences gPrefs;
+String g_BleName = "BluKeyborg-bench";
+bool g_allowPairing  = true;
+bool g_allowMultiApp = false;
+bool g_allowMultiDev = false;
+uint8_t g_appKey[32] = {0};
+bool    g_appKeySet  = false;
+KeyboardLayout m_nKeyboardLayout = KeyboardLayout::US_WINLIN;
+bool g_rawFastMode = false;
+RawKeyboard Keyboard;
+USBHIDConsumerControl MediaControl;
+
+bool isLinkSecure() { return true; }
+void showLockedNeedsReset() {}
+void onStringTyped(size_t) {}
+
+// notifications of MTU - 3 bytes through the TX queue, as the real
+// sendTX(); the simulated link always has a buffer free
+bool sendTX(const uint8_t* data, size_t len)
+{
+    if (!tx_queue_push(data, len, BENCH_ATT_MTU - 3)) return false;
+
+    size_t n = 0;
+    while (const uint8_t* chunk = tx_queue_peek(n)) {
+        link_notify(chunk, n);
+        tx_queue_pop();
+    }
+    return true;
+}
+
+// --- RX: frames reassembled from the client's writes ---
+static vector<uint8_t> s_in;
+
+// front ring slot, as in protoPass()
+static bool     s_rxHold = false;
+static uint8_t* s_rxCur  = nullptr;
+static size_t   s_rxLeft = 0;
+static uint32_t s_rxUs   = 0;
+static uint16_t s_rxLink = 0;
+
+// frames discarded because their link had dropped
+static uint32_t s_rxStale = 0;
+
+// dispatches held for room in the HID ring
+static uint32_t s_hidHolds = 0;
+
+void dongle_begin(const uint8_t app_key[32])
+{
+    memcpy(g_appKey, app_key, 32);
+    g_appKeySet = true;
+    hid_emitter_begin(&Keyboard, &MediaControl);
+    mtls_keypool_begin();
+}
+
+void dongle_connect()
+{
+    tx_queue_dropLink();
+    s_in.clear();
+    mtls_sendHello_B0();
+}
+
+// as onDisconnect() + the protocol task's session drop; frames still
+// queued are discarded by the next dongle_pump()
+void dongle_disconnect()
+{
+    send_string_dropAcks();
+    rx_credit_dropLink();
+    rx_ring_dropLink();
+    tx_queue_dropLink();
+    mtls_onDisconnect();
+}
+
+bool dongle_write(const uint8_t* data, size_t len)
+{
+    s_in.insert(s_in.end(), data, data + len);
+
+    bool ok = true;
+    size_t off = 0;
+    while (s_in.size() - off >= 3) {
+        const size_t frame_len = 3 + (s_in[off + 1] | (s_in[off + 2] << 8));
+        if (s_in.size() - off < frame_len) break;
+        if (!rx_ring_push(&s_in[off], frame_len)) ok = false;
+        off += frame_len;
+    }
+    s_in.erase(s_in.begin(), s_in.begin() + off);
+    return ok;
+}
+
+bool dongle_pump()
+{
+    hid_setMinGapUs(0);
+    send_string_tick();
+
+    if (s_rxLeft && s_rxLink != rx_ring_link()) {
+        s_rxLeft = 0;
+        if (!s_rxHold) rx_ring_pop();
+    }
+
+    if (s_rxHold && !dispatch_busy()) {
+        s_rxHold = false;
+        if (!s_rxLeft) rx_ring_pop();
+    }
+
+    for (uint8_t i = 0; i < RX_DISPATCH_PER_LOOP && !s_rxHold && !dispatch_busy(); ++i) {
+        if (!s_rxLeft) {
+            size_t len = 0;
+            uint8_t* frame = rx_ring_peek(len, &s_rxUs, &s_rxLink);
+            if (!frame) break;
+            if (s_rxLink != rx_ring_link()) {
+                rx_ring_pop();
+                s_rxStale++;
+                continue;
+            }
+            s_rxCur  = frame;
+            s_rxLeft = len;
+        }
+        dispatch_binary_frame(s_rxCur, s_rxLeft, s_rxUs);
+
+        if (dispatch_busy()) {
+            s_rxHold = true;
+            if (!send_string_busy()) s_hidHolds++;
+        } else if (!s_rxLeft) {
+            rx_ring_pop();
+        }
+    }
+
+    rx_credit_tick();
+    mtls_tick();
+
+    size_t waiting = 0;
+    return s_rxHold || s_rxLeft || rx_ring_peek(waiting) != nullptr;
+}
+
+void dongle_idle(uint32_t ms)
+{
+    host_clockSkip(ms);
+}
+
+void dongle_recStats(uint32_t& records, uint32_t& crypto_us)
+{
+    MtlsRecStats st[MTLS_REC_MODES];
+    mtls_getRecStats(st);
+    records = crypto_us = 0;
+    for (int m = 0; m < MTLS_REC_MODES; ++m) {
+        records   += st[m].records;
+        crypto_us += st[m].cryptoUs;
+    }
+}
+
+void dongle_rxStats(uint32_t& frames, uint32_t& drops, uint32_t& hw, uint32_t& stale)
+{
+    RxRingStats st;
+    rx_ring_getStats(st);
+    frames = st.frames;
+    drops  = st.drops;
+    hw     = st.hwFrames;
+    stale  = s_rxStale;
+}
+
+void dongle_opStats(uint8_t op, uint32_t& calls, uint32_t& total_us)
+{
+    const int i = op_find(op);
+    calls    = i < 0 ? 0 : s_opStats[i].calls;
+    total_us = i < 0 ? 0 : s_opStats[i].totalUs;
+}
+
+void dongle_helloStats(uint32_t& hellos, uint32_t& pool_hits)
+{
+    MtlsHelloStats st;
+    mtls_getHelloStats(st);
+    hellos    = st.hellos;
+    pool_hits = st.poolHits;
+}
+
+void dongle_hidStats(uint32_t& reports, uint32_t& overruns, uint32_t& holds)
+{
+    HidPaceStats st;
+    hid_getPaceStats(st);
+    reports  = st.reports;
+    overruns = st.overruns;
+    holds    = s_hidHolds;
+}
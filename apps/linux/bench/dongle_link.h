@@ -0,0 +1,54 @@
+////////////////////////////////////////////////////////////////////
+// dongle_link.h - the dongle's side of mtls-bench
+//
+// dongle_link.cpp is built with the firmware (blue_keyboard/ through
+// the Arduino shims in bench/shim) and stands in for the parts of
+// blue_keyboard.ino around the protocol: GATT write -> rx_ring,
+// protoPass(), sendTX() -> notifications. Plain types only here, so
+// the CLI side doesn't see any firmware header.
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// ATT MTU of the simulated link (notifications carry MTU - 3 bytes)
+#define BENCH_ATT_MTU 247
+
+// Notification from the dongle, implemented by the CLI side
+void link_notify(const uint8_t* data, size_t len);
+
+// Boot: HID emitter + key pool tasks, APPKEY provisioned
+void dongle_begin(const uint8_t app_key[32]);
+
+// New connection (client subscribed): B0 is scheduled
+void dongle_connect();
+void dongle_disconnect();
+
+// GATT write from the client: frames (possibly split over several
+// writes) go to the RX ring. False if one had to be dropped. May run
+// on another thread than dongle_pump() (the NimBLE host task's place).
+bool dongle_write(const uint8_t* data, size_t len);
+
+// One protocol pass; true while queued frames are left
+bool dongle_pump();
+
+// Nothing to do right now: let the dongle's clock run ahead
+// (scheduled sends, e.g. B2, go out without waiting for real time)
+void dongle_idle(uint32_t ms);
+
+// B3 records (both directions) and their crypto time, all modes
+void dongle_recStats(uint32_t& records, uint32_t& crypto_us);
+
+// RX ring: frames queued, dropped (ring full), most waiting at once,
+// and frames discarded because their link had dropped
+void dongle_rxStats(uint32_t& frames, uint32_t& drops, uint32_t& hw, uint32_t& stale);
+
+// Calls and handler time of one opcode (C5 stats)
+void dongle_opStats(uint8_t op, uint32_t& calls, uint32_t& total_us);
+
+// B0s prepared, and how many of them had a pooled keypair
+void dongle_helloStats(uint32_t& hellos, uint32_t& pool_hits);
+
+// HID reports sent, ops dropped on a full HID ring, and dispatches
+// held back until a frame's reports fit in it (E0 bursts)
+void dongle_hidStats(uint32_t& reports, uint32_t& overruns, uint32_t& holds);
@@ -0,0 +1,768 @@
+////////////////////////////////////////////////////////////////////
+// hid_sim.cpp - the dongle's typing path on Linux, report by report
+//
+// layout_kb_profiles.h (compiled maps, sequence planning,
+// sendUnicodeAware()), RawKeyboard and hid_emitter.cpp's paced send,
+// built through the Arduino shims in bench/shim. The emitter task is
+// not started, so RawKeyboard takes the direct path: same reports,
+// same order, sent right away. The USB shim hands each one to the
+// recorder here on a virtual clock: a report takes a USB frame
+// (HOST_USB_FRAME_US) plus whatever gap the layout's host profile adds
+// (hidMinGapUsFor(), as protoPass() sets it). Nothing really sleeps.
+//
+//   --check=<dir>   type each layout's sample text (printable ASCII,
+//                   TAB/LF, the layout's own map, a few characters that
+//                   need dead keys or OS Unicode input) on all 31
+//                   layouts and compare the report stream with
+//                   <dir>/<LAYOUT>.txt
+//   --update=<dir>  write those files instead (after a deliberate
+//                   change of the typing path; review the diff)
+//   --bench[=<n>]   per layout: the sample text n times (default 20),
+//                   codepoints/s on this CPU, reports per character and
+//                   the simulated typing time
+//   --report        the firmware's per-layout encoding report
+//                   (kbPrintLayoutReport()) for all layouts
+//   --lookup[=<n>]  map lookups/s per layout over the sample text's
+//                   codepoints, n rounds (default 20000): the linear
+//                   scan of the KBMAP_* array sendCodepointMapped() used
+//                   to do against the compiled tables (ascii[] index,
+//                   binary search of ext[]); both must agree
+//   --replay        upper-case / AltGr heavy strings on all layouts,
+//                   typed by the current engine (packed reports,
+//                   modifiers held across runs) and by the old one
+//                   (press + release per chord): reports and modifier
+//                   changes of each. Fails if the new engine sends more
+//                   reports, or changes modifiers other than once per
+//                   run of characters needing the same ones. Then each
+//                   string as a D2/D3/D3/D4 stream through commands.h's
+//                   SEND_STRING job, stopped after the first chunk:
+//                   fails unless all keys are up there and at the end
+//   --decode        type the sample text on every layout (all but the
+//                   characters left to OS Unicode input) and read it
+//                   back from the packed reports the way the host
+//                   does: a key-down is a usage not in the previous
+//                   report, with that report's modifiers, looked up in
+//                   the layout (dead key + letter as one character).
+//                   Fails if the text differs, a report adds more than
+//                   one key, or the key-downs aren't the old engine's;
+//                   prints reports/char, packed and old. Chords two
+//                   characters share (ASCII a layout doesn't map falls
+//                   back to the US key) count as either, and are listed
+////////////////////////////////////////////////////////////////////
+#include "layout_kb_profiles.h"
+
+// the SEND_STRING job (--replay's streamed case); the rest of the
+// command set isn't used here
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "commands.h"
+#pragma GCC diagnostic pop
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// --- what blue_keyboard.ino defines for the typing path ---
+KeyboardLayout m_nKeyboardLayout = KeyboardLayout::US_WINLIN;
+USBHIDConsumerControl MediaControl;
+RawKeyboard Keyboard;
+
+// --- and for the SEND_STRING job: no MTLS, frames to the dongle's
+// client (D1) are kept ---
+static vector<vector<uint8_t>> s_frames;
+
+bool sendTX(const uint8_t* data, size_t len)
+{
+    s_frames.emplace_back(data, data + len);
+    return true;
+}
+bool mtls_isActive() { return false; }
+bool mtls_wrapAndSendFrame_B3(const uint8_t*, const uint8_t*, uint16_t) { return false; }
+void onStringTyped(size_t) {}
+
+// --- recorder ---
+struct SimReport {
+    uint32_t  us;         // virtual time it was handed to USB
+    bool      consumer;
+    uint16_t  usage;      // consumer: usage pressed, 0 = release
+    KeyReport rpt;
+};
+
+static vector<SimReport> s_reports;
+static bool              s_keep = true;    // false: count only (bench)
+static uint32_t          s_count = 0;
+
+static void sim_sink(const KeyReport* rpt, uint16_t usage)
+{
+    s_count++;
+    if (!s_keep) return;
+
+    SimReport r = {};
+    r.us       = micros();
+    r.consumer = (rpt == nullptr);
+    r.usage    = usage;
+    if (rpt) r.rpt = *rpt;
+    s_reports.push_back(r);
+}
+
+// --- layouts ---
+static vector<KeyboardLayout> all_layouts()
+{
+    vector<KeyboardLayout> v;
+    for (uint8_t i = (uint8_t)KeyboardLayout::US_WINLIN; i < (uint8_t)KeyboardLayout::_END_INDEX; ++i) {
+        const KeyboardLayout lay = (KeyboardLayout)i;
+        if (lay == KeyboardLayout::_START_MACS || lay == KeyboardLayout::_START_TV) continue;
+        v.push_back(lay);
+    }
+    return v;
+}
+
+// "LAYOUT_DE_WINLIN" -> "DE_WINLIN"
+static string short_name(KeyboardLayout lay)
+{
+    const string n = layoutName(lay);
+    return n.compare(0, 7, "LAYOUT_") == 0 ? n.substr(7) : n;
+}
+
+static void put_utf8(string& s, uint32_t cp)
+{
+    if (cp < 0x80) {
+        s += (char)cp;
+    } else if (cp < 0x800) {
+        s += (char)(0xC0 | (cp >> 6));
+        s += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        s += (char)(0xE0 | (cp >> 12));
+        s += (char)(0x80 | ((cp >> 6) & 0x3F));
+        s += (char)(0x80 | (cp & 0x3F));
+    } else {
+        s += (char)(0xF0 | (cp >> 18));
+        s += (char)(0x80 | ((cp >> 12) & 0x3F));
+        s += (char)(0x80 | ((cp >> 6) & 0x3F));
+        s += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+// printable ASCII, TAB and LF, the layout's non-ASCII map entries,
+// then characters most layouts have to compose or leave to the OS
+static vector<uint32_t> sample_cps(KeyboardLayout lay)
+{
+    static const uint32_t extra[] = { 0xE9, 0xF1, 0xFC, 0xC7, 0x20AC, 0x2014, 0x1F600 };
+
+    vector<uint32_t> v;
+    for (uint32_t cp = 0x20; cp < 0x7F; ++cp) v.push_back(cp);
+    v.push_back('\t');
+    v.push_back('\n');
+
+    const KbLayoutTables tbl = getLayoutTables(lay);
+    for (uint16_t i = 0; i < tbl.extCount; ++i) v.push_back(tbl.ext[i].cp);
+    for (uint32_t cp : extra) v.push_back(cp);
+    return v;
+}
+
+static string sample_text(KeyboardLayout lay, uint32_t& cps)
+{
+    const vector<uint32_t> v = sample_cps(lay);
+    string s;
+    for (uint32_t cp : v) put_utf8(s, cp);
+    cps = static_cast<uint32_t>(v.size());
+    return s;
+}
+
+// the engine before report packing and modifier holding: every chord
+// pressed and released on its own (sendRaw()), whole-report sequences
+// (Alt+numpad, Option+hex) as they are
+static void send_unpacked(const char* s)
+{
+    uint32_t cp;
+    while (*s && utf8NextCodepoint(s, cp)) {
+        KbSeq seq;
+        if (kbPlanCodepoint(m_nKeyboardLayout, cp, seq) == KB_PATH_NONE) continue;
+        if (seq.raw) {
+            kbSeqEmit(Keyboard, seq);
+            continue;
+        }
+        for (uint8_t i = 0; i < seq.n; ++i) Keyboard.sendRaw(seq.step[i].mods, seq.step[i].usage);
+    }
+}
+
+// type text on a layout from all keys up; the reports land in s_reports.
+// Returns the simulated typing time, t0 is when it started.
+static uint32_t type_on(KeyboardLayout lay, const string& text, uint32_t& t0, bool unpacked = false)
+{
+    m_nKeyboardLayout = lay;
+    hid_setMinGapUs(hidMinGapUsFor(lay));
+
+    // idle in between, so the first report doesn't wait out a gap
+    delay(1000);
+    t0 = micros();
+    if (unpacked) send_unpacked(text.c_str());
+    else sendUnicodeAware(Keyboard, text.c_str());
+    return micros() - t0;
+}
+
+// --- golden files ---
+//   # <LAYOUT>: <n> codepoints, <n> reports, <us> us
+//   <us> <mods> [<key> ...]   keyboard report, keys up to the last one set
+//   <us> cc <usage>           consumer control, 0000 = release
+// times are from the start of the text, values hex
+static string format_reports(KeyboardLayout lay, uint32_t cps, uint32_t us, uint32_t t0)
+{
+    ostringstream o;
+    char line[64];
+    o << "# " << short_name(lay) << ": " << cps << " codepoints, " << s_reports.size()
+      << " reports, " << us << " us\n";
+    for (const SimReport& r : s_reports) {
+        if (r.consumer) {
+            snprintf(line, sizeof line, "%u cc %04x\n", r.us - t0, r.usage);
+            o << line;
+            continue;
+        }
+        int n = 6;
+        while (n && !r.rpt.keys[n - 1]) --n;
+        snprintf(line, sizeof line, "%u %02x", r.us - t0, r.rpt.modifiers);
+        o << line;
+        for (int k = 0; k < n; ++k) {
+            snprintf(line, sizeof line, " %02x", r.rpt.keys[k]);
+            o << line;
+        }
+        o << "\n";
+    }
+    return o.str();
+}
+
+static bool read_file(const string& path, string& out)
+{
+    ifstream f(path);
+    if (!f) return false;
+    ostringstream o;
+    o << f.rdbuf();
+    out = o.str();
+    return true;
+}
+
+// first line where a and b differ (1-based), 0 if they are the same
+static size_t first_diff(const string& a, const string& b, string& la, string& lb)
+{
+    istringstream sa(a), sb(b);
+    for (size_t n = 1;; ++n) {
+        const bool ea = !getline(sa, la), eb = !getline(sb, lb);
+        if (ea && eb) return 0;
+        if (ea) la = "<end>";
+        if (eb) lb = "<end>";
+        if (ea || eb || la != lb) return n;
+    }
+}
+
+static int run_golden(const string& dir, bool update)
+{
+    int fails = 0;
+    for (KeyboardLayout lay : all_layouts()) {
+        uint32_t cps;
+        const string text = sample_text(lay, cps);
+
+        s_reports.clear();
+        uint32_t t0;
+        const uint32_t us = type_on(lay, text, t0);
+        const string got = format_reports(lay, cps, us, t0);
+        const string path = dir + "/" + short_name(lay) + ".txt";
+
+        printf("  %-14s %4u cp  %5zu reports  %5.2f reports/char  %8.1f ms",
+               short_name(lay).c_str(), cps, s_reports.size(),
+               static_cast<double>(s_reports.size()) / cps, us / 1000.0);
+
+        if (update) {
+            ofstream f(path);
+            f << got;
+            printf("  %s\n", f ? "written" : "WRITE FAILED");
+            if (!f) fails++;
+            continue;
+        }
+
+        string want, la, lb;
+        if (!read_file(path, want)) {
+            printf("  MISSING %s\n", path.c_str());
+            fails++;
+            continue;
+        }
+        const size_t line = first_diff(want, got, la, lb);
+        if (!line) {
+            printf("  ok\n");
+            continue;
+        }
+        printf("  DIFFERS at line %zu\n    want: %s\n    got:  %s\n", line, la.c_str(), lb.c_str());
+        fails++;
+    }
+    return fails;
+}
+
+// --- throughput ---
+static void run_bench(int n)
+{
+    printf("  %-14s %8s %12s %13s %12s %12s\n", "layout", "cp", "cp/s (cpu)", "reports/char",
+           "typing (s)", "chars/s");
+
+    s_keep = false;
+    for (KeyboardLayout lay : all_layouts()) {
+        uint32_t cps;
+        const string one = sample_text(lay, cps);
+        string text;
+        for (int i = 0; i < n; ++i) text += one;
+        cps *= n;
+
+        s_count = 0;
+        uint32_t t0;
+        const auto c0 = chrono::steady_clock::now();
+        const uint32_t us = type_on(lay, text, t0);
+        const double cpu = chrono::duration<double>(chrono::steady_clock::now() - c0).count();
+
+        printf("  %-14s %8u %12.0f %13.2f %12.2f %12.1f\n", short_name(lay).c_str(), cps,
+               cpu > 0 ? cps / cpu : 0.0, static_cast<double>(s_count) / cps, us / 1e6,
+               us ? cps * 1e6 / us : 0.0);
+    }
+    s_keep = true;
+}
+
+// --- map lookup: old linear scan vs compiled tables ---
+// the chord a codepoint maps to, key1 == 0 if it has no map entry
+// (ASCII falls back to the US base map, as kb.write() did)
+static KbChord lookup_scan(KeyboardLayout lay, uint32_t cp)
+{
+    uint16_t n = 0;
+    const KbMapEntry* map = getLayoutMap(lay, n);
+    for (uint16_t i = 0; map && i < n; ++i) {
+        if (map[i].cp == cp) return { map[i].mods1, map[i].key1, map[i].mods2, map[i].key2 };
+    }
+    if (cp < 128) {
+        const uint8_t u = KB_US_ASCII[cp];
+        return { (uint8_t)((u & KB_US_SHIFT) ? MOD_SHIFT : 0), (uint8_t)(u & 0x7F), 0, 0 };
+    }
+    return {};
+}
+
+static KbChord lookup_tables(KeyboardLayout lay, uint32_t cp)
+{
+    const KbLayoutTables tbl = getLayoutTables(lay);
+    if (cp < 128) return tbl.ascii[cp];
+    if (const KbMapEntry* e = kbFindExt(tbl, cp)) return { e->mods1, e->key1, e->mods2, e->key2 };
+    return {};
+}
+
+static bool same_chord(const KbChord& a, const KbChord& b)
+{
+    return a.mods1 == b.mods1 && a.key1 == b.key1 && a.mods2 == b.mods2 && a.key2 == b.key2;
+}
+
+// keeps the lookups from being optimized away
+static volatile uint32_t s_lookupSink;
+
+template <typename F>
+static double lookups_per_s(KeyboardLayout lay, const vector<uint32_t>& cps, int rounds, F fn)
+{
+    uint32_t sum = 0;
+    const auto t0 = chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (uint32_t cp : cps) {
+            const KbChord c = fn(lay, cp);
+            sum += c.key1 + c.key2;
+        }
+    }
+    const double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+    s_lookupSink = sum;
+    return s > 0 ? static_cast<double>(cps.size()) * rounds / s : 0.0;
+}
+
+static int run_lookup(int rounds)
+{
+    printf("  %-14s %7s %14s %14s %8s\n", "layout", "entries", "scan/s", "tables/s", "speedup");
+
+    int fails = 0;
+    for (KeyboardLayout lay : all_layouts()) {
+        const vector<uint32_t> cps = sample_cps(lay);
+
+        // TR's unconfigured placeholders (key1 == 0) are skipped by the
+        // tables on purpose, so the fallback path types those
+        uint32_t diff = 0;
+        for (uint32_t cp : cps) {
+            const KbChord old = lookup_scan(lay, cp);
+            if (old.key1 && !same_chord(old, lookup_tables(lay, cp))) diff++;
+        }
+
+        uint16_t n = 0;
+        getLayoutMap(lay, n);
+        const double scan = lookups_per_s(lay, cps, rounds, lookup_scan);
+        const double tbl  = lookups_per_s(lay, cps, rounds, lookup_tables);
+        printf("  %-14s %7u %14.0f %14.0f %7.1fx%s\n", short_name(lay).c_str(), n, scan, tbl,
+               scan > 0 ? tbl / scan : 0.0, diff ? "  MISMATCH" : "");
+        if (diff) fails++;
+    }
+    return fails;
+}
+
+// --- replay: modifier runs ---
+static const char* const k_replayTexts[] = {
+    "PASSWORD",
+    "HELLO WORLD FROM THE DONGLE",
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ",
+    "CamelCaseIdentifierName",
+    "Tr0ub4dor&3!CORRECT-HORSE",
+    "!@#$%^&*()_+{}|:\"<>?",
+    "user@example.com [{a}] \\share\\DIR",
+};
+
+// modifier byte changes in the recorded keyboard reports
+static uint32_t mod_changes()
+{
+    uint32_t n = 0;
+    uint8_t mods = 0;
+    for (const SimReport& r : s_reports) {
+        if (r.consumer || r.rpt.modifiers == mods) continue;
+        mods = r.rpt.modifiers;
+        n++;
+    }
+    return n;
+}
+
+// changes the packed engine should make: one per run of keys needing
+// the same modifiers (and the final release); -1 if a codepoint needs
+// a whole-report sequence, which isn't packed
+static int mod_runs(KeyboardLayout lay, const char* s)
+{
+    int n = 0;
+    uint8_t mods = 0;
+    uint32_t cp;
+    while (*s && utf8NextCodepoint(s, cp)) {
+        KbSeq seq;
+        if (kbPlanCodepoint(lay, cp, seq) == KB_PATH_NONE) continue;
+        if (seq.raw) return -1;
+        for (uint8_t i = 0; i < seq.n; ++i) {
+            if (seq.step[i].mods != mods) n++;
+            mods = seq.step[i].mods;
+        }
+    }
+    return n + (mods ? 1 : 0);
+}
+
+// last keyboard report has nothing pressed
+static bool keys_up()
+{
+    for (auto it = s_reports.rbegin(); it != s_reports.rend(); ++it) {
+        if (it->consumer) continue;
+        if (it->rpt.modifiers) return false;
+        for (uint8_t k : it->rpt.keys) {
+            if (k) return false;
+        }
+        return true;
+    }
+    return true;
+}
+
+// text through commands.h's SEND_STRING job as D2, a D3 with its first
+// half, then (after a pause, as when the next chunk is late) a D3 with
+// the rest and D4. upMid/upEnd: all keys up at the pause / the end;
+// false if the job refused a frame or no D1 came back.
+static bool type_streamed(KeyboardLayout lay, const string& text, bool& upMid, bool& upEnd)
+{
+    m_nKeyboardLayout = lay;
+    hid_setMinGapUs(hidMinGapUsFor(lay));
+    delay(1000);
+    s_frames.clear();
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(text.data());
+    const uint16_t half = static_cast<uint16_t>(text.size() / 2);
+    bool ok = send_string_open() && send_string_append(p, half);
+    while (send_string_busy()) send_string_tick();
+    upMid = keys_up();
+
+    ok = ok && send_string_append(p + half, static_cast<uint16_t>(text.size() - half)) &&
+         send_string_close();
+    while (send_string_busy()) send_string_tick();
+    send_string_tick();
+    upEnd = keys_up();
+
+    for (const auto& f : s_frames) {
+        if (f.size() > 3 && f[0] == 0xD1 && f[3] == 0) return ok;
+    }
+    return false;
+}
+
+static int run_replay()
+{
+    printf("  %-40s %8s %8s %7s %10s %10s\n", "text (all layouts)", "old rpt", "new rpt", "saved",
+           "old mods", "new mods");
+
+    int fails = 0;
+    for (const char* text : k_replayTexts) {
+        uint32_t oldRpt = 0, newRpt = 0, oldMods = 0, newMods = 0;
+        for (KeyboardLayout lay : all_layouts()) {
+            uint32_t t0;
+            s_reports.clear();
+            type_on(lay, text, t0, true);
+            const uint32_t o = static_cast<uint32_t>(s_reports.size());
+            oldRpt += o;
+            oldMods += mod_changes();
+
+            s_reports.clear();
+            type_on(lay, text, t0);
+            const uint32_t n = static_cast<uint32_t>(s_reports.size());
+            const uint32_t m = mod_changes();
+            newRpt += n;
+            newMods += m;
+
+            const int runs = mod_runs(lay, text);
+            if (n > o || (runs >= 0 && m != static_cast<uint32_t>(runs))) {
+                printf("  %s on %s: %u -> %u reports, %u modifier changes, expected %d\n", text,
+                       short_name(lay).c_str(), o, n, m, runs);
+                fails++;
+            }
+        }
+        printf("  %-40s %8u %8u %6.1f%% %10u %10u\n", text, oldRpt, newRpt,
+               oldRpt ? 100.0 * (oldRpt - newRpt) / oldRpt : 0.0, oldMods, newMods);
+    }
+
+    // streamed, stopped half way: nothing may stay pressed while the
+    // next chunk is on its way
+    uint32_t runs = 0, held = 0;
+    for (const char* text : k_replayTexts) {
+        for (KeyboardLayout lay : all_layouts()) {
+            bool upMid, upEnd;
+            const bool ok = type_streamed(lay, text, upMid, upEnd);
+            runs++;
+            if (ok && upMid && upEnd) continue;
+            printf("  %s on %s, streamed: %s\n", text, short_name(lay).c_str(),
+                   !ok ? "no D1" : !upMid ? "keys down after the first chunk" : "keys down at the end");
+            held++;
+            fails++;
+        }
+    }
+    printf("  streamed in two chunks: %u runs, %u with keys left down\n", runs, held);
+    return fails;
+}
+
+// --- decode: what the host types from the packed reports ---
+typedef uint16_t Chord;   // mods << 8 | usage
+
+static Chord chord(uint8_t mods, uint8_t usage) { return (Chord)(mods << 8 | usage); }
+
+struct HostLayout {
+    map<Chord, vector<uint32_t>>              one;    // chord -> character(s)
+    map<pair<Chord, Chord>, vector<uint32_t>> two;    // dead key, then chord
+    map<Chord, bool>                          dead;   // chords that start a pair
+};
+
+static void host_add(HostLayout& h, uint32_t cp, uint8_t m1, uint8_t k1, uint8_t m2, uint8_t k2)
+{
+    if (!k1) return;
+    if (!k2) {
+        h.one[chord(m1, k1)].push_back(cp);
+        return;
+    }
+    h.two[make_pair(chord(m1, k1), chord(m2, k2))].push_back(cp);
+    h.dead[chord(m1, k1)] = true;
+}
+
+// characters sharing a chord, as "U+0021/U+0031" ("/dead" when the
+// chord also starts a dead-key pair)
+static string shared_chords(const HostLayout& h)
+{
+    string s;
+    char buf[16];
+    for (const auto& c : h.one) {
+        const bool dead = h.dead.count(c.first) != 0;
+        if (c.second.size() < 2 && !dead) continue;
+        if (!s.empty()) s += " ";
+        for (size_t i = 0; i < c.second.size(); ++i) {
+            snprintf(buf, sizeof buf, "%sU+%04X", i ? "/" : "", c.second[i]);
+            s += buf;
+        }
+        if (dead) s += "/dead";
+    }
+    return s;
+}
+
+// the layout as the host sees it: its map, the US base for the rest of
+// ASCII, and the dead-key compositions the firmware plans with
+static HostLayout host_layout(KeyboardLayout lay)
+{
+    HostLayout h;
+    const KbLayoutTables tbl = getLayoutTables(lay);
+    for (uint32_t cp = 1; cp < 128; ++cp) {
+        const KbChord& c = tbl.ascii[cp];
+        host_add(h, cp, c.mods1, c.key1, c.mods2, c.key2);
+    }
+    for (uint16_t i = 0; i < tbl.extCount; ++i) {
+        const KbMapEntry& e = tbl.ext[i];
+        host_add(h, e.cp, e.mods1, e.key1, e.mods2, e.key2);
+    }
+    for (const KbCompose& c : KB_COMPOSE) {
+        KbSeq seq;
+        if (kbPlanCodepoint(lay, c.cp, seq) != KB_PATH_DEADKEY) continue;
+        host_add(h, c.cp, seq.step[0].mods, seq.step[0].usage, seq.step[1].mods, seq.step[1].usage);
+    }
+    return h;
+}
+
+// key-downs in s_reports; false if a report adds more than one key
+static bool key_downs(vector<Chord>& out)
+{
+    KeyReport prev = {};
+    for (const SimReport& r : s_reports) {
+        if (r.consumer) continue;
+        int added = 0;
+        for (uint8_t k : r.rpt.keys) {
+            if (!k) continue;
+            bool held = false;
+            for (uint8_t p : prev.keys) held |= (p == k);
+            if (held) continue;
+            out.push_back(chord(r.rpt.modifiers, k));
+            added++;
+        }
+        if (added > 1) return false;
+        prev = r.rpt;
+    }
+    return true;
+}
+
+static bool has(const vector<uint32_t>& v, uint32_t cp)
+{
+    return find(v.begin(), v.end(), cp) != v.end();
+}
+
+// Reads the key-downs back against want; a shared chord may be either
+// character, a chord that is also a dead key either one key or the
+// first of two. Returns how many characters matched.
+static size_t host_read(const HostLayout& h, const vector<Chord>& downs,
+                        const vector<uint32_t>& want)
+{
+    size_t i = 0, c = 0;
+    while (c < want.size() && i < downs.size()) {
+        auto one = h.one.find(downs[i]);
+        if (one != h.one.end() && has(one->second, want[c])) {
+            ++i, ++c;
+            continue;
+        }
+        if (i + 1 < downs.size()) {
+            auto two = h.two.find(make_pair(downs[i], downs[i + 1]));
+            if (two != h.two.end() && has(two->second, want[c])) {
+                i += 2, ++c;
+                continue;
+            }
+        }
+        return c;
+    }
+    // keys left over: the last character didn't come out alone
+    return (i == downs.size() || c == 0) ? c : c - 1;
+}
+
+static int run_decode()
+{
+    printf("  %-14s %5s %8s %8s %13s %13s\n", "layout", "cp", "reports", "old", "reports/char",
+           "old rpt/char");
+
+    int fails = 0;
+    for (KeyboardLayout lay : all_layouts()) {
+        vector<uint32_t> want;
+        string text;
+        for (uint32_t cp : sample_cps(lay)) {
+            KbSeq seq;
+            const uint8_t path = kbPlanCodepoint(lay, cp, seq);
+            if (path == KB_PATH_NONE || path == KB_PATH_OS) continue;
+            want.push_back(cp);
+            put_utf8(text, cp);
+        }
+
+        uint32_t t0;
+        vector<Chord> oldDowns, downs;
+        s_reports.clear();
+        type_on(lay, text, t0, true);
+        const size_t old = s_reports.size();
+        key_downs(oldDowns);
+
+        s_reports.clear();
+        type_on(lay, text, t0);
+        const bool oneKey = key_downs(downs);
+        const HostLayout host = host_layout(lay);
+
+        printf("  %-14s %5zu %8zu %8zu %13.2f %13.2f", short_name(lay).c_str(), want.size(),
+               s_reports.size(), old, static_cast<double>(s_reports.size()) / want.size(),
+               static_cast<double>(old) / want.size());
+        if (!oneKey) {
+            printf("  SEVERAL KEYS IN ONE REPORT\n");
+            fails++;
+            continue;
+        }
+        if (downs != oldDowns) {
+            printf("  KEY-DOWNS DIFFER FROM THE OLD ENGINE\n");
+            fails++;
+            continue;
+        }
+        const size_t i = host_read(host, downs, want);
+        if (i == want.size()) {
+            const string shared = shared_chords(host);
+            printf("  ok\n");
+            if (!shared.empty()) printf("    shared chords: %s\n", shared.c_str());
+            continue;
+        }
+        printf("  DIFFERS at char %zu: U+%04X\n", i, i < want.size() ? want[i] : 0);
+        fails++;
+    }
+    return fails;
+}
+
+static void usage(const char* prog)
+{
+    fprintf(stderr, "Usage: %s --check=<dir> | --update=<dir> | --bench[=<n>] | --report"
+                    " | --lookup[=<n>] | --replay | --decode\n", prog);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    const string a = argv[1];
+    const size_t eq = a.find('=');
+    const string key = a.substr(0, eq);
+    const string val = (eq == string::npos) ? "" : a.substr(eq + 1);
+
+    host_clockVirtual();
+    host_hidSink(sim_sink);
+
+    if ((key == "--check" || key == "--update") && !val.empty()) {
+        const int fails = run_golden(val, key == "--update");
+        printf("%s\n", fails ? "FAILED" : "OK");
+        return fails ? 1 : 0;
+    }
+    if (key == "--bench") {
+        run_bench(val.empty() ? 20 : max(1, atoi(val.c_str())));
+        return 0;
+    }
+    if (key == "--lookup") {
+        const int fails = run_lookup(val.empty() ? 20000 : max(1, atoi(val.c_str())));
+        printf("%s\n", fails ? "FAILED" : "OK");
+        return fails ? 1 : 0;
+    }
+    if (key == "--replay") {
+        const int fails = run_replay();
+        printf("%s\n", fails ? "FAILED" : "OK");
+        return fails ? 1 : 0;
+    }
+    if (key == "--decode") {
+        const int fails = run_decode();
+        printf("%s\n", fails ? "FAILED" : "OK");
+        return fails ? 1 : 0;
+    }
+    if (key == "--report") {
+        for (KeyboardLayout lay : all_layouts()) kbPrintLayoutReport(Serial, lay);
+        return 0;
+    }
+    usage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,519 @@
+////////////////////////////////////////////////////////////////////
+// mtls_bench.cpp - dongle MTLS against the CLI's, in one process
+//
+// The dongle side is blue_keyboard/mtls.cpp (+ commands.h dispatch)
+// on upstream mbedTLS, the client side is BluKeySession on OpenSSL.
+// BleTransport is replaced by a loopback to dongle_link.cpp: writes go
+// straight into the dongle's RX ring and its protocol pass runs on
+// this thread, its notifications come back through link_notify(). So
+// every B0..B3 byte goes through both implementations and any
+// disagreement between them fails the run.
+//
+// Reports per record mode:
+//   - handshake latency, full (B0/B1/B2 + ticket) and resumed (B6/B7);
+//     the dongle's scheduled delays are skipped, not waited out
+//   - B3 records/s for C1/C2 round trips and for a streamed string
+//   - heap allocations per record on each side (glibc malloc counted
+//     on this thread, so the key pool / HID tasks don't show up)
+//   - RX stress: C1 records written from a second thread (the NimBLE
+//     host task's place) faster than this one can dispatch them.
+//     Every record must either be dropped and counted or dispatched
+//     and answered; then records left queued at a link drop must be
+//     discarded, not reach the next session
+//   - E0 burst: records of raw taps that queue several times what the
+//     HID ring holds. The protocol pass must hold them back until they
+//     fit, never wait on the emitter or drop a report
+////////////////////////////////////////////////////////////////////
+#include "ble_proto.h"
+#include "dongle_link.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+// --- allocation counting ---
+enum { SIDE_CLI = 0, SIDE_DONGLE = 1 };
+
+static thread_local int      t_side = SIDE_CLI;
+static thread_local bool     t_count = false;
+static thread_local uint64_t t_allocs[2];
+static thread_local uint64_t t_side_us[2];
+
+extern "C" {
+void* __libc_malloc(size_t n);
+void* __libc_calloc(size_t k, size_t n);
+void* __libc_realloc(void* p, size_t n);
+void  __libc_free(void* p);
+
+void* malloc(size_t n)
+{
+    if (t_count) t_allocs[t_side]++;
+    return __libc_malloc(n);
+}
+void* calloc(size_t k, size_t n)
+{
+    if (t_count) t_allocs[t_side]++;
+    return __libc_calloc(k, n);
+}
+void* realloc(void* p, size_t n)
+{
+    if (t_count) t_allocs[t_side]++;
+    return __libc_realloc(p, n);
+}
+void free(void* p)
+{
+    __libc_free(p);
+}
+}
+
+static uint64_t now_us() {
+    using namespace std::chrono;
+    return static_cast<uint64_t>(
+        duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+// code run for the dongle: allocations and time go to its side
+struct DongleSide {
+    int      prev;
+    uint64_t t0;
+    DongleSide() : prev(t_side), t0(now_us()) { t_side = SIDE_DONGLE; }
+    ~DongleSide() {
+        t_side = prev;
+        if (prev != SIDE_DONGLE) t_side_us[SIDE_DONGLE] += now_us() - t0;
+    }
+};
+
+// --- loopback link ---
+static deque<vector<uint8_t>> s_notes;
+static bool     s_skip_idle = false;   // handshakes: don't wait for the dongle's timers
+static uint64_t s_idle_us   = 0;
+
+void link_notify(const uint8_t* data, size_t len) {
+    // only ever called from dongle_pump(), i.e. this thread
+    s_notes.emplace_back(data, data + len);
+}
+
+struct BleTransport::Impl {};
+
+BleTransport::BleTransport() : m_impl(nullptr) {}
+BleTransport::~BleTransport() {}
+
+vector<BleDeviceInfo> BleTransport::scan(int) { return {}; }
+
+bool BleTransport::connect(const string&, bool, const string&, const string&, const string&) {
+    s_notes.clear();
+    DongleSide d;
+    dongle_connect();
+    return true;
+}
+
+void BleTransport::disconnect() {
+    DongleSide d;
+    dongle_disconnect();
+}
+
+bool BleTransport::write_tx(const vector<uint8_t>& data, bool) {
+    DongleSide d;
+    const bool ok = dongle_write(data.data(), data.size());
+    dongle_pump();
+    if (!ok) cerr << "dongle RX ring full, frame dropped\n";
+    return ok;
+}
+
+uint16_t BleTransport::att_mtu() { return BENCH_ATT_MTU; }
+
+optional<vector<uint8_t>> BleTransport::wait_notification(int timeout_ms) {
+    const uint64_t until = now_us() + static_cast<uint64_t>(timeout_ms) * 1000;
+    for (;;) {
+        if (!s_notes.empty()) {
+            auto v = std::move(s_notes.front());
+            s_notes.pop_front();
+            return v;
+        }
+        bool busy;
+        {
+            DongleSide d;
+            busy = dongle_pump();
+        }
+        if (!s_notes.empty() || busy) continue;
+        if (now_us() >= until) return nullopt;
+
+        // nothing queued: a scheduled send or the HID task typing
+        const uint64_t t0 = now_us();
+        if (s_skip_idle) dongle_idle(1);
+        else this_thread::sleep_for(chrono::microseconds(50));
+        s_idle_us += now_us() - t0;
+    }
+}
+
+bool BleTransport::ensure_cli_agent() { return true; }
+string BleTransport::get_device_path() const { return ""; }
+string BleTransport::get_tx_char_path() const { return ""; }
+string BleTransport::get_rx_char_path() const { return ""; }
+
+// --- bench ---
+static const string k_mac = "B1:0E:00:00:00:01";
+
+struct Sample {
+    uint64_t wall_us = 0;
+    uint64_t side_us[2] = {0, 0};
+    uint64_t allocs[2] = {0, 0};
+    uint32_t records = 0;
+    uint32_t dongle_crypto_us = 0;
+};
+
+// measures everything between begin() and end()
+struct Meter {
+    Sample   s;
+    uint64_t t0 = 0, idle0 = 0;
+    uint32_t rec0 = 0, cus0 = 0;
+
+    void begin() {
+        t_allocs[0] = t_allocs[1] = 0;
+        t_side_us[SIDE_DONGLE] = 0;
+        idle0 = s_idle_us;
+        dongle_recStats(rec0, cus0);
+        t0 = now_us();
+        t_count = true;
+    }
+    void end() {
+        t_count = false;
+        s.wall_us = now_us() - t0;
+        uint32_t rec, cus;
+        dongle_recStats(rec, cus);
+        s.records          = rec - rec0;
+        s.dongle_crypto_us = cus - cus0;
+        s.side_us[SIDE_DONGLE] = t_side_us[SIDE_DONGLE];
+        const uint64_t idle = s_idle_us - idle0;
+        s.side_us[SIDE_CLI] = s.wall_us - min(s.wall_us, s.side_us[SIDE_DONGLE] + idle);
+        s.allocs[SIDE_CLI]    = t_allocs[SIDE_CLI];
+        s.allocs[SIDE_DONGLE] = t_allocs[SIDE_DONGLE];
+    }
+};
+
+// the CLI's stdout chatter ("MTLS session established ...") off
+struct Quiet {
+    streambuf* old;
+    ostringstream sink;
+    Quiet() : old(cout.rdbuf(sink.rdbuf())) {}
+    ~Quiet() { cout.rdbuf(old); }
+};
+
+struct MtlsBench {
+    static bool handshake(BluKeySession& s) {
+        Quiet q;
+        vector<uint8_t> b0;
+        s_skip_idle = true;
+        const bool ok = s.connect_and_wait_b0(k_mac, &b0, false) &&
+                        s.do_mtls_handshake_from_b0(k_mac, b0);
+        s_skip_idle = false;
+        return ok;
+    }
+
+    static void disconnect(BluKeySession& s) {
+        s.m_ble.disconnect();
+        s.m_mtls_ready = false;
+    }
+
+    static void drop_ticket(BluKeySession& s) {
+        s.m_ini.set(k_mac, "ticket_id", "");
+        s.m_ini.save();
+    }
+
+    static bool info(BluKeySession& s) {
+        string layout;
+        return s.send_get_info_layout(layout);
+    }
+
+    static bool type(BluKeySession& s, const string& text) {
+        return s.send_string_impl(text, false);
+    }
+
+    static const char* mode_name(const BluKeySession& s) {
+        return s.m_rec_mode == BluKeySession::REC_GCM ? "GCM" : "CTR";
+    }
+
+    // C1 records sealed up front, for writes that don't wait for replies
+    static vector<vector<uint8_t>> c1_records(BluKeySession& s, int n) {
+        vector<vector<uint8_t>> recs;
+        recs.reserve(n);
+        for (int i = 0; i < n; ++i) recs.push_back(s.wrap_b3({ 0xC1, 0x00, 0x00 }));
+        return recs;
+    }
+
+    // C8 (raw fast mode on), then records of `taps` E0 frames each,
+    // every one repeated 255 times
+    static vector<vector<uint8_t>> e0_records(BluKeySession& s, int n, int taps) {
+        vector<vector<uint8_t>> recs;
+        recs.push_back(s.wrap_b3({ 0xC8, 0x01, 0x00, 0x01 }));
+        vector<uint8_t> inner;
+        for (int i = 0; i < taps; ++i) {
+            const uint8_t e0[] = { 0xE0, 0x03, 0x00, 0x00, 0x04, 0xFF };
+            inner.insert(inner.end(), e0, e0 + sizeof(e0));
+        }
+        for (int i = 0; i < n; ++i) recs.push_back(s.wrap_b3(inner));
+        return recs;
+    }
+
+    // decrypt everything the dongle sent, count the app frames
+    static void take_replies(BluKeySession& s, uint32_t& c2, uint32_t& other) {
+        c2 = other = 0;
+        while (!s_notes.empty()) s.recv_app_frames(0);
+        for (const auto& f : s.m_rx_app) (f.op == 0xC2 ? c2 : other)++;
+        s.m_rx_app.clear();
+    }
+};
+
+static void print_latency(const char* what, vector<uint64_t> us, uint32_t dongle_calls,
+                          uint32_t dongle_us) {
+    if (us.empty()) return;
+    sort(us.begin(), us.end());
+    uint64_t sum = 0;
+    for (auto v : us) sum += v;
+    printf("  %-22s n=%-4zu avg %7.1f us  p50 %6llu  max %6llu   dongle handler %6.1f us\n",
+           what, us.size(), static_cast<double>(sum) / us.size(),
+           static_cast<unsigned long long>(us[us.size() / 2]),
+           static_cast<unsigned long long>(us.back()),
+           dongle_calls ? static_cast<double>(dongle_us) / dongle_calls : 0.0);
+}
+
+static void print_records(const char* what, const Sample& s) {
+    const double n = s.records ? s.records : 1;
+    printf("  %-22s %6u records  %9.0f rec/s   us/rec: dongle %6.1f (crypto %5.1f)  cli %6.1f"
+           "   allocs/rec: dongle %5.2f  cli %6.2f\n",
+           what, s.records, s.wall_us ? s.records * 1e6 / s.wall_us : 0.0,
+           s.side_us[SIDE_DONGLE] / n, s.dongle_crypto_us / n, s.side_us[SIDE_CLI] / n,
+           s.allocs[SIDE_DONGLE] / n, s.allocs[SIDE_CLI] / n);
+}
+
+static void usage(const char* prog) {
+    cerr << "Usage: " << prog << " [--handshakes=<n>] [--roundtrips=<n>] [--bytes=<n>]"
+         << " [--stress=<n>] [--record=gcm|ctr|both]\n";
+}
+
+// E0 burst, see the top of the file; false on a lost report or a stall
+static bool e0_burst(BluKeySession& s, int records, int taps) {
+    auto recs = MtlsBench::e0_records(s, records, taps);
+    const uint32_t expect = static_cast<uint32_t>(records * taps * 255 * 2);
+
+    uint32_t r0, o0, h0, r1, o1, h1, c2, other;
+    dongle_hidStats(r0, o0, h0);
+    const uint64_t t0 = now_us();
+    uint64_t pump_max = 0;
+    {
+        DongleSide d;
+        for (const auto& r : recs) dongle_write(r.data(), r.size());
+        for (bool more = true; more;) {
+            const uint64_t p0 = now_us();
+            more = dongle_pump();
+            pump_max = max(pump_max, now_us() - p0);
+        }
+    }
+    // the emitter task types the rest
+    do {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        dongle_hidStats(r1, o1, h1);
+    } while (r1 - r0 < expect && now_us() - t0 < 5000000);
+    const uint64_t us = now_us() - t0;
+    MtlsBench::take_replies(s, c2, other);
+
+    printf("  E0 burst   %6d taps  %9.0f reports/s   reports %u/%u  overruns %u  held %u"
+           "   max pass %llu us\n",
+           records * taps * 255, us ? (r1 - r0) * 1e6 / us : 0.0, r1 - r0, expect, o1 - o0,
+           h1 - h0, static_cast<unsigned long long>(pump_max));
+    return r1 - r0 == expect && o1 == o0;
+}
+
+// RX stress, see the top of the file; false on a lost or stray frame
+static bool rx_stress(BluKeySession& s, int n) {
+    auto recs = MtlsBench::c1_records(s, n);
+
+    uint32_t q0, d0, hw0, st0, q1, d1, hw1, st1, c1_0, c1_us0, c1_1, c1_us1;
+    dongle_rxStats(q0, d0, hw0, st0);
+    dongle_opStats(0xC1, c1_0, c1_us0);
+
+    atomic<bool> done{false};
+    const uint64_t t0 = now_us();
+    // a write per microsecond: several times what the dispatcher takes
+    // per record, so the ring fills up while both sides are busy
+    thread writer([&] {
+        uint64_t next = now_us();
+        for (const auto& r : recs) {
+            while (now_us() < next) {}
+            dongle_write(r.data(), r.size());
+            next += 1;
+        }
+        done = true;
+    });
+    {
+        DongleSide d;
+        while (!done) dongle_pump();
+        while (dongle_pump()) {}
+    }
+    writer.join();
+    const uint64_t us = now_us() - t0;
+
+    dongle_rxStats(q1, d1, hw1, st1);
+    dongle_opStats(0xC1, c1_1, c1_us1);
+    uint32_t c2, other;
+    MtlsBench::take_replies(s, c2, other);
+
+    const uint32_t queued = q1 - q0, dropped = d1 - d0, dispatched = c1_1 - c1_0;
+    printf("  RX stress  %6d writes  %9.0f writes/s   queued %u  dropped %u  ring hw %u frames"
+           "   dispatched %u  C2 %u\n",
+           n, us ? n * 1e6 / us : 0.0, queued, dropped, hw1, dispatched, c2);
+    bool ok = queued + dropped == static_cast<uint32_t>(n) && dispatched == queued &&
+              c2 == dispatched && !other;
+
+    // records still queued when the link drops belong to nobody
+    const int late = 64;
+    auto left = MtlsBench::c1_records(s, late);
+    {
+        DongleSide d;
+        for (const auto& r : left) dongle_write(r.data(), r.size());
+    }
+    MtlsBench::disconnect(s);
+    ok = MtlsBench::handshake(s) && MtlsBench::info(s) && ok;
+    dongle_rxStats(q0, d0, hw0, st0);
+    MtlsBench::take_replies(s, c2, other);
+    printf("  link drop  %6d queued -> %u discarded\n", late, st0 - st1);
+    return ok && st0 - st1 == static_cast<uint32_t>(late) && !other;
+}
+
+int main(int argc, char** argv) {
+    int handshakes = 50;
+    int roundtrips = 2000;
+    size_t bytes   = 16384;
+    int stress     = 20000;
+    vector<uint8_t> modes = { BluKeySession::REC_CTR, BluKeySession::REC_GCM };
+
+    for (int i = 1; i < argc; ++i) {
+        string a  = argv[i];
+        auto eq   = a.find('=');
+        string key = (eq == string::npos) ? a : a.substr(0, eq);
+        string val = (eq == string::npos) ? "" : a.substr(eq + 1);
+
+        if (key == "--handshakes") {
+            handshakes = max(1, atoi(val.c_str()));
+        } else if (key == "--roundtrips") {
+            roundtrips = max(1, atoi(val.c_str()));
+        } else if (key == "--stress") {
+            stress = max(1, atoi(val.c_str()));
+        } else if (key == "--bytes") {
+            bytes = static_cast<size_t>(max(1, atoi(val.c_str())));
+        } else if (key == "--record") {
+            if (val == "ctr") modes = { BluKeySession::REC_CTR };
+            else if (val == "gcm") modes = { BluKeySession::REC_GCM };
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // same APPKEY on both sides, as after provisioning
+    vector<uint8_t> app_key = random_bytes(32);
+    char ini_path[] = "/tmp/mtls-bench-XXXXXX";
+    const int fd = mkstemp(ini_path);
+    if (fd < 0) {
+        cerr << "Cannot create the INI file\n";
+        return 1;
+    }
+    close(fd);
+    {
+        ofstream ini(ini_path);
+        ini << "[" << k_mac << "]\napp_key = " << hex_encode(app_key) << "\n";
+    }
+    dongle_begin(app_key.data());
+
+    string text;
+    for (size_t i = 0; i < bytes; ++i) text.push_back(static_cast<char>('a' + i % 26));
+
+    int fails = 0;
+    auto check = [&](bool ok, const char* what) {
+        if (!ok) {
+            cerr << "FAILED: " << what << "\n";
+            fails++;
+        }
+        return ok;
+    };
+
+    for (uint8_t mode : modes) {
+        BluKeySession s(ini_path);
+        s.set_record_mode(mode);
+
+        // first session learns the dongle's version (C2) and gets a ticket
+        if (!check(MtlsBench::handshake(s), "first handshake")) break;
+        MtlsBench::disconnect(s);
+
+        printf("%s records\n", mode == BluKeySession::REC_GCM ? "GCM" : "CTR");
+
+        // full handshakes: no ticket, pool refilled before each
+        vector<uint64_t> full_us, resume_us;
+        uint32_t b1_n0, b1_us0, b1_n, b1_us;
+        uint32_t hello0, hits0, hello, hits;
+        dongle_opStats(0xB1, b1_n0, b1_us0);
+        dongle_helloStats(hello0, hits0);
+        for (int i = 0; i < handshakes && !fails; ++i) {
+            MtlsBench::drop_ticket(s);
+            this_thread::sleep_for(chrono::milliseconds(20));
+            const uint64_t t0 = now_us();
+            check(MtlsBench::handshake(s), "full handshake");
+            full_us.push_back(now_us() - t0);
+            MtlsBench::disconnect(s);
+        }
+        dongle_opStats(0xB1, b1_n, b1_us);
+        dongle_helloStats(hello, hits);
+        print_latency("full handshake", full_us, b1_n - b1_n0, b1_us - b1_us0);
+
+        uint32_t b6_n0, b6_us0, b6_n, b6_us;
+        dongle_opStats(0xB6, b6_n0, b6_us0);
+        for (int i = 0; i < handshakes && !fails; ++i) {
+            const uint64_t t0 = now_us();
+            check(MtlsBench::handshake(s), "resumed handshake");
+            resume_us.push_back(now_us() - t0);
+            MtlsBench::disconnect(s);
+        }
+        dongle_opStats(0xB6, b6_n, b6_us);
+        print_latency("resumed handshake", resume_us, b6_n - b6_n0, b6_us - b6_us0);
+        printf("  B0 keypair from pool: %u/%u\n", hits - hits0, hello - hello0);
+
+        // records: one session, small request/response and a long string
+        if (!check(MtlsBench::handshake(s), "handshake for records")) break;
+        check(string(MtlsBench::mode_name(s)) ==
+              (mode == BluKeySession::REC_GCM ? "GCM" : "CTR"), "record mode");
+
+        Meter m;
+        m.begin();
+        for (int i = 0; i < roundtrips && !fails; ++i) {
+            check(MtlsBench::info(s), "C1/C2 round trip");
+        }
+        m.end();
+        print_records("C1/C2 round trips", m.s);
+
+        Meter mt;
+        {
+            Quiet q;
+            mt.begin();
+            check(MtlsBench::type(s, text), "string");
+            mt.end();
+        }
+        print_records(("string " + to_string(bytes) + " B").c_str(), mt.s);
+
+        check(e0_burst(s, 16, 8), "E0 burst");
+        check(rx_stress(s, stress), "RX stress");
+
+        MtlsBench::disconnect(s);
+    }
+
+    unlink(ini_path);
+    printf("%s\n", fails ? "FAILED" : "OK");
+    return fails ? 1 : 0;
+}
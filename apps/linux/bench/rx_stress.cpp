@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////////////
+// rx_stress.cpp - the dongle's RX frame ring under load, on Linux
+//
+// rx_ring.cpp built through the Arduino shims in bench/shim. A second
+// thread stands in for the NimBLE host task (handleWrite()) and pushes
+// a frame of 4 to RX_FRAME_MAX bytes every microsecond; the main thread
+// is the protocol task, slower, peeking, checking and popping them.
+// Fails unless every accepted frame arrives intact and in order, and
+// accepted + dropped equals pushed (and matches RxRingStats).
+//
+// Then frames are left queued across a link drop (rx_ring_dropLink()):
+// all of them must come out with the old generation, so the protocol
+// task discards them, and the frames of the next link must not.
+//
+//   rx-stress [--frames=<n>]   n frames in the first phase (200000)
+////////////////////////////////////////////////////////////////////
+#include "rx_ring.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+#define STALE_FRAMES 64
+#define NEXT_FRAMES  8
+#define SHORT_FRAME  64     // longest frame in the link drop phase
+
+// frame length and content follow from its sequence number
+static size_t frame_len(uint32_t seq, size_t maxLen)
+{
+    return 4 + (seq * 2654435761u >> 7) % (maxLen - 3);
+}
+
+static void fill_frame(uint8_t* f, uint32_t seq, size_t len)
+{
+    memcpy(f, &seq, 4);
+    for (size_t i = 4; i < len; ++i) f[i] = static_cast<uint8_t>(seq * 31 + i);
+}
+
+static bool check_frame(const uint8_t* f, size_t len, size_t maxLen, uint32_t& seq)
+{
+    if (len < 4) return false;
+    memcpy(&seq, f, 4);
+    if (len != frame_len(seq, maxLen)) return false;
+    for (size_t i = 4; i < len; ++i) {
+        if (f[i] != static_cast<uint8_t>(seq * 31 + i)) return false;
+    }
+    return true;
+}
+
+static bool push_seq(uint32_t seq, size_t maxLen)
+{
+    static uint8_t buf[RX_FRAME_MAX];
+    const size_t len = frame_len(seq, maxLen);
+    fill_frame(buf, seq, len);
+    return rx_ring_push(buf, len);
+}
+
+// --- phase 1: producer thread against a slower consumer ---
+static int run_stress(uint32_t n)
+{
+    atomic<bool> done{false};
+    uint32_t accepted = 0, dropped = 0;
+
+    const auto t0 = chrono::steady_clock::now();
+    thread producer([&] {
+        auto next = chrono::steady_clock::now();
+        for (uint32_t seq = 0; seq < n; ++seq) {
+            next += chrono::microseconds(1);
+            while (chrono::steady_clock::now() < next) {}
+            if (push_seq(seq, RX_FRAME_MAX)) accepted++;
+            else dropped++;
+        }
+        done.store(true, memory_order_release);
+    });
+
+    uint32_t got = 0, bad = 0, order = 0;
+    int64_t last = -1;
+    for (;;) {
+        size_t len = 0;
+        const uint8_t* f = rx_ring_peek(len);
+        if (!f) {
+            if (done.load(memory_order_acquire) && !rx_ring_peek(len)) break;
+            this_thread::yield();
+            continue;
+        }
+
+        uint32_t seq = 0;
+        if (!check_frame(f, len, RX_FRAME_MAX, seq)) bad++;
+        else if (static_cast<int64_t>(seq) <= last) order++;
+        else last = seq;
+        got++;
+
+        // dispatch takes a while
+        const auto until = chrono::steady_clock::now() + chrono::microseconds(2);
+        while (chrono::steady_clock::now() < until) {}
+        rx_ring_pop();
+    }
+    producer.join();
+    const double s = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+    RxRingStats st;
+    rx_ring_getStats(st);
+    printf("  %u frames pushed in %.2f s: %u accepted, %u dropped, %u dispatched\n", n, s, accepted,
+           dropped, got);
+    printf("  ring high-water: %u frames, %u bytes\n", (unsigned)st.hwFrames, (unsigned)st.hwBytes);
+
+    int fails = 0;
+    if (bad || order) {
+        printf("  %u frames damaged, %u out of order\n", bad, order);
+        fails++;
+    }
+    if (got != accepted || accepted + dropped != n || st.frames != accepted || st.drops != dropped) {
+        printf("  counts don't add up (stats: %u frames, %u drops)\n", st.frames, st.drops);
+        fails++;
+    }
+    return fails;
+}
+
+// --- phase 2: frames left queued across a link drop ---
+static int run_link_drop()
+{
+    uint32_t seq = 0;
+    for (int i = 0; i < STALE_FRAMES; ++i) push_seq(seq++, SHORT_FRAME);
+    rx_ring_dropLink();
+    for (int i = 0; i < NEXT_FRAMES; ++i) push_seq(seq++, SHORT_FRAME);
+
+    uint32_t stale = 0, kept = 0, bad = 0;
+    size_t len = 0;
+    uint16_t link = 0;
+    while (const uint8_t* f = rx_ring_peek(len, nullptr, &link)) {
+        uint32_t s = 0;
+        if (!check_frame(f, len, SHORT_FRAME, s)) bad++;
+        else if (link != rx_ring_link()) stale += (s < STALE_FRAMES);
+        else kept += (s >= STALE_FRAMES);
+        rx_ring_pop();
+    }
+    printf("  link drop: %u of %u queued frames discarded, %u of %u of the next link kept\n", stale,
+           STALE_FRAMES, kept, NEXT_FRAMES);
+    return (bad || stale != STALE_FRAMES || kept != NEXT_FRAMES) ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t n = 200000;
+    for (int i = 1; i < argc; ++i) {
+        const string a = argv[i];
+        if (a.rfind("--frames=", 0) == 0) n = static_cast<uint32_t>(strtoul(a.c_str() + 9, nullptr, 10));
+        else {
+            fprintf(stderr, "Usage: %s [--frames=<n>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const int fails = run_stress(n) + run_link_drop();
+    printf("%s\n", fails ? "FAILED" : "OK");
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////
+// Arduino.h - host shim for building firmware sources on Linux
+//
+// Just enough of the Arduino-ESP32 core (String, timing, Serial,
+// esp_random, the FreeRTOS task calls) for the typing path
+// (layout_kb_profiles.h, RawKeyboard.h, hid_emitter.cpp), mtls.cpp and
+// the headers they pull in (commands.h, settings.h, ...). Implemented
+// in host_arduino.cpp; mbedTLS is the real (upstream) library.
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <algorithm>
+
+class String {
+public:
+    String() {}
+    String(const char* s) : m_s(s ? s : "") {}
+    String(const std::string& s) : m_s(s) {}
+    String(int v) : m_s(std::to_string(v)) {}
+    String(unsigned v) : m_s(std::to_string(v)) {}
+    String(long v) : m_s(std::to_string(v)) {}
+    String(unsigned long v) : m_s(std::to_string(v)) {}
+
+    void reserve(size_t n) { m_s.reserve(n); }
+    String& operator+=(const String& o) { m_s += o.m_s; return *this; }
+    String& operator+=(const char* o) { m_s += o; return *this; }
+    String& operator+=(char c) { m_s += c; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.m_s + b.m_s); }
+    friend String operator+(const char* a, const String& b) { return String(a + b.m_s); }
+    bool operator==(const char* o) const { return m_s == o; }
+    bool operator==(const String& o) const { return m_s == o.m_s; }
+    bool startsWith(const char* p) const { return m_s.rfind(p, 0) == 0; }
+    void trim() {
+        const char* ws = " \t\r\n";
+        m_s.erase(m_s.find_last_not_of(ws) + 1);
+        m_s.erase(0, m_s.find_first_not_of(ws));
+    }
+    const char* c_str() const { return m_s.c_str(); }
+    unsigned length() const { return static_cast<unsigned>(m_s.size()); }
+    bool isEmpty() const { return m_s.empty(); }
+
+private:
+    std::string m_s;
+};
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+uint32_t esp_random();
+
+// host only: move millis()/micros() ahead without sleeping, so a bench
+// doesn't wait out the firmware's scheduled sends (B0 retry, B2 delay)
+void host_clockSkip(uint32_t ms);
+
+// host only: virtual time from here on. millis()/micros() only move
+// when delay()/delayMicroseconds()/host_clockSkip() move them, nothing
+// sleeps. For single-threaded simulations (hid-sim), before any task.
+void host_clockVirtual();
+
+struct Print {
+    int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    void println(const char* s);
+    void println(const String& s);
+};
+struct HardwareSerial : Print {
+    void begin(unsigned long) {}
+};
+extern HardwareSerial Serial;
+
+// FreeRTOS (tasks run on std::thread, see host_arduino.cpp)
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdPASS  1
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY     0xFFFFFFFFu
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack,
+                                   void* arg, UBaseType_t prio, TaskHandle_t* out,
+                                   BaseType_t core);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
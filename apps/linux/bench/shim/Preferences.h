@@ -0,0 +1,31 @@
+////////////////////////////////////////////////////////////////////
+// Preferences.h - host shim: NVS namespace kept in RAM
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool read_only = false);
+    void end();
+
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t len);
+    size_t putBytes(const char* key, const void* buf, size_t len);
+    uint32_t getUInt(const char* key, uint32_t def = 0);
+    size_t putUInt(const char* key, uint32_t v);
+    uint8_t getUChar(const char* key, uint8_t def = 0);
+    size_t putUChar(const char* key, uint8_t v);
+    bool getBool(const char* key, bool def = false);
+    size_t putBool(const char* key, bool v);
+    String getString(const char* key, const String& def = String());
+    size_t putString(const char* key, const String& v);
+    bool isKey(const char* key);
+    bool remove(const char* key);
+    bool clear();
+
+private:
+    std::map<std::string, std::vector<uint8_t>> m_kv;
+};
@@ -0,0 +1,4 @@
+////////////////////////////////////////////////////////////////////
+// USB.h - host shim (nothing used)
+////////////////////////////////////////////////////////////////////
+#pragma once
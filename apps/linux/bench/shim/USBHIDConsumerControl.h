@@ -0,0 +1,12 @@
+////////////////////////////////////////////////////////////////////
+// USBHIDConsumerControl.h - host shim: reports go to a recorder, not USB
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <Arduino.h>
+
+class USBHIDConsumerControl {
+public:
+    void begin() {}
+    size_t press(uint16_t usage);
+    size_t release();
+};
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////
+// USBHIDKeyboard.h - host shim: reports go to a recorder, not USB
+//
+// HID_KEY_* are TinyUSB's names (class/hid/hid.h), the ones the
+// layout tables use. write()/press()/release() keep the core's key
+// report and ASCII map; every report goes to host_hidSink() (hid-sim)
+// or is dropped.
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <Arduino.h>
+
+#define HID_KEY_A            0x04
+#define HID_KEY_B            0x05
+#define HID_KEY_C            0x06
+#define HID_KEY_D            0x07
+#define HID_KEY_E            0x08
+#define HID_KEY_F            0x09
+#define HID_KEY_G            0x0A
+#define HID_KEY_H            0x0B
+#define HID_KEY_I            0x0C
+#define HID_KEY_J            0x0D
+#define HID_KEY_K            0x0E
+#define HID_KEY_L            0x0F
+#define HID_KEY_M            0x10
+#define HID_KEY_N            0x11
+#define HID_KEY_O            0x12
+#define HID_KEY_P            0x13
+#define HID_KEY_Q            0x14
+#define HID_KEY_R            0x15
+#define HID_KEY_S            0x16
+#define HID_KEY_T            0x17
+#define HID_KEY_U            0x18
+#define HID_KEY_V            0x19
+#define HID_KEY_W            0x1A
+#define HID_KEY_X            0x1B
+#define HID_KEY_Y            0x1C
+#define HID_KEY_Z            0x1D
+#define HID_KEY_F1           0x3A
+#define HID_KEY_F2           0x3B
+#define HID_KEY_F3           0x3C
+#define HID_KEY_F4           0x3D
+#define HID_KEY_F5           0x3E
+#define HID_KEY_F6           0x3F
+#define HID_KEY_F7           0x40
+#define HID_KEY_F8           0x41
+#define HID_KEY_F9           0x42
+#define HID_KEY_F10          0x43
+#define HID_KEY_F11          0x44
+#define HID_KEY_F12          0x45
+#define HID_KEY_KEYPAD_1     0x59
+#define HID_KEY_KEYPAD_2     0x5A
+#define HID_KEY_KEYPAD_3     0x5B
+#define HID_KEY_KEYPAD_4     0x5C
+#define HID_KEY_KEYPAD_5     0x5D
+#define HID_KEY_KEYPAD_6     0x5E
+#define HID_KEY_KEYPAD_7     0x5F
+#define HID_KEY_KEYPAD_8     0x60
+#define HID_KEY_KEYPAD_9     0x61
+#define HID_KEY_KEYPAD_0     0x62
+#define HID_KEY_EUROPE_1     0x32
+#define HID_KEY_APOSTROPHE   0x34
+#define HID_KEY_EUROPE_2     0x64
+
+typedef struct {
+    uint8_t modifiers;
+    uint8_t reserved;
+    uint8_t keys[6];
+} KeyReport;
+
+class USBHIDKeyboard {
+public:
+    void begin() {}
+    size_t write(uint8_t c);
+    size_t press(uint8_t k);
+    size_t release(uint8_t k);
+    void releaseAll();
+    void sendReport(KeyReport* keys);
+
+private:
+    KeyReport _keyReport = {};
+};
+
+// host only: keyboard reports (rpt) and consumer control reports
+// (rpt == nullptr, usage pressed or 0 = released) go to fn, nullptr
+// drops them again. Each one takes a USB frame (HOST_USB_FRAME_US),
+// like the core's SendReport() waiting for the host to fetch it.
+#define HOST_USB_FRAME_US 1000
+typedef void (*HostHidSink)(const KeyReport* rpt, uint16_t usage);
+void host_hidSink(HostHidSink fn);
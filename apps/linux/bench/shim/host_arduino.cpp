@@ -0,0 +1,306 @@
+////////////////////////////////////////////////////////////////////
+// host_arduino.cpp - the Arduino/ESP calls the shim headers declare
+//
+// Time is the process' steady clock (plus host_clockSkip()) or a virtual
+// one (host_clockVirtual()), FreeRTOS tasks are detached std::threads
+// with a notification counter each, NVS is a map per Preferences
+// object, USB HID reports are dropped or go to host_hidSink().
+////////////////////////////////////////////////////////////////////
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_mac.h>
+#include <tusb.h>
+#include "USBHIDKeyboard.h"
+#include "USBHIDConsumerControl.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <mutex>
+#include <thread>
+#include <sys/random.h>
+
+using namespace std;
+
+// --- time ---
+static const auto s_t0 = chrono::steady_clock::now();
+static atomic<uint64_t> s_skipUs{0};
+static bool s_virtual = false;
+
+static uint64_t now_us()
+{
+    if (s_virtual) return s_skipUs.load(memory_order_relaxed);
+
+    const auto d = chrono::steady_clock::now() - s_t0;
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::microseconds>(d).count()) +
+           s_skipUs.load(memory_order_relaxed);
+}
+
+static void wait_us(uint64_t us)
+{
+    if (s_virtual) s_skipUs.fetch_add(us, memory_order_relaxed);
+    else this_thread::sleep_for(chrono::microseconds(us));
+}
+
+uint32_t millis() { return static_cast<uint32_t>(now_us() / 1000); }
+uint32_t micros() { return static_cast<uint32_t>(now_us()); }
+void delay(uint32_t ms) { wait_us(static_cast<uint64_t>(ms) * 1000); }
+void delayMicroseconds(uint32_t us) { wait_us(us); }
+void yield() { this_thread::yield(); }
+
+void host_clockSkip(uint32_t ms)
+{
+    s_skipUs.fetch_add(static_cast<uint64_t>(ms) * 1000, memory_order_relaxed);
+}
+
+void host_clockVirtual()
+{
+    s_skipUs = now_us();
+    s_virtual = true;
+}
+
+uint32_t esp_random()
+{
+    uint32_t r = 0;
+    while (getrandom(&r, sizeof r, 0) != static_cast<ssize_t>(sizeof r)) {}
+    return r;
+}
+
+int esp_read_mac(uint8_t* mac, esp_mac_type_t type)
+{
+    const uint8_t base[6] = { 0x02, 0x00, 0x00, 0xB1, 0x0E, 0x00 };
+    memcpy(mac, base, 6);
+    mac[5] = static_cast<uint8_t>(type);
+    return 0;
+}
+
+// --- Serial ---
+HardwareSerial Serial;
+
+int Print::printf(const char* fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    const int n = vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    return n;
+}
+void Print::println(const char* s) { fprintf(stderr, "%s\n", s); }
+void Print::println(const String& s) { fprintf(stderr, "%s\n", s.c_str()); }
+
+// --- FreeRTOS tasks ---
+struct HostTask {
+    mutex m;
+    condition_variable cv;
+    uint32_t notified = 0;
+};
+static thread_local HostTask* t_self = nullptr;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* arg,
+                                   UBaseType_t, TaskHandle_t* out, BaseType_t)
+{
+    HostTask* t = new HostTask();    // lives as long as the task, i.e. the process
+    if (out) *out = t;
+    thread([t, fn, arg] { t_self = t; fn(arg); }).detach();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    HostTask* t = t_self;
+    if (!t) {
+        delay(ticks == portMAX_DELAY ? 1 : ticks);
+        return 0;
+    }
+    unique_lock<mutex> l(t->m);
+    auto ready = [t] { return t->notified > 0; };
+    if (ticks == portMAX_DELAY) t->cv.wait(l, ready);
+    else t->cv.wait_for(l, chrono::milliseconds(ticks), ready);
+    const uint32_t v = t->notified;
+    if (clear) t->notified = 0;
+    else if (v) t->notified--;
+    return v;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    HostTask* t = static_cast<HostTask*>(task);
+    {
+        lock_guard<mutex> l(t->m);
+        t->notified++;
+    }
+    t->cv.notify_one();
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) { delay(ticks); }
+TickType_t xTaskGetTickCount() { return millis(); }
+
+// --- NVS ---
+bool Preferences::begin(const char*, bool) { return true; }
+void Preferences::end() {}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+    auto it = m_kv.find(key);
+    return it == m_kv.end() ? 0 : it->second.size();
+}
+size_t Preferences::getBytes(const char* key, void* buf, size_t len)
+{
+    auto it = m_kv.find(key);
+    if (it == m_kv.end() || it->second.size() > len) return 0;
+    memcpy(buf, it->second.data(), it->second.size());
+    return it->second.size();
+}
+size_t Preferences::putBytes(const char* key, const void* buf, size_t len)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(buf);
+    m_kv[key].assign(p, p + len);
+    return len;
+}
+uint32_t Preferences::getUInt(const char* key, uint32_t def)
+{
+    uint32_t v = def;
+    getBytes(key, &v, sizeof v);
+    return v;
+}
+size_t Preferences::putUInt(const char* key, uint32_t v) { return putBytes(key, &v, sizeof v); }
+uint8_t Preferences::getUChar(const char* key, uint8_t def)
+{
+    uint8_t v = def;
+    getBytes(key, &v, sizeof v);
+    return v;
+}
+size_t Preferences::putUChar(const char* key, uint8_t v) { return putBytes(key, &v, sizeof v); }
+bool Preferences::getBool(const char* key, bool def) { return getUChar(key, def ? 1 : 0) != 0; }
+size_t Preferences::putBool(const char* key, bool v) { return putUChar(key, v ? 1 : 0); }
+String Preferences::getString(const char* key, const String& def)
+{
+    auto it = m_kv.find(key);
+    if (it == m_kv.end()) return def;
+    return String(string(it->second.begin(), it->second.end()));
+}
+size_t Preferences::putString(const char* key, const String& v)
+{
+    return putBytes(key, v.c_str(), v.length());
+}
+bool Preferences::isKey(const char* key) { return m_kv.count(key) != 0; }
+bool Preferences::remove(const char* key) { return m_kv.erase(key) != 0; }
+bool Preferences::clear()
+{
+    m_kv.clear();
+    return true;
+}
+
+// --- USB HID ---
+static HostHidSink s_hidSink = nullptr;
+
+void host_hidSink(HostHidSink fn) { s_hidSink = fn; }
+
+static void hid_out(const KeyReport* rpt, uint16_t usage)
+{
+    if (!s_hidSink) return;
+    s_hidSink(rpt, usage);
+    delayMicroseconds(HOST_USB_FRAME_US);
+}
+
+bool tud_hid_ready() { return true; }
+bool tud_mounted() { return true; }
+
+// the core's US ASCII map: usage, 0x80 = with Shift
+#define SHIFT 0x80
+static const uint8_t s_asciimap[128] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   // NUL..BEL
+    0x2A, 0x2B, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00,   // BS TAB LF VT FF CR SO SI
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x2C,         0x1E | SHIFT, 0x34 | SHIFT, 0x20 | SHIFT,   //   ! " #
+    0x21 | SHIFT, 0x22 | SHIFT, 0x24 | SHIFT, 0x34,           // $ % & '
+    0x26 | SHIFT, 0x27 | SHIFT, 0x25 | SHIFT, 0x2E | SHIFT,   // ( ) * +
+    0x36,         0x2D,         0x37,         0x38,           // , - . /
+    0x27, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26,   // 0..9
+    0x33 | SHIFT, 0x33,         0x36 | SHIFT, 0x2E,           // : ; < =
+    0x37 | SHIFT, 0x38 | SHIFT, 0x1F | SHIFT,                 // > ? @
+    0x04 | SHIFT, 0x05 | SHIFT, 0x06 | SHIFT, 0x07 | SHIFT, 0x08 | SHIFT, 0x09 | SHIFT,   // A..F
+    0x0A | SHIFT, 0x0B | SHIFT, 0x0C | SHIFT, 0x0D | SHIFT, 0x0E | SHIFT, 0x0F | SHIFT,   // G..L
+    0x10 | SHIFT, 0x11 | SHIFT, 0x12 | SHIFT, 0x13 | SHIFT, 0x14 | SHIFT, 0x15 | SHIFT,   // M..R
+    0x16 | SHIFT, 0x17 | SHIFT, 0x18 | SHIFT, 0x19 | SHIFT, 0x1A | SHIFT, 0x1B | SHIFT,   // S..X
+    0x1C | SHIFT, 0x1D | SHIFT,                                                           // Y Z
+    0x2F,         0x31,         0x30,         0x23 | SHIFT,   // [ \ ] ^
+    0x2D | SHIFT, 0x35,                                       // _ `
+    0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,   // a..m
+    0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D,   // n..z
+    0x2F | SHIFT, 0x31 | SHIFT, 0x30 | SHIFT, 0x35 | SHIFT,   // { | } ~
+    0x00                                                      // DEL
+};
+
+// same key codes as the core: < 0x80 ASCII, 0x80..0x87 modifiers,
+// 0x88 + usage for everything else. Returns the usage, 0 if none.
+static uint8_t key_usage(uint8_t k, uint8_t& mods)
+{
+    mods = 0;
+    if (k >= 0x88) return static_cast<uint8_t>(k - 0x88);
+    if (k >= 0x80) {
+        mods = static_cast<uint8_t>(1 << (k - 0x80));
+        return 0;
+    }
+    const uint8_t u = s_asciimap[k];
+    if (u & SHIFT) mods = 0x02;
+    return static_cast<uint8_t>(u & 0x7F);
+}
+
+size_t USBHIDKeyboard::write(uint8_t c)
+{
+    const size_t n = press(c);
+    release(c);
+    return n;
+}
+
+size_t USBHIDKeyboard::press(uint8_t k)
+{
+    uint8_t mods;
+    const uint8_t u = key_usage(k, mods);
+    if (!u && !mods) return 0;
+
+    _keyReport.modifiers |= mods;
+    if (u && !memchr(_keyReport.keys, u, sizeof _keyReport.keys)) {
+        uint8_t* slot = static_cast<uint8_t*>(memchr(_keyReport.keys, 0, sizeof _keyReport.keys));
+        if (!slot) return 0;
+        *slot = u;
+    }
+    sendReport(&_keyReport);
+    return 1;
+}
+
+size_t USBHIDKeyboard::release(uint8_t k)
+{
+    uint8_t mods;
+    const uint8_t u = key_usage(k, mods);
+    if (!u && !mods) return 0;
+
+    _keyReport.modifiers &= static_cast<uint8_t>(~mods);
+    for (uint8_t& key : _keyReport.keys) {
+        if (u && key == u) key = 0;
+    }
+    sendReport(&_keyReport);
+    return 1;
+}
+
+void USBHIDKeyboard::releaseAll()
+{
+    _keyReport = {};
+    sendReport(&_keyReport);
+}
+
+void USBHIDKeyboard::sendReport(KeyReport* rpt) { hid_out(rpt, 0); }
+
+size_t USBHIDConsumerControl::press(uint16_t usage)
+{
+    hid_out(nullptr, usage);
+    return 1;
+}
+size_t USBHIDConsumerControl::release()
+{
+    hid_out(nullptr, 0);
+    return 1;
+}
@@ -0,0 +1,7 @@
+////////////////////////////////////////////////////////////////////
+// tusb.h - host shim: the HID endpoint is always ready
+////////////////////////////////////////////////////////////////////
+#pragma once
+
+bool tud_hid_ready();
+bool tud_mounted();
@@ -5,6 +5,7 @@
 #include <openssl/aes.h>
 #include <openssl/md5.h>
 #include <openssl/sha.h>
+#include <openssl/rand.h>
 #include <stdexcept>
 #include <sstream>
 #include <iomanip>
@@ -81,6 +82,76 @@ std::vector<uint8_t> aes_ctr_encrypt(const std::vector<uint8_t>& key,
     return out;
 }
 
+std::vector<uint8_t> aes_gcm_seal(const std::vector<uint8_t>& key,
+                                  const std::vector<uint8_t>& nonce,
+                                  const std::vector<uint8_t>& aad,
+                                  const std::vector<uint8_t>& plaintext)
+{
+    if (key.size() != 32 || nonce.size() != 12) {
+        throw std::runtime_error("aes_gcm_seal: invalid key/nonce size");
+    }
+
+    std::vector<uint8_t> out(plaintext.size() + 16);
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        throw std::runtime_error("EVP_CIPHER_CTX_new failed");
+    }
+
+    int len = 0;
+    int fin = 0;
+    bool ok = EVP_EncryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 key.data(), nonce.data()) == 1 &&
+              EVP_EncryptUpdate(ctx, nullptr, &len,
+                                aad.data(), static_cast<int>(aad.size())) == 1 &&
+              EVP_EncryptUpdate(ctx, out.data(), &len,
+                                plaintext.data(), static_cast<int>(plaintext.size())) == 1 &&
+              EVP_EncryptFinal_ex(ctx, out.data() + len, &fin) == 1 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, 16,
+                                  out.data() + plaintext.size()) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) {
+        throw std::runtime_error("AES-GCM encrypt failed");
+    }
+    return out;
+}
+
+bool aes_gcm_open(const std::vector<uint8_t>& key,
+                  const std::vector<uint8_t>& nonce,
+                  const std::vector<uint8_t>& aad,
+                  const uint8_t* cipher, size_t n,
+                  const uint8_t tag[16],
+                  std::vector<uint8_t>& plain_out)
+{
+    if (key.size() != 32 || nonce.size() != 12) {
+        throw std::runtime_error("aes_gcm_open: invalid key/nonce size");
+    }
+
+    std::vector<uint8_t> out(n);
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    if (!ctx) {
+        throw std::runtime_error("EVP_CIPHER_CTX_new failed");
+    }
+
+    int len = 0;
+    int fin = 0;
+    bool ok = EVP_DecryptInit_ex(ctx, EVP_aes_256_gcm(), nullptr,
+                                 key.data(), nonce.data()) == 1 &&
+              EVP_DecryptUpdate(ctx, nullptr, &len,
+                                aad.data(), static_cast<int>(aad.size())) == 1 &&
+              EVP_DecryptUpdate(ctx, out.data(), &len,
+                                cipher, static_cast<int>(n)) == 1 &&
+              EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, 16,
+                                  const_cast<uint8_t*>(tag)) == 1 &&
+              EVP_DecryptFinal_ex(ctx, out.data() + len, &fin) == 1;
+    EVP_CIPHER_CTX_free(ctx);
+    if (!ok) {
+        return false;
+    }
+    plain_out = std::move(out);
+    return true;
+}
 
 std::vector<uint8_t> hkdf_sha256(const std::vector<uint8_t>& salt,
                                  const std::vector<uint8_t>& ikm,
@@ -108,6 +179,25 @@ std::vector<uint8_t> md5_bytes(const std::vector<uint8_t>& data) {
     return out;
 }
 
+std::vector<uint8_t> random_bytes(size_t n) {
+    std::vector<uint8_t> out(n);
+    if (RAND_bytes(out.data(), (int)n) != 1) {
+        throw std::runtime_error("RAND_bytes failed");
+    }
+    return out;
+}
+
+uint32_t crc32_bytes(const std::vector<uint8_t>& data, size_t n) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n && i < data.size(); ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
 std::string hex_encode(const std::vector<uint8_t>& data) {
     std::ostringstream oss;
     oss << std::hex << std::setfill('0');
@@ -16,11 +16,31 @@ std::vector<uint8_t> aes_ctr_encrypt(const std::vector<uint8_t>& key,
                                      const std::vector<uint8_t>& iv,
                                      const std::vector<uint8_t>& plaintext);
 
+// AES-256-GCM, 12-byte nonce: returns cipher || tag16
+std::vector<uint8_t> aes_gcm_seal(const std::vector<uint8_t>& key,
+                                  const std::vector<uint8_t>& nonce,
+                                  const std::vector<uint8_t>& aad,
+                                  const std::vector<uint8_t>& plaintext);
+
+// false if the tag doesn't match (plain_out untouched then)
+bool aes_gcm_open(const std::vector<uint8_t>& key,
+                  const std::vector<uint8_t>& nonce,
+                  const std::vector<uint8_t>& aad,
+                  const uint8_t* cipher, size_t n,
+                  const uint8_t tag[16],
+                  std::vector<uint8_t>& plain_out);
+
 std::vector<uint8_t> hkdf_sha256(const std::vector<uint8_t>& salt,
                                  const std::vector<uint8_t>& ikm,
                                  const std::vector<uint8_t>& info);
 
 std::vector<uint8_t> md5_bytes(const std::vector<uint8_t>& data);
 
+// n bytes from the OpenSSL CSPRNG
+std::vector<uint8_t> random_bytes(size_t n);
+
+// CRC-32 (zlib/IEEE) of the first n bytes, as in the dongle's D1/D6 acks
+uint32_t crc32_bytes(const std::vector<uint8_t>& data, size_t n);
+
 std::string hex_encode(const std::vector<uint8_t>& data);
 std::vector<uint8_t> hex_decode(const std::string& hex);
@@ -1,14 +1,18 @@
 #include "ble_proto.h"
+#include "kb_translate.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <ctime>
 #include <openssl/ec.h>
 #include <openssl/obj_mac.h>
 
 using namespace std;
 
-static long long t_ms() {
+[[maybe_unused]] static long long t_ms() {
     using namespace std::chrono;
     static auto t0 = steady_clock::now();
     auto now = steady_clock::now();
@@ -24,12 +28,17 @@ static void wr_u16le(uint8_t* b, uint16_t v) {
     b[0] = static_cast<uint8_t>(v & 0xFF);
     b[1] = static_cast<uint8_t>((v >> 8) & 0xFF);
 }
+static uint32_t rd_u32le(const uint8_t* b) {
+    return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) |
+           (static_cast<uint32_t>(b[2]) << 16) | (static_cast<uint32_t>(b[3]) << 24);
+}
 static uint16_t rd_u16be(const uint8_t* b) {
     return static_cast<uint16_t>((b[0] << 8) | b[1]);
 }
 
 void Framer::push(const vector<uint8_t>& chunk, vector<Frame>& out) {
-    const size_t MAX_LEN = 1024;
+    // largest frame the dongle sends: B3 around a 4096 byte app frame
+    const size_t MAX_LEN = 2 + 2 + 4096 + 16;
     m_buf.insert(m_buf.end(), chunk.begin(), chunk.end());
     size_t i = 0;
 
@@ -42,8 +51,14 @@ void Framer::push(const vector<uint8_t>& chunk, vector<Frame>& out) {
         if (len > MAX_LEN) return false;
         return pos + 3 + len <= m_buf.size();
     };
+    // header looks fine, the rest of the frame is still on its way
+    // (a frame spans several notifications) - keep it, don't resync
+    auto partial = [&](size_t pos) {
+        return can_header(pos) && rd_u16le(&m_buf[pos + 1]) <= MAX_LEN &&
+               !plausible(pos);
+    };
 
-    while (i < m_buf.size() && !plausible(i)) {
+    while (i < m_buf.size() && !plausible(i) && !partial(i)) {
         ++i;
     }
 
@@ -54,7 +69,7 @@ void Framer::push(const vector<uint8_t>& chunk, vector<Frame>& out) {
                                 m_buf.begin() + i + 3 + len);
         out.push_back(Frame{ op, std::move(payload) });
         i += 3 + len;
-        while (i < m_buf.size() && !plausible(i)) {
+        while (i < m_buf.size() && !plausible(i) && !partial(i)) {
             ++i;
         }
     }
@@ -75,7 +90,7 @@ static vector<uint8_t> be_int(uint32_t v) {
         static_cast<uint8_t>(v)
     };
 }
-static vector<uint8_t> le_int(uint32_t v) {
+[[maybe_unused]] static vector<uint8_t> le_int(uint32_t v) {
     return {
         static_cast<uint8_t>(v & 0xFF),
         static_cast<uint8_t>((v >> 8) & 0xFF),
@@ -89,7 +104,7 @@ static vector<uint8_t> be_short(uint16_t v) {
         static_cast<uint8_t>(v & 0xFF)
     };
 }
-static vector<uint8_t> le_short(uint16_t v) {
+[[maybe_unused]] static vector<uint8_t> le_short(uint16_t v) {
     return {
         static_cast<uint8_t>(v & 0xFF),
         static_cast<uint8_t>(v >> 8)
@@ -122,20 +137,39 @@ static bool parse_layout_from_banner(const std::string& s,
     return true;
 }
 
+// Parse "PROTO=<maj>.<min>" from the C2 info string.
+static bool parse_proto_from_banner(const std::string& s,
+                                    int& maj, int& min) {
+    const char* key = "PROTO=";
+    size_t pos = s.find(key);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    return std::sscanf(s.c_str() + pos + std::strlen(key),
+                       "%d.%d", &maj, &min) == 2;
+}
+
+// seq in the MAC/IV transcript: seq2, seq4 with REC_SEQ32 (1.17+;
+// the low 32 bits with REC_REKEY)
+static vector<uint8_t> seq_be(uint64_t seq, bool wide) {
+    return wide ? be_int(static_cast<uint32_t>(seq))
+                : be_short(static_cast<uint16_t>(seq));
+}
+
 // Compute MTLS IV.
 static vector<uint8_t> mtls_iv(const vector<uint8_t>& k_iv,
                                int sid,
                                char dir,
-                               uint16_t seq) {
-    vector<uint8_t> msg;
+                               uint64_t seq,
+                               bool wide) {
     // "IV1" || sid_be || dir || seq_be
-    msg.insert(msg.end(), {'I','V','1'});
+    vector<uint8_t> msg{'I','V','1'};
 
     auto sid_be = be_int(static_cast<uint32_t>(sid));
     msg.insert(msg.end(), sid_be.begin(), sid_be.end());
     msg.push_back(static_cast<uint8_t>(dir));
 
-    auto seq_be = be_short(seq);
+    auto seq_be = ::seq_be(seq, wide);
     msg.insert(msg.end(), seq_be.begin(), seq_be.end());
 
     auto h = hmac_sha256(k_iv, msg);
@@ -143,9 +177,40 @@ static vector<uint8_t> mtls_iv(const vector<uint8_t>& k_iv,
     return h;
 }
 
+// GCM record nonce (PROTO 1.16+): K_iv[0..11] ^ (dir || 0^7 || seq4_be)
+static vector<uint8_t> mtls_gcm_nonce(const vector<uint8_t>& k_iv,
+                                      char dir,
+                                      uint64_t seq) {
+    vector<uint8_t> n(k_iv.begin(), k_iv.begin() + 12);
+    n[0]  ^= static_cast<uint8_t>(dir);
+    n[8]  ^= static_cast<uint8_t>(seq >> 24);
+    n[9]  ^= static_cast<uint8_t>(seq >> 16);
+    n[10] ^= static_cast<uint8_t>(seq >> 8);
+    n[11] ^= static_cast<uint8_t>(seq);
+    return n;
+}
+
 
 // --- BluKeySession implementation ---
 
+// Record keys from a traffic secret, as from the session key
+BluKeySession::RecKeys BluKeySession::rec_keys(const vector<uint8_t>& secret, uint64_t epoch) {
+    RecKeys k;
+    k.enc    = hmac_sha256(secret, vector<uint8_t>{'E','N','C'});
+    k.mac    = hmac_sha256(secret, vector<uint8_t>{'M','A','C'});
+    k.iv     = hmac_sha256(secret, vector<uint8_t>{'I','V','K'});
+    k.secret = secret;
+    k.epoch  = epoch;
+    return k;
+}
+
+// Key update (PROTO 1.18+): next epoch's keys of a direction,
+// secret' = HKDF-Expand(secret, "MT1U"||dir, 32)
+BluKeySession::RecKeys BluKeySession::rec_keys_next(const RecKeys& cur, char dir) {
+    vector<uint8_t> info = { 'M','T','1','U', static_cast<uint8_t>(dir), 0x01 };
+    return rec_keys(hmac_sha256(cur.secret, info), cur.epoch + 1);
+}
+
 BluKeySession::BluKeySession(const string& ini_path)
     : m_ini(ini_path) {
     m_ini.load();
@@ -429,7 +494,29 @@ bool BluKeySession::send_raw_frame(uint8_t op,
     frame.push_back(len_le[0]);
     frame.push_back(len_le[1]);
     frame.insert(frame.end(), payload.begin(), payload.end());
-    return m_ble.write_tx(frame);
+    return write_frames(frame);
+}
+
+bool BluKeySession::write_frames(const vector<uint8_t>& bytes) {
+    if (!m_segment) {
+        return m_ble.write_tx(bytes);
+    }
+    if (!m_att_mtu) {
+        m_att_mtu = m_ble.att_mtu();
+    }
+
+    const size_t seg = m_att_mtu - 3;
+    if (bytes.size() <= seg) {
+        return m_ble.write_tx(bytes);
+    }
+    for (size_t off = 0; off < bytes.size(); off += seg) {
+        size_t n = std::min(seg, bytes.size() - off);
+        vector<uint8_t> part(bytes.begin() + off, bytes.begin() + off + n);
+        if (!m_ble.write_tx(part, /*no_response=*/true)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 bool BluKeySession::await_next_frame(int timeout_ms,
@@ -468,39 +555,47 @@ vector<uint8_t> BluKeySession::wrap_b3(const vector<uint8_t>& inner) {
         throw runtime_error("MTLS not ready");
     }
 
-    uint16_t seq = m_seq_out;
-	// match dongle: prevent wrap reuse (force re-handshake before 0xFFFF)
-	if (m_seq_out == 0xFFFF) {
+    uint64_t seq = m_seq_out;
+	// match dongle: prevent wrap reuse (force re-handshake before the
+	// last seq, 0xFFFF or 0xFFFFFFFF with REC_SEQ32, never with REC_REKEY)
+	if (m_seq_out == seq_last()) {
 		m_mtls_ready = false;           // force caller to handshake again
 		throw runtime_error("MTLS seq wrap imminent; re-handshake required");
 	}
+	if (rec_epoch(seq) != m_tx.epoch) {
+		m_tx = rec_keys_next(m_tx, 'C');
+	}
 
-	auto iv  = mtls_iv(m_k_iv, m_sid, 'C', seq);
-	auto enc = aes_ctr_encrypt(m_k_enc, iv, inner);
-
-    vector<uint8_t> mac_data;
-    const char tag[] = "ENCM";
-    mac_data.insert(mac_data.end(), tag, tag + std::strlen(tag));
-    auto sid_be = be_int(static_cast<uint32_t>(m_sid));
-    mac_data.insert(mac_data.end(), sid_be.begin(), sid_be.end());
-	mac_data.push_back('C');
-	auto seq_be_mac = be_short(seq);
-	mac_data.insert(mac_data.end(), seq_be_mac.begin(), seq_be_mac.end());
-	mac_data.insert(mac_data.end(), enc.begin(), enc.end());
-	
-   auto mac_full = hmac_sha256(m_k_mac, mac_data);
-	
-    vector<uint8_t> mac16(mac_full.begin(), mac_full.begin() + 16);
-
-	vector<uint8_t> payload;
-
-	auto seq_be_hdr  = be_short(seq);
-	auto clen_be_hdr = be_short(static_cast<uint16_t>(enc.size()));
-	payload.insert(payload.end(), seq_be_hdr.begin(), seq_be_hdr.end());
+	// B3 payload: seq2 | clen2 | cipher | mac16 (GCM: tag16), only the
+	// low 16 bits of seq go on the wire
+	vector<uint8_t> payload = be_short(static_cast<uint16_t>(seq));
+	auto clen_be_hdr = be_short(static_cast<uint16_t>(inner.size()));
 	payload.insert(payload.end(), clen_be_hdr.begin(), clen_be_hdr.end());
-	
-    payload.insert(payload.end(), enc.begin(), enc.end());
-    payload.insert(payload.end(), mac16.begin(), mac16.end());
+
+	if (m_rec_mode == REC_GCM) {
+		// aad = the record header
+		auto sealed = aes_gcm_seal(m_tx.enc, mtls_gcm_nonce(m_tx.iv, 'C', seq),
+		                           payload, inner);
+		payload.insert(payload.end(), sealed.begin(), sealed.end());
+	} else {
+		auto iv  = mtls_iv(m_tx.iv, m_sid, 'C', seq, m_seq_wide);
+		auto enc = aes_ctr_encrypt(m_tx.enc, iv, inner);
+
+		vector<uint8_t> mac_data;
+		const char tag[] = "ENCM";
+		mac_data.insert(mac_data.end(), tag, tag + std::strlen(tag));
+		auto sid_be = be_int(static_cast<uint32_t>(m_sid));
+		mac_data.insert(mac_data.end(), sid_be.begin(), sid_be.end());
+		mac_data.push_back('C');
+		auto seq_be_mac = seq_be(seq, m_seq_wide);
+		mac_data.insert(mac_data.end(), seq_be_mac.begin(), seq_be_mac.end());
+		mac_data.insert(mac_data.end(), enc.begin(), enc.end());
+
+		auto mac_full = hmac_sha256(m_tx.mac, mac_data);
+
+		payload.insert(payload.end(), enc.begin(), enc.end());
+		payload.insert(payload.end(), mac_full.begin(), mac_full.begin() + 16);
+	}
 
     vector<uint8_t> frame;
     frame.push_back(0xB3);
@@ -510,10 +605,63 @@ vector<uint8_t> BluKeySession::wrap_b3(const vector<uint8_t>& inner) {
     frame.push_back(len_le[1]);
     frame.insert(frame.end(), payload.begin(), payload.end());
 
-    m_seq_out = static_cast<uint16_t>((m_seq_out + 1) & 0xFFFF);
+    ++m_seq_out;
     return frame;
 }
 
+uint64_t BluKeySession::seq_last() const {
+    if (m_rekey) {
+        return UINT64_MAX;
+    }
+    return m_seq_wide ? 0xFFFFFFFFu : 0xFFFFu;
+}
+
+uint64_t BluKeySession::rec_epoch(uint64_t seq) const {
+    return m_rekey ? seq / REKEY_RECORDS : 0;
+}
+
+bool BluKeySession::seq_in_fresh(uint16_t seq2, uint64_t& seq) const {
+    if (!m_seq_wide) {
+        seq = seq2;
+    } else {
+        // closest to the next one expected (the last seq is never sent)
+        int64_t s = static_cast<int64_t>(m_seq_in) +
+                    static_cast<int16_t>(static_cast<uint16_t>(seq2 - static_cast<uint16_t>(m_seq_in)));
+        if (s < 0 || static_cast<uint64_t>(s) >= seq_last()) {
+            return false;
+        }
+        seq = static_cast<uint64_t>(s);
+    }
+    if (seq >= m_seq_in) {
+        return true;
+    }
+    uint64_t back = m_seq_in - 1 - seq;
+    return back < 64 && !(m_seq_win & (uint64_t(1) << back));
+}
+
+void BluKeySession::seq_in_mark(uint64_t seq) {
+    if (seq < m_seq_in) {
+        m_seq_win |= uint64_t(1) << (m_seq_in - 1 - seq);
+        return;
+    }
+    uint64_t shift = seq - m_seq_in + 1;
+    m_seq_win = (shift >= 64) ? 0 : (m_seq_win << shift);
+    m_seq_win |= 1;
+    m_seq_in = seq + 1;
+}
+
+// Append one [op][len_le][payload] frame to 'out'.
+static void append_frame(vector<uint8_t>& out,
+                         uint8_t op,
+                         const vector<uint8_t>& payload) {
+    out.push_back(op);
+    uint8_t len_le[2];
+    wr_u16le(len_le, static_cast<uint16_t>(payload.size()));
+    out.push_back(len_le[0]);
+    out.push_back(len_le[1]);
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
 bool BluKeySession::send_app_frame(uint8_t op,
                                    const vector<uint8_t>& payload) {
     if (!m_mtls_ready) {
@@ -522,56 +670,94 @@ bool BluKeySession::send_app_frame(uint8_t op,
     }
 
     vector<uint8_t> inner;
-    inner.push_back(op);
-    uint8_t len_le[2];
-    wr_u16le(len_le, static_cast<uint16_t>(payload.size()));
-    inner.push_back(len_le[0]);
-    inner.push_back(len_le[1]);
-    inner.insert(inner.end(), payload.begin(), payload.end());
+    append_frame(inner, op, payload);
 
-    auto b3 = wrap_b3(inner);
-    return m_ble.write_tx(b3);
+    return write_record(wrap_b3(inner));
 }
 
-bool BluKeySession::await_app_reply(int timeout_ms,
-                                    uint8_t expect_op,
-                                    vector<uint8_t>& payload_out) {
-    if (!m_mtls_ready || m_sess_key.empty()) {
+bool BluKeySession::send_app_frames(const vector<Frame>& frames) {
+    if (!m_mtls_ready) {
+        cerr << "MTLS not established\n";
         return false;
     }
 
-    Framer framer;
-    auto start = chrono::steady_clock::now();
+    vector<uint8_t> inner;
+    for (const auto& f : frames) {
+        if (!inner.empty() &&
+            inner.size() + 3 + f.payload.size() > MAX_RECORD_PLAIN) {
+            if (!write_record(wrap_b3(inner))) {
+                return false;
+            }
+            inner.clear();
+        }
+        append_frame(inner, f.op, f.payload);
+    }
 
-    while (true) {
-        auto now = chrono::steady_clock::now();
-        int elapsed = static_cast<int>(
-            chrono::duration_cast<chrono::milliseconds>(now - start).count());
-        if (elapsed >= timeout_ms) {
-            return false;
+    return inner.empty() || write_record(wrap_b3(inner));
+}
+
+bool BluKeySession::write_record(const vector<uint8_t>& record) {
+    if (m_credit_on) {
+        const uint32_t cost = static_cast<uint32_t>(record.size()) + m_credit_overhead;
+        auto start = chrono::steady_clock::now();
+        while (m_credit_limit - m_credit_sent < cost) {
+            int elapsed = static_cast<int>(
+                chrono::duration_cast<chrono::milliseconds>(
+                    chrono::steady_clock::now() - start).count());
+            if (elapsed >= 6000 || !recv_app_frames(6000 - elapsed)) {
+                cerr << "No credit from dongle\n";
+                return false;
+            }
         }
-        int remain = timeout_ms - elapsed;
-        auto chunk_opt = m_ble.wait_notification(remain);
-        if (!chunk_opt) {
-            return false;
+        m_credit_sent += cost;
+    }
+    return write_frames(record);
+}
+
+bool BluKeySession::recv_app_frames(int timeout_ms) {
+    auto chunk_opt = m_ble.wait_notification(timeout_ms);
+    if (!chunk_opt) {
+        return false;
+    }
+
+    vector<Frame> frames;
+    m_rx_framer.push(*chunk_opt, frames);
+    for (const auto& f : frames) {
+        if (f.op != 0xB3) {
+            continue;
+        }
+        const auto& p = f.payload;
+        if (p.size() < 2 + 2 + 16) {
+            continue;
+        }
+        uint16_t clen = rd_u16be(&p[2]);
+        if (p.size() != 2u + 2u + clen + 16u) {
+            continue;
+        }
+        // replayed / too old: dropped like a bad MAC
+        uint64_t seq = 0;
+        if (!seq_in_fresh(rd_u16be(&p[0]), seq)) {
+            continue;
+        }
+        // first record of the dongle's next key epoch: try its keys,
+        // kept once the record checks out; the epoch before is gone then
+        RecKeys next;
+        const RecKeys* k = &m_rx;
+        if (rec_epoch(seq) == m_rx.epoch + 1) {
+            next = rec_keys_next(m_rx, 'S');
+            k = &next;
+        } else if (rec_epoch(seq) != m_rx.epoch) {
+            continue;
         }
 
-        vector<Frame> frames;
-        framer.push(*chunk_opt, frames);
-        for (const auto& f : frames) {
-            if (f.op != 0xB3) {
-                continue;
-            }
-            const auto& p = f.payload;
-            if (p.size() < 2 + 2 + 16) {
-                continue;
-            }
-			uint16_t seq  = rd_u16be(&p[0]);
-			uint16_t clen = rd_u16be(&p[2]);
-            if (p.size() != 2 + 2 + clen + 16) {
+        vector<uint8_t> plain;
+        if (m_rec_mode == REC_GCM) {
+            vector<uint8_t> aad(p.begin(), p.begin() + 4);
+            if (!aes_gcm_open(k->enc, mtls_gcm_nonce(k->iv, 'S', seq), aad,
+                              &p[4], clen, &p[4 + clen], plain)) {
                 continue;
             }
-
+        } else {
             vector<uint8_t> cipher(p.begin() + 4, p.begin() + 4 + clen);
             vector<uint8_t> mac_in(p.begin() + 4 + clen, p.end());
 
@@ -581,30 +767,87 @@ bool BluKeySession::await_app_reply(int timeout_ms,
             auto sid_be = be_int(static_cast<uint32_t>(m_sid));
             mac_data.insert(mac_data.end(), sid_be.begin(), sid_be.end());
             mac_data.push_back('S');
-            auto seq_be = be_short(seq);
-            mac_data.insert(mac_data.end(), seq_be.begin(), seq_be.end());
+            auto seq_be_mac = seq_be(seq, m_seq_wide);
+            mac_data.insert(mac_data.end(), seq_be_mac.begin(), seq_be_mac.end());
             mac_data.insert(mac_data.end(), cipher.begin(), cipher.end());
-            auto mac_full = hmac_sha256(m_k_mac, mac_data);
+            auto mac_full = hmac_sha256(k->mac, mac_data);
             vector<uint8_t> mac_exp(mac_full.begin(), mac_full.begin() + 16);
             if (mac_exp != mac_in) {
                 continue;
             }
 
-            auto iv = mtls_iv(m_k_iv, m_sid, 'S', seq);
-            auto plain = aes_ctr_encrypt(m_k_enc, iv, cipher);
-            if (plain.size() < 3) {
-                continue;
+            auto iv = mtls_iv(k->iv, m_sid, 'S', seq, m_seq_wide);
+            plain = aes_ctr_encrypt(k->enc, iv, cipher);
+        }
+        seq_in_mark(seq);
+        if (k == &next) {
+            m_rx = std::move(next);
+        }
+
+        // a record can carry several frames back to back
+        size_t off = 0;
+        while (plain.size() - off >= 3) {
+            uint16_t L = rd_u16le(&plain[off + 1]);
+            if (plain.size() - off < 3 + static_cast<size_t>(L)) {
+                break;
             }
-            uint8_t  op_in = plain[0];
-            uint16_t L     = rd_u16le(&plain[1]);
-            if (plain.size() != 3 + L) {
+            Frame in{ plain[off], vector<uint8_t>(plain.begin() + off + 3,
+                                                  plain.begin() + off + 3 + L) };
+            off += 3 + L;
+
+            // CB credit grant: new cumulative limit, only ever raised
+            if (in.op == 0xCB && m_credit_on && in.payload.size() >= 4) {
+                uint32_t limit = rd_u32le(&in.payload[0]);
+                if (static_cast<int32_t>(limit - m_credit_limit) > 0) {
+                    m_credit_limit = limit;
+                }
                 continue;
             }
-            if (op_in != expect_op) {
-                continue;
+            m_rx_app.push_back(std::move(in));
+        }
+    }
+    return true;
+}
+
+bool BluKeySession::await_app_reply(int timeout_ms,
+                                    uint8_t expect_op,
+                                    vector<uint8_t>& payload_out) {
+    uint8_t op = 0;
+    return await_app_reply(timeout_ms, expect_op, expect_op, op, payload_out);
+}
+
+bool BluKeySession::await_app_reply(int timeout_ms,
+                                    uint8_t op1,
+                                    uint8_t op2,
+                                    uint8_t& op_out,
+                                    vector<uint8_t>& payload_out) {
+    if (!m_mtls_ready || m_sess_key.empty()) {
+        return false;
+    }
+
+    auto start = chrono::steady_clock::now();
+
+    while (true) {
+        // frames already in (e.g. taken in while waiting for credit);
+        // anything else than the expected reply is dropped, as before
+        while (!m_rx_app.empty()) {
+            Frame f = std::move(m_rx_app.front());
+            m_rx_app.pop_front();
+            if (f.op == op1 || f.op == op2) {
+                op_out = f.op;
+                payload_out = std::move(f.payload);
+                return true;
             }
-            payload_out.assign(plain.begin() + 3, plain.end());
-            return true;
+        }
+
+        auto now = chrono::steady_clock::now();
+        int elapsed = static_cast<int>(
+            chrono::duration_cast<chrono::milliseconds>(now - start).count());
+        if (elapsed >= timeout_ms) {
+            return false;
+        }
+        if (!recv_app_frames(timeout_ms - elapsed)) {
+            return false;
         }
     }
 }
@@ -628,6 +871,22 @@ bool BluKeySession::do_mtls_handshake_from_b0(const string& mac,
         return false;
     }
 
+    auto t_start = chrono::steady_clock::now();
+    auto took_ms = [&]() {
+        return static_cast<long long>(chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now() - t_start).count());
+    };
+
+    m_mac          = mac;
+    m_ticket_fresh = false;
+    if (try_resume_from_b0(mac, sid, appkey)) {
+        cout << "MTLS session resumed (sid=" << sid << ", "
+             << (m_rec_mode == REC_GCM ? "GCM" : "CTR")
+             << (m_rekey ? "/rekey" : m_seq_wide ? "/seq32" : "")
+             << ", " << took_ms() << " ms)\n";
+        return true;
+    }
+
     // Generate P-256 keypair
     EC_KEY* eckey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
     if (!eckey || EC_KEY_generate_key(eckey) != 1) {
@@ -662,12 +921,23 @@ bool BluKeySession::do_mtls_handshake_from_b0(const string& mac,
 
     keyx_msg.insert(keyx_msg.end(), srv_pub.begin(), srv_pub.end());
     keyx_msg.insert(keyx_msg.end(), cli_pub.begin(), cli_pub.end());
+
+    // 1.16+: record mode offer after the MAC, MACed too (older
+    // firmware drops a B1 that isn't exactly 81 bytes)
+    uint8_t rec_want = REC_CTR;
+    const bool offer = rec_offer(mac, rec_want);
+    if (offer) {
+        keyx_msg.push_back(rec_want);
+    }
     auto mac_full = hmac_sha256(appkey, keyx_msg);
     vector<uint8_t> mac16(mac_full.begin(), mac_full.begin() + 16);
 
     vector<uint8_t> b1_payload;
     b1_payload.insert(b1_payload.end(), cli_pub.begin(), cli_pub.end());
     b1_payload.insert(b1_payload.end(), mac16.begin(), mac16.end());
+    if (offer) {
+        b1_payload.push_back(rec_want);
+    }
 
     if (!send_raw_frame(0xB1, b1_payload)) {
         cerr << "Failed to send B1\n";
@@ -678,6 +948,11 @@ bool BluKeySession::do_mtls_handshake_from_b0(const string& mac,
     Frame resp;
     if (!await_next_frame(4000, 0xB2, 0xFF, resp)) {
         cerr << "No B2 / error\n";
+        if (offer) {
+            // firmware older than we thought: no offer next time
+            m_ini.set(mac, "proto", "");
+            m_ini.save();
+        }
         EC_KEY_free(eckey);
         return false;
     }
@@ -751,22 +1026,242 @@ bool BluKeySession::do_mtls_handshake_from_b0(const string& mac,
     sfin_msg.insert(sfin_msg.end(), srv_pub.begin(), srv_pub.end());
     sfin_msg.insert(sfin_msg.end(), cli_pub.begin(), cli_pub.end());
 
+    // B2 = mac16, or mac16 || mode1 (MACed) in answer to an offer
+    if (resp.payload.size() != (offer ? 17u : 16u)) {
+        cerr << "Bad B2 payload size\n";
+        return false;
+    }
+    const uint8_t rec_mode = offer ? resp.payload[16] : REC_CTR;
+    if (!rec_answer_ok(rec_want, rec_mode)) {
+        cerr << "Bad record mode in B2\n";
+        return false;
+    }
+    if (offer) {
+        sfin_msg.push_back(rec_mode);
+    }
+
 	auto expect_full = hmac_sha256(kMac, sfin_msg);
 	
-    vector<uint8_t> expect(expect_full.begin(), expect_full.begin() + 16);
-    if (resp.payload != expect) {
+    if (!equal(expect_full.begin(), expect_full.begin() + 16, resp.payload.begin())) {
         cerr << "SFIN mismatch\n";
         return false;
     }
 
-    m_sid       = static_cast<int>(sid);
-    m_sess_key  = std::move(sess);
-	m_k_enc    = std::move(kEnc);
-	m_k_mac    = std::move(kMac);
-	m_k_iv     = std::move(kIv);	
-    m_seq_out   = 0;
+    set_session(sid, std::move(sess), std::move(kEnc), std::move(kMac), std::move(kIv), rec_mode);
+    cout << "MTLS session established (sid=" << sid << ", "
+         << (m_rec_mode == REC_GCM ? "GCM" : "CTR")
+         << (m_rekey ? "/rekey" : m_seq_wide ? "/seq32" : "")
+         << ", " << took_ms() << " ms)\n";
+
+    // resumption (1.15+): get a ticket now, so the next connection can
+    // skip the ECDH. The dongle's version is remembered from C2; the
+    // first time ask for it (get_device_info() then gets the ticket).
+    if (m_ini.get(mac, "proto").value_or("") != "") {
+        if (cached_proto_at_least(mac, 1, 15) && !request_ticket()) {
+            cerr << "No resumption ticket\n";
+        }
+    } else {
+        DeviceInfo info;
+        get_device_info(info);
+    }
+    return true;
+}
+
+bool BluKeySession::cached_proto_at_least(const string& mac, int maj, int min) {
+    int v_maj = 0, v_min = 0;
+    auto v = m_ini.get(mac, "proto");
+    if (!v || !parse_proto_from_banner("PROTO=" + *v, v_maj, v_min)) {
+        return false;
+    }
+    return v_maj > maj || (v_maj == maj && v_min >= min);
+}
+
+bool BluKeySession::rec_offer(const string& mac, uint8_t& offer) {
+    // 1.17+: always offer, for 32-bit sequence numbers (1.18+: and key
+    // updates); 1.16: only to ask for GCM (no offer = CTR)
+    if (cached_proto_at_least(mac, 1, 18)) {
+        offer = static_cast<uint8_t>(m_rec_want | REC_SEQ32 | REC_REKEY);
+        return true;
+    }
+    if (cached_proto_at_least(mac, 1, 17)) {
+        offer = static_cast<uint8_t>(m_rec_want | REC_SEQ32);
+        return true;
+    }
+    offer = m_rec_want;
+    return m_rec_want != REC_CTR && cached_proto_at_least(mac, 1, 16);
+}
+
+bool BluKeySession::rec_answer_ok(uint8_t offer, uint8_t answer) {
+    const uint8_t mode = answer & REC_MODE_MASK;
+    if (mode != REC_CTR && mode != (offer & REC_MODE_MASK)) {
+        return false;
+    }
+    // no flag the offer didn't have, key updates only with 32-bit seq
+    if ((answer & REC_REKEY) && !(answer & REC_SEQ32)) {
+        return false;
+    }
+    return (answer & ~REC_MODE_MASK & ~offer) == 0;
+}
+
+void BluKeySession::set_session(uint32_t sid,
+                                vector<uint8_t> sess,
+                                vector<uint8_t> k_enc,
+                                vector<uint8_t> k_mac,
+                                vector<uint8_t> k_iv,
+                                uint8_t rec_mode) {
+    m_sid        = static_cast<int>(sid);
+    m_sess_key   = std::move(sess);
+    m_tx.enc     = std::move(k_enc);
+    m_tx.mac     = std::move(k_mac);
+    m_tx.iv      = std::move(k_iv);
+    m_tx.secret  = m_sess_key;
+    m_tx.epoch   = 0;
+    m_rx         = m_tx;
+    m_rec_mode   = rec_mode & REC_MODE_MASK;
+    m_seq_wide   = (rec_mode & REC_SEQ32) != 0;
+    m_rekey      = (rec_mode & REC_REKEY) != 0;
+    m_seq_out    = 0;
+    m_seq_in     = 0;
+    m_seq_win    = 0;
     m_mtls_ready = true;
-    cout << "MTLS session established (sid=" << sid << ")\n";
+    m_credit_on  = false;
+    m_rx_framer  = Framer();
+    m_rx_app.clear();
+}
+
+// Ticket secret, as on the dongle: RMS = HMAC(sessKey, "RMS"||id16).
+// Kept in the INI next to the APPKEY, with its expiry (unix time).
+void BluKeySession::store_ticket(const vector<uint8_t>& id, uint16_t life_s) {
+    vector<uint8_t> msg = { 'R', 'M', 'S' };
+    msg.insert(msg.end(), id.begin(), id.end());
+    auto rms = hmac_sha256(m_sess_key, msg);
+
+    m_ini.set(m_mac, "ticket_id",      hex_encode(id));
+    m_ini.set(m_mac, "ticket_secret",  hex_encode(rms));
+    m_ini.set(m_mac, "ticket_expires", to_string(static_cast<long long>(time(nullptr)) + life_s));
+    m_ini.save();
+    m_ticket_fresh = true;
+}
+
+bool BluKeySession::request_ticket() {
+    vector<uint8_t> pay;
+    uint8_t op = 0;
+    if (!send_app_frame(0xB4, {}) || !await_app_reply(4000, 0xB5, 0xFF, op, pay)) {
+        return false;
+    }
+    if (op != 0xB5 || pay.size() != 18) {
+        return false;
+    }
+    store_ticket(vector<uint8_t>(pay.begin(), pay.begin() + 16), rd_u16le(&pay[16]));
+    return true;
+}
+
+// B6 RESUME = id16 || cnonce16 || HMAC(RMS, "RSUM"||sid||id||cnonce[||offer])[0..15] [|| offer]
+// B7 RESUMED = snonce16 || nextId16 || life u16le || mac16 [|| mode], keys from
+// sessKey = HKDF(AppKey, RMS, "MT1R"||sid||id||cnonce||snonce) and
+// mac16 = HMAC(K_mac, "RFIN"||sid||id||cnonce||snonce||nextId||life[||mode])
+// (offer / mode: record mode, 1.16+, as in B1 / B2)
+bool BluKeySession::try_resume_from_b0(const string& mac,
+                                       uint32_t sid,
+                                       const vector<uint8_t>& appkey) {
+    auto id_hex  = m_ini.get(mac, "ticket_id");
+    auto rms_hex = m_ini.get(mac, "ticket_secret");
+    auto exp_str = m_ini.get(mac, "ticket_expires");
+    if (!id_hex || !rms_hex || !exp_str || id_hex->empty()) {
+        return false;
+    }
+
+    vector<uint8_t> id, rms;
+    long long expires = 0;
+    try {
+        id      = hex_decode(*id_hex);
+        rms     = hex_decode(*rms_hex);
+        expires = stoll(*exp_str);
+    } catch (...) {
+        return false;
+    }
+
+    // single use: gone whatever the dongle says
+    m_ini.set(mac, "ticket_id",      "");
+    m_ini.set(mac, "ticket_secret",  "");
+    m_ini.set(mac, "ticket_expires", "");
+    m_ini.save();
+
+    if (id.size() != 16 || rms.size() != 32 || static_cast<long long>(time(nullptr)) >= expires) {
+        return false;
+    }
+
+    auto cnonce = random_bytes(16);
+    auto sid_be = be_int(sid);
+
+    vector<uint8_t> msg = { 'R', 'S', 'U', 'M' };
+    msg.insert(msg.end(), sid_be.begin(), sid_be.end());
+    msg.insert(msg.end(), id.begin(), id.end());
+    msg.insert(msg.end(), cnonce.begin(), cnonce.end());
+
+    uint8_t rec_want = REC_CTR;
+    const bool offer = rec_offer(mac, rec_want);
+    if (offer) {
+        msg.push_back(rec_want);
+    }
+    auto mac_full = hmac_sha256(rms, msg);
+    if (offer) {
+        msg.pop_back();
+    }
+
+    vector<uint8_t> b6 = id;
+    b6.insert(b6.end(), cnonce.begin(), cnonce.end());
+    b6.insert(b6.end(), mac_full.begin(), mac_full.begin() + 16);
+    if (offer) {
+        b6.push_back(rec_want);
+    }
+    if (!send_raw_frame(0xB6, b6)) {
+        return false;
+    }
+
+    Frame resp;
+    if (!await_next_frame(4000, 0xB7, 0xFF, resp)) {
+        cerr << "No B7, full handshake\n";
+        return false;
+    }
+    if (resp.op == 0xFF) {
+        string err(resp.payload.begin(), resp.payload.end());
+        cerr << "Resume refused (" << err << "), full handshake\n";
+        return false;
+    }
+    const auto& p = resp.payload;
+    if (p.size() != 16 + 16 + 2 + 16 + (offer ? 1u : 0u)) {
+        cerr << "Bad B7 payload size\n";
+        return false;
+    }
+    const uint8_t rec_mode = offer ? p[50] : REC_CTR;
+    if (!rec_answer_ok(rec_want, rec_mode)) {
+        cerr << "Bad record mode in B7\n";
+        return false;
+    }
+
+    // info = "MT1R"||sid||id||cnonce||snonce
+    msg[0] = 'M'; msg[1] = 'T'; msg[2] = '1'; msg[3] = 'R';
+    msg.insert(msg.end(), p.begin(), p.begin() + 16);
+    auto sess = hkdf_sha256(appkey, rms, msg);
+
+    auto kEnc = hmac_sha256(sess, vector<uint8_t>{'E','N','C'});
+    auto kMac = hmac_sha256(sess, vector<uint8_t>{'M','A','C'});
+    auto kIv  = hmac_sha256(sess, vector<uint8_t>{'I','V','K'});
+
+    msg[0] = 'R'; msg[1] = 'F'; msg[2] = 'I'; msg[3] = 'N';
+    msg.insert(msg.end(), p.begin() + 16, p.begin() + 34);
+    if (offer) {
+        msg.push_back(rec_mode);
+    }
+    auto expect = hmac_sha256(kMac, msg);
+    if (!equal(expect.begin(), expect.begin() + 16, p.begin() + 34)) {
+        cerr << "RFIN mismatch\n";
+        return false;
+    }
+
+    set_session(sid, std::move(sess), std::move(kEnc), std::move(kMac), std::move(kIv), rec_mode);
+    store_ticket(vector<uint8_t>(p.begin() + 16, p.begin() + 32), rd_u16le(&p[32]));
     return true;
 }
 
@@ -802,6 +1297,113 @@ bool BluKeySession::enable_fast_keys() {
     return true;
 }
 
+// C9 [progress | crc32]: D6 while typing, CRC32 in D1
+bool BluKeySession::enable_ack_progress() {
+    vector<uint8_t> body = { 0x03 };  // progress | crc32
+    if (!send_app_frame(0xC9, body)) {
+        return false;
+    }
+    vector<uint8_t> pay;
+    return await_app_reply(4000, 0x00, pay) && pay.empty();
+}
+
+// CA: the dongle answers CB [window u32][overhead u16][max frame u16]
+// and counts our records from the CA one on. After that records go
+// out back to back while there's credit, and grants (CB [limit u32])
+// come in with the other replies.
+bool BluKeySession::enable_credit() {
+    vector<uint8_t> inner;
+    append_frame(inner, 0xCA, { 0x01 });
+    auto record = wrap_b3(inner);
+
+    vector<uint8_t> pay;
+    if (!write_frames(record) || !await_app_reply(4000, 0xCB, pay) || pay.size() < 8) {
+        return false;
+    }
+    m_credit_limit    = rd_u32le(&pay[0]);
+    m_credit_overhead = rd_u16le(&pay[4]);
+    m_credit_sent     = static_cast<uint32_t>(record.size()) + m_credit_overhead;
+    m_credit_on       = true;
+    return true;
+}
+
+// GET_INFO (C1/C2): current layout and protocol version.
+bool BluKeySession::get_device_info(DeviceInfo& out) {
+    if (!send_app_frame(0xC1, {})) {
+        return false;
+    }
+    vector<uint8_t> pay;
+    if (!await_app_reply(4000, 0xC2, pay)) {
+        return false;
+    }
+    string txt(pay.begin(), pay.end());
+    if (!parse_layout_from_banner(txt, out.layout) ||
+        !parse_proto_from_banner(txt, out.proto_major, out.proto_minor)) {
+        return false;
+    }
+    m_segment = out.at_least(1, 11);
+    if (out.at_least(1, 14) && !m_credit_on && !enable_credit()) {
+        cerr << "Credit flow control not enabled\n";
+    }
+
+    // remembered for the next full handshake (ticket request), and a
+    // ticket now if this session didn't bring one
+    if (!m_mac.empty()) {
+        string ver = to_string(out.proto_major) + "." + to_string(out.proto_minor);
+        if (m_ini.get(m_mac, "proto").value_or("") != ver) {
+            m_ini.set(m_mac, "proto", ver);
+            m_ini.save();
+        }
+        if (out.at_least(1, 15) && !m_ticket_fresh && !request_ticket()) {
+            cerr << "No resumption ticket\n";
+        }
+    }
+    return true;
+}
+
+// D2 begin, D3 chunks, D4 end. The dongle starts typing with the first
+// chunk; D1 follows D4. Without credit flow control each chunk is ACKed
+// before the next goes out; with it (1.14+) they all go out back to
+// back, paced by the dongle's credit, and the ACKs are checked after.
+bool BluKeySession::send_string_stream(const vector<uint8_t>& bytes) {
+    const bool pipelined = m_credit_on;
+    size_t acks = 0;  // ACKs still to collect (pipelined)
+    vector<uint8_t> pay;
+
+    if (!send_app_frame(0xD2, {}) || (!pipelined && !await_app_reply(4000, 0x00, pay))) {
+        cerr << "Stream begin failed\n";
+        return false;
+    }
+    acks++;
+
+    const size_t chunk_max = m_segment ? STREAM_CHUNK_SEG : STREAM_CHUNK;
+    for (size_t off = 0; off < bytes.size(); off += chunk_max) {
+        size_t n = std::min(chunk_max, bytes.size() - off);
+        vector<uint8_t> chunk(bytes.begin() + off, bytes.begin() + off + n);
+        if (!send_app_frame(0xD3, chunk) ||
+            (!pipelined && !await_app_reply(6000, 0x00, pay))) {
+            cerr << "Stream chunk at " << off << " failed\n";
+            return false;
+        }
+        acks++;
+    }
+
+    if (!send_app_frame(0xD4, {})) {
+        return false;
+    }
+
+    // ACKs come in order, before the D1
+    for (; pipelined && acks; acks--) {
+        uint8_t op = 0;
+        if (!await_app_reply(6000, 0x00, 0xFF, op, pay) || op != 0x00) {
+            cerr << "Stream failed: "
+                 << (op == 0xFF ? string(pay.begin(), pay.end()) : string("no ACK")) << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
 bool BluKeySession::send_string_impl(const string& text,
                                      bool add_newline) {
     string value = text;
@@ -810,30 +1412,96 @@ bool BluKeySession::send_string_impl(const string& text,
     }
 
     vector<uint8_t> bytes(value.begin(), value.end());
-    auto expected_md5 = md5_bytes(bytes);
+    auto start = chrono::steady_clock::now();
 
-    if (!send_app_frame(0xD0, bytes)) {
+    // Device info is only needed for the newer paths
+    DeviceInfo info;
+    bool have_info = (m_host_xlate || bytes.size() > STREAM_CHUNK) &&
+                     get_device_info(info);
+
+    // Host translation (--xlate): translate with the dongle's current
+    // layout and send ready-made keys (D5), PROTO 1.8+.
+    vector<uint8_t> keys;
+    bool send_keys = m_host_xlate && have_info && info.at_least(1, 8) &&
+                     kb_translate(info.layout, value, keys) &&
+                     keys.size() <= MAX_FRAME_PAYLOAD;
+
+    // PROTO 1.9+: progress (D6) while typing, D1 carries a CRC32
+    bool crc_ack = have_info && info.at_least(1, 9) && enable_ack_progress();
+
+    const char* how = "D0";
+    if (send_keys) {
+        how = "D5";
+        bytes.swap(keys);  // D1 carries the MD5 of the key tokens
+        if (!send_app_frame(0xD5, bytes)) {
+            return false;
+        }
+    } else if (bytes.size() > STREAM_CHUNK && have_info && info.at_least(1, 7)) {
+        // Large text: stream it (no 4 KB limit, typing starts before
+        // the whole text is sent), else one D0 as before.
+        how = "D2-D4";
+        if (!send_string_stream(bytes)) {
+            return false;
+        }
+    } else if (!send_app_frame(0xD0, bytes)) {
         return false;
     }
 
+    // Wait for D1. Each D6 restarts the timeout, so a long string only
+    // fails if typing stalls, not because it takes a while.
     vector<uint8_t> pay;
-    if (!await_app_reply(6000, 0xD1, pay)) {
-        return false;
+    uint8_t op = 0;
+    bool progress = false;
+    for (;;) {
+        if (!await_app_reply(6000, 0xD1, 0xD6, op, pay)) {
+            if (progress) {
+                cerr << "\n";
+            }
+            cerr << "No result from dongle\n";
+            return false;
+        }
+        if (op == 0xD1) {
+            break;
+        }
+        if (pay.size() != 8) {
+            continue;
+        }
+        uint32_t done = rd_u32le(&pay[0]);
+        if (done > bytes.size() || rd_u32le(&pay[4]) != crc32_bytes(bytes, done)) {
+            cerr << "\nCRC mismatch at " << done << " bytes\n";
+            return false;
+        }
+        cerr << "\rTyped " << done << "/" << bytes.size() << " bytes" << flush;
+        progress = true;
     }
-    if (pay.size() != 17) {
-        return false;
+    if (progress) {
+        cerr << "\n";
     }
 
-    uint8_t status = pay[0];
-    vector<uint8_t> md5_recv(pay.begin() + 1, pay.end());
-    if (status != 0) {
-        cerr << "Non-zero D1 status\n";
+    if (pay.size() != (crc_ack ? 5u : 17u)) {
         return false;
     }
-    if (md5_recv != expected_md5) {
-        cerr << "MD5 mismatch\n";
+    if (pay[0] != 0) {
+        cerr << "Non-zero D1 status\n";
         return false;
     }
+    if (crc_ack) {
+        if (rd_u32le(&pay[1]) != crc32_bytes(bytes, bytes.size())) {
+            cerr << "CRC mismatch\n";
+            return false;
+        }
+    } else {
+        vector<uint8_t> md5_recv(pay.begin() + 1, pay.end());
+        if (md5_recv != md5_bytes(bytes)) {
+            cerr << "MD5 mismatch\n";
+            return false;
+        }
+    }
+
+    auto ms = chrono::duration_cast<chrono::milliseconds>(
+                  chrono::steady_clock::now() - start).count();
+    cout << "Typed " << value.size() << " bytes via " << how
+         << " in " << ms << " ms\n";
     return true;
 }
 
@@ -882,8 +1550,90 @@ bool BluKeySession::send_string(const string& mac,
 }
 
 
+// GET_STATS (C5/C6): per opcode [op][calls][total us][max us], u32 LE,
+// then (1.13+) BLE write -> first HID report latency [n][total us][max us],
+// then (1.16+) [modes] and per record mode [mode][records][crypto us][air bytes]
+bool BluKeySession::print_stats(const string& mac, bool clear)
+{
+    vector<uint8_t> dummy_key;
+    if (!get_appkey_for_mac(mac, dummy_key)) {
+        cerr << "No APPKEY stored for " << mac
+             << " – provision the dongle first with --prov.\n";
+        return false;
+    }
+
+    std::vector<uint8_t> b0;
+    if (!connect_and_wait_b0(mac, &b0, /*ensure_paired=*/false)) {
+        return false;
+    }
+    if (b0.empty()) {
+        cerr << "Expected B0 for print_stats()\n";
+        return false;
+    }
+    if (!do_mtls_handshake_from_b0(mac, b0)) {
+        return false;
+    }
+
+    DeviceInfo info;
+    if (!get_device_info(info) || !info.at_least(1, 12)) {
+        cerr << "Dongle firmware has no stats (needs PROTO 1.12+)\n";
+        return false;
+    }
+
+    vector<uint8_t> pay;
+    if (!send_app_frame(0xC5, { static_cast<uint8_t>(clear ? 0x01 : 0x00) }) ||
+        !await_app_reply(4000, 0xC6, pay) || pay.empty() ||
+        pay.size() < 1 + static_cast<size_t>(pay[0]) * 13) {
+        cerr << "Stats request failed\n";
+        return false;
+    }
+
+    std::printf("%-4s %10s %12s %10s %10s\n", "op", "calls", "total us", "avg us", "max us");
+    for (size_t i = 0; i < pay[0]; ++i) {
+        const uint8_t* e = &pay[1 + i * 13];
+        uint32_t calls = rd_u32le(e + 1);
+        uint32_t total = rd_u32le(e + 5);
+        uint32_t mx    = rd_u32le(e + 9);
+        if (!calls) {
+            continue;
+        }
+        std::printf("%02X   %10u %12u %10u %10u\n", e[0], calls, total,
+                    total / calls, mx);
+    }
+
+    const size_t lat_off = 1 + static_cast<size_t>(pay[0]) * 13;
+    if (pay.size() >= lat_off + 12) {
+        uint32_t n     = rd_u32le(&pay[lat_off]);
+        uint32_t total = rd_u32le(&pay[lat_off + 4]);
+        uint32_t mx    = rd_u32le(&pay[lat_off + 8]);
+        if (n) {
+            std::printf("write->HID  n=%u avg=%u us max=%u us\n", n, total / n, mx);
+        }
+    }
+
+    // B3 records (sent + received) per record mode: dongle crypto
+    // time and bytes on air per record
+    const size_t rec_off = lat_off + 12;
+    if (pay.size() >= rec_off + 1 &&
+        pay.size() >= rec_off + 1 + static_cast<size_t>(pay[rec_off]) * 13) {
+        for (size_t i = 0; i < pay[rec_off]; ++i) {
+            const uint8_t* e = &pay[rec_off + 1 + i * 13];
+            uint32_t recs = rd_u32le(e + 1);
+            uint32_t us   = rd_u32le(e + 5);
+            uint32_t air  = rd_u32le(e + 9);
+            if (!recs) {
+                continue;
+            }
+            std::printf("records %s  n=%u avg=%.1f us/rec air=%u B/rec\n",
+                        e[0] == REC_GCM ? "GCM" : "CTR", recs,
+                        static_cast<double>(us) / recs, air / recs);
+        }
+    }
+    return true;
+}
+
 bool BluKeySession::send_key(const string& mac,
-                             uint8_t usage,
+                             const vector<uint8_t>& usages,
                              uint8_t mods,
                              uint8_t repeat) 
 {
@@ -906,11 +1656,38 @@ bool BluKeySession::send_key(const string& mac,
     if (!do_mtls_handshake_from_b0(mac, b0)) {
         return false;
     }
+
+    // PROTO 1.10+: C8 and all the taps in one encrypted record, a single
+    // write instead of one per key
+    DeviceInfo info;
+    if (usages.size() > 1 && get_device_info(info) && info.at_least(1, 10)) {
+        vector<Frame> frames;
+        frames.push_back({ 0xC8, { 0x01 } });
+        for (uint8_t usage : usages) {
+            Frame f{ 0xE0, { mods, usage } };
+            if (repeat > 1) {
+                f.payload.push_back(repeat);
+            }
+            frames.push_back(f);
+        }
+        vector<uint8_t> pay;
+        if (!send_app_frames(frames) || !await_app_reply(4000, 0x00, pay)) {
+            cerr << "Failed to send keys\n";
+            return false;
+        }
+        return true;
+    }
+
     if (!enable_fast_keys()) {
         cerr << "Failed to enable fast keys\n";
         return false;
     }
-    return send_key_impl(usage, mods, repeat);
+    for (uint8_t usage : usages) {
+        if (!send_key_impl(usage, mods, repeat)) {
+            return false;
+        }
+    }
+    return true;
 }
 
 
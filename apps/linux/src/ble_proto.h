@@ -5,6 +5,7 @@
 #include "ble_crypto.h"
 #include <string>
 #include <vector>
+#include <deque>
 #include <cstdint>
 
 // Simple frame representation: [op][len_le][payload]
@@ -39,13 +40,38 @@ public:
                      const std::string& text,
                      bool add_newline);
 
-    // --sendkey=code --to=...
+    // --xlate: translate text on the host, dongle only plays keys
+    void set_host_translate(bool on) { m_host_xlate = on; }
+
+    // B3 record modes (PROTO 1.16+), as the dongle's MTLS_REC_*
+    static constexpr uint8_t REC_CTR = 0;   // AES-CTR + HMAC-SHA256
+    static constexpr uint8_t REC_GCM = 1;   // AES-256-GCM
+    static constexpr uint8_t REC_MODE_MASK = 0x3F;
+    static constexpr uint8_t REC_SEQ32 = 0x80;  // flag: 32-bit seq (1.17+)
+    static constexpr uint8_t REC_REKEY = 0x40;  // flag: key update (1.18+)
+
+    // records per key epoch with REC_REKEY, as the dongle's
+    static constexpr uint64_t REKEY_RECORDS = 65536;
+
+    // --record=ctr|gcm: mode to offer in B1/B6 (GCM by default; CTR
+    // sends no offer to a 1.16 dongle, like older apps; from 1.17 the
+    // offer always asks for 32-bit sequence numbers too, from 1.18 for
+    // key updates as well)
+    void set_record_mode(uint8_t mode) { m_rec_want = mode; }
+
+    // --stats --to=... [--clear]: per-opcode handler time (PROTO 1.12+)
+    bool print_stats(const std::string& mac, bool clear);
+
+    // --sendkey=code[,code...] --to=...
     bool send_key(const std::string& mac,
-                  uint8_t usage,
+                  const std::vector<uint8_t>& usages,
                   uint8_t mods = 0,
                   uint8_t repeat = 1);
 
 private:
+    // bench/mtls_bench.cpp runs the handshake and records directly
+    friend struct MtlsBench;
+
     // INI handling
     IniFile m_ini;
 
@@ -56,10 +82,22 @@ private:
     bool m_mtls_ready = false;
     int  m_sid        = 0;
     std::vector<uint8_t> m_sess_key;
-    uint16_t m_seq_out = 0;
-	std::vector<uint8_t> m_k_enc;
-	std::vector<uint8_t> m_k_mac;
-	std::vector<uint8_t> m_k_iv;
+    uint64_t m_seq_out = 0;
+
+    // record keys of one direction for its current epoch; epoch 0 is
+    // the session key's, REC_REKEY moves on every REKEY_RECORDS
+    struct RecKeys {
+        std::vector<uint8_t> enc;
+        std::vector<uint8_t> mac;
+        std::vector<uint8_t> iv;
+        std::vector<uint8_t> secret;
+        uint64_t epoch = 0;
+    };
+    RecKeys m_tx;
+    RecKeys m_rx;
+
+    static RecKeys rec_keys(const std::vector<uint8_t>& secret, uint64_t epoch);
+    static RecKeys rec_keys_next(const RecKeys& cur, char dir);
 
 	// Simplified connect signal
 	// as the only "ready" indicator.
@@ -76,9 +114,54 @@ private:
     bool do_mtls_handshake_from_b0(const std::string& mac,
                                    const std::vector<uint8_t>& b0_payload);
 
+    // PROTO 1.15+: answer B0 with B6 RESUME using the ticket stored for
+    // this dongle instead of a full ECDH handshake. The ticket is used
+    // up either way; false (no ticket, or refused) leaves the B0 good
+    // for B1. B7 brings the next ticket.
+    bool try_resume_from_b0(const std::string& mac,
+                            uint32_t sid,
+                            const std::vector<uint8_t>& appkey);
+
+    // B4/B5: ask for a resumption ticket for the next connection
+    bool request_ticket();
+
+    // keep a ticket (id + lifetime from the dongle) in the INI, its
+    // secret derived from the current session key
+    void store_ticket(const std::vector<uint8_t>& id, uint16_t life_s);
+
+    void set_session(uint32_t sid,
+                     std::vector<uint8_t> sess,
+                     std::vector<uint8_t> k_enc,
+                     std::vector<uint8_t> k_mac,
+                     std::vector<uint8_t> k_iv,
+                     uint8_t rec_mode);
+
+    // record mode offer for B1/B6 by the dongle's version, false if none
+    bool rec_offer(const std::string& mac, uint8_t& offer);
+
+    // B2/B7 mode answer fits what was offered
+    static bool rec_answer_ok(uint8_t offer, uint8_t answer);
+
+    // inbound replay window, as the dongle's: full seq for seq2 if it
+    // wasn't seen yet and isn't too old / mark it once the MAC is good
+    bool seq_in_fresh(uint16_t seq2, uint64_t& seq) const;
+    void seq_in_mark(uint64_t seq);
+
+    // last seq a session may use, key epoch of a seq
+    uint64_t seq_last() const;
+    uint64_t rec_epoch(uint64_t seq) const;
+
+    // dongle protocol version remembered from its last C2 reply
+    bool cached_proto_at_least(const std::string& mac, int maj, int min);
+
     bool send_raw_frame(uint8_t op,
                         const std::vector<uint8_t>& payload);
 
+    // Write one or more whole frames. PROTO 1.11+: anything longer than
+    // one ATT packet goes out as MTU-sized write-without-response
+    // segments (the dongle reassembles), else a single (long) write.
+    bool write_frames(const std::vector<uint8_t>& bytes);
+
     bool await_next_frame(int timeout_ms,
                           uint8_t op1,
                           uint8_t op2,
@@ -86,20 +169,108 @@ private:
 
     std::vector<uint8_t> wrap_b3(const std::vector<uint8_t>& inner_frame);
 
+    // Write one B3 record; with credit flow control on, first waits
+    // (taking in replies) until the dongle has room for it.
+    bool write_record(const std::vector<uint8_t>& record);
+
+    // Read one notification, decrypt its records and queue the app
+    // frames in m_rx_app (CB credit grants are taken out here).
+    bool recv_app_frames(int timeout_ms);
+
     bool send_app_frame(uint8_t op,
                         const std::vector<uint8_t>& payload);
 
+    // PROTO 1.10+: several app frames back to back in one B3 record
+    // (split over more records if they don't fit in one)
+    bool send_app_frames(const std::vector<Frame>& frames);
+
     bool await_app_reply(int timeout_ms,
                          uint8_t expect_op,
                          std::vector<uint8_t>& payload_out);
 
+    // same, accepting either op (the one received goes to op_out)
+    bool await_app_reply(int timeout_ms,
+                         uint8_t op1,
+                         uint8_t op2,
+                         uint8_t& op_out,
+                         std::vector<uint8_t>& payload_out);
+
     bool send_get_info_layout(std::string& layout_out);
 
     bool enable_fast_keys();
 
+    // C9 (PROTO 1.9+): D6 progress while typing, CRC32 in D1
+    bool enable_ack_progress();
+
+    // CA (PROTO 1.14+): credit flow control, see write_record()
+    bool enable_credit();
+
     bool send_string_impl(const std::string& text,
                           bool add_newline);
 
+    // SEND_STRING streaming (D2/D3/D4), bytes per D3 chunk
+    static constexpr size_t STREAM_CHUNK = 512;
+
+    // same, when frames can be segmented (fewer chunk ACK round trips)
+    static constexpr size_t STREAM_CHUNK_SEG = 2048;
+
+    // largest single frame payload the dongle takes (4096 - header)
+    static constexpr size_t MAX_FRAME_PAYLOAD = 4093;
+
+    // largest B3 plaintext: 4096 - B3 header, seq/clen and MAC
+    static constexpr size_t MAX_RECORD_PLAIN = 4096 - 3 - 4 - 16;
+
+    struct DeviceInfo {
+        std::string layout;
+        int proto_major = 0;
+        int proto_minor = 0;
+
+        bool at_least(int maj, int min) const {
+            return proto_major > maj ||
+                   (proto_major == maj && proto_minor >= min);
+        }
+    };
+
+    bool get_device_info(DeviceInfo& out);
+
+    bool m_host_xlate = false;
+
+    // dongle reassembles frames split over writes (PROTO 1.11+),
+    // set by get_device_info()
+    bool     m_segment = false;
+    uint16_t m_att_mtu = 0;
+
+    // credit flow control: records may be written while the cost of
+    // everything sent (length + overhead each) stays within the limit
+    // the dongle grants (both cumulative, wrap at 2^32)
+    bool     m_credit_on       = false;
+    uint32_t m_credit_limit    = 0;
+    uint32_t m_credit_sent     = 0;
+    uint32_t m_credit_overhead = 0;
+
+    // dongle of the current session (INI section), and whether it gave
+    // us a ticket for the next one yet
+    std::string m_mac;
+    bool        m_ticket_fresh = false;
+
+    // record mode wanted / in use for the current session
+    uint8_t m_rec_want = REC_GCM;
+    uint8_t m_rec_mode = REC_CTR;
+
+    // 32-bit sequence numbers (REC_SEQ32 granted), 64-bit with key
+    // updates (REC_REKEY); inbound: one past
+    // the highest seq accepted + window of the 64 below it
+    bool     m_seq_wide = false;
+    bool     m_rekey    = false;
+    uint64_t m_seq_in   = 0;
+    uint64_t m_seq_win  = 0;
+
+    // decrypted app frames not awaited yet
+    Framer            m_rx_framer;
+    std::deque<Frame> m_rx_app;
+
+    bool send_string_stream(const std::vector<uint8_t>& bytes);
+
     bool send_key_impl(uint8_t usage,
                        uint8_t mods,
                        uint8_t repeat);
@@ -1097,7 +1097,7 @@ bool BleTransport::connect(const std::string& address,
     return true;
 }
 
-bool BleTransport::write_tx(const std::vector<uint8_t>& data) {
+bool BleTransport::write_tx(const std::vector<uint8_t>& data, bool no_response) {
     if (!m_impl || !m_impl->conn || m_impl->tx_char_path.empty()) return false;
 
     // Build the "value" (type: ay)
@@ -1108,12 +1108,13 @@ bool BleTransport::write_tx(const std::vector<uint8_t>& data) {
         sizeof(guint8)
     );
 
-    // Build an empty "options" dict (type: a{sv})
-    GVariant* options = g_variant_new_array(
-        G_VARIANT_TYPE("{sv}"),
-        nullptr,
-        0
-    );
+    // "options" dict (type: a{sv}), type=command for write-without-response
+    GVariantBuilder opts;
+    g_variant_builder_init(&opts, G_VARIANT_TYPE("a{sv}"));
+    if (no_response) {
+        g_variant_builder_add(&opts, "{sv}", "type", g_variant_new_string("command"));
+    }
+    GVariant* options = g_variant_builder_end(&opts);
 
     // Combine into a tuple (ay, a{sv}) for WriteValue
     GVariant* children[2] = { value, options };
@@ -1141,6 +1142,40 @@ bool BleTransport::write_tx(const std::vector<uint8_t>& data) {
     return true;
 }
 
+uint16_t BleTransport::att_mtu() {
+    if (!m_impl || !m_impl->conn || m_impl->tx_char_path.empty()) return 23;
+
+    // GattCharacteristic1.MTU, BlueZ 5.62+
+    GError* error = nullptr;
+    GVariant* result = g_dbus_connection_call_sync(
+        m_impl->conn,
+        "org.bluez",
+        m_impl->tx_char_path.c_str(),
+        "org.freedesktop.DBus.Properties",
+        "Get",
+        g_variant_new("(ss)", "org.bluez.GattCharacteristic1", "MTU"),
+        G_VARIANT_TYPE("(v)"),
+        G_DBUS_CALL_FLAGS_NONE,
+        5000,
+        nullptr,
+        &error
+    );
+    if (!result) {
+        if (error) g_error_free(error);
+        return 23;
+    }
+
+    GVariant* v = nullptr;
+    g_variant_get(result, "(v)", &v);
+    guint16 mtu = 23;
+    if (g_variant_is_of_type(v, G_VARIANT_TYPE_UINT16)) {
+        mtu = g_variant_get_uint16(v);
+    }
+    g_variant_unref(v);
+    g_variant_unref(result);
+    return mtu < 23 ? 23 : mtu;
+}
+
 // Called from GLib thread
 void BleTransport::handle_notification(const uint8_t* value, size_t value_length) {
     std::lock_guard<std::mutex> lock(m_notif_mutex);
@@ -33,7 +33,11 @@ public:
     void disconnect();
 
     // Write raw bytes to the Nordic UART TX characteristic
-    bool write_tx(const std::vector<uint8_t>& data);
+    // (no_response: ATT write command, must fit in att_mtu() - 3)
+    bool write_tx(const std::vector<uint8_t>& data, bool no_response = false);
+
+    // Negotiated ATT MTU of the TX characteristic (23 if BlueZ doesn't say)
+    uint16_t att_mtu();
 
     // Blocking wait for next notification chunk with timeout (ms)
     std::optional<std::vector<uint8_t>> wait_notification(int timeout_ms);
@@ -9,8 +9,10 @@ static void usage(const char* prog) {
     cerr << "Usage:\n"
          << "  " << prog << " --list\n"
          << "  " << prog << " --prov=<mac>\n"
-         << "  " << prog << " --sendstr=<text> --to=<mac> [--newline]\n"
-         << "  " << prog << " --sendkey=<usage> --to=<mac> [--mods=<mods>] [--repeat=<n>]\n"
+         << "  " << prog << " --sendstr=<text> --to=<mac> [--newline] [--xlate]\n"
+         << "  " << prog << " --sendkey=<usage>[,<usage>...] --to=<mac> [--mods=<mods>] [--repeat=<n>]\n"
+         << "  " << prog << " --stats --to=<mac> [--clear]\n"
+         << "  (any of them) [--record=gcm|ctr]: B3 record mode to ask for\n"
          << "\n"
          << "INI file: ./blukeyborg_ini in current working directory\n";
 }
@@ -42,6 +44,8 @@ int main(int argc, char** argv) {
     int   mods        = 0;
     int   repeat      = 1;
     bool  add_newline = false;
+    bool  stats       = false;
+    bool  clear_stats = false;
 
     for (int i = 1; i < argc; ++i) {
         string a  = argv[i];
@@ -66,6 +70,15 @@ int main(int argc, char** argv) {
             }
         } else if (key == "--newline") {
             add_newline = true;
+        } else if (key == "--xlate") {
+            session.set_host_translate(true);
+        } else if (key == "--stats") {
+            stats = true;
+        } else if (key == "--clear") {
+            clear_stats = true;
+        } else if (key == "--record") {
+            session.set_record_mode(val == "ctr" ? BluKeySession::REC_CTR
+                                                 : BluKeySession::REC_GCM);
         }
     }
 
@@ -83,14 +96,28 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    if (stats && !send_to.empty()) {
+        return session.print_stats(send_to, clear_stats) ? 0 : 1;
+    }
+
     if (!sendkey_str.empty() && !send_to.empty()) {
-        int usage = std::atoi(sendkey_str.c_str());
-        if (usage <= 0 || usage > 255) {
-            cerr << "Invalid usage code\n";
-            return 1;
+        vector<uint8_t> usages;
+        size_t pos = 0;
+        while (pos <= sendkey_str.size()) {
+            size_t comma = sendkey_str.find(',', pos);
+            if (comma == string::npos) {
+                comma = sendkey_str.size();
+            }
+            int usage = std::atoi(sendkey_str.substr(pos, comma - pos).c_str());
+            if (usage <= 0 || usage > 255) {
+                cerr << "Invalid usage code\n";
+                return 1;
+            }
+            usages.push_back(static_cast<uint8_t>(usage));
+            pos = comma + 1;
         }
         if (session.send_key(send_to,
-                             static_cast<uint8_t>(usage),
+                             usages,
                              static_cast<uint8_t>(mods),
                              static_cast<uint8_t>(repeat))) {
             return 0;
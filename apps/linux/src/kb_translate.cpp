@@ -0,0 +1,177 @@
+#include "kb_translate.h"
+
+// firmware layout tables (include path: ../../blue_keyboard)
+#include "kb_layouts/kb_layout_common.h"
+#include "kb_layouts/kb_layout_US_WINLIN.h"
+#include "kb_layouts/kb_layout_US_MAC.h"
+#include "kb_layouts/kb_layout_UK_WINLIN.h"
+#include "kb_layouts/kb_layout_UK_MAC.h"
+#include "kb_layouts/kb_layout_IE_WINLIN.h"
+#include "kb_layouts/kb_layout_IE_MAC.h"
+#include "kb_layouts/kb_layout_DE_WINLIN.h"
+#include "kb_layouts/kb_layout_DE_MAC.h"
+#include "kb_layouts/kb_layout_FR_WINLIN.h"
+#include "kb_layouts/kb_layout_FR_MAC.h"
+#include "kb_layouts/kb_layout_ES_WINLIN.h"
+#include "kb_layouts/kb_layout_ES_MAC.h"
+#include "kb_layouts/kb_layout_IT_WINLIN.h"
+#include "kb_layouts/kb_layout_IT_MAC.h"
+#include "kb_layouts/kb_layout_PT_PT_WINLIN.h"
+#include "kb_layouts/kb_layout_PT_PT_MAC.h"
+#include "kb_layouts/kb_layout_PT_BR_WINLIN.h"
+#include "kb_layouts/kb_layout_PT_BR_MAC.h"
+#include "kb_layouts/kb_layout_SE_WINLIN.h"
+#include "kb_layouts/kb_layout_NO_WINLIN.h"
+#include "kb_layouts/kb_layout_DK_WINLIN.h"
+#include "kb_layouts/kb_layout_FI_WINLIN.h"
+#include "kb_layouts/kb_layout_CH_DE_WINLIN.h"
+#include "kb_layouts/kb_layout_CH_FR_WINLIN.h"
+#include "kb_layouts/kb_layout_TR_WINLIN.h"
+#include "kb_layouts/kb_layout_TR_MAC.h"
+
+namespace {
+
+KB_COMPILE_LAYOUT(US_WINLIN);
+KB_COMPILE_LAYOUT(US_MAC);
+KB_COMPILE_LAYOUT(UK_WINLIN);
+KB_COMPILE_LAYOUT(UK_MAC);
+KB_COMPILE_LAYOUT(IE_WINLIN);
+KB_COMPILE_LAYOUT(IE_MAC);
+KB_COMPILE_LAYOUT(DE_WINLIN);
+KB_COMPILE_LAYOUT(DE_MAC);
+KB_COMPILE_LAYOUT(FR_WINLIN);
+KB_COMPILE_LAYOUT(FR_MAC);
+KB_COMPILE_LAYOUT(ES_WINLIN);
+KB_COMPILE_LAYOUT(ES_MAC);
+KB_COMPILE_LAYOUT(IT_WINLIN);
+KB_COMPILE_LAYOUT(IT_MAC);
+KB_COMPILE_LAYOUT(PT_PT_WINLIN);
+KB_COMPILE_LAYOUT(PT_PT_MAC);
+KB_COMPILE_LAYOUT(PT_BR_WINLIN);
+KB_COMPILE_LAYOUT(PT_BR_MAC);
+KB_COMPILE_LAYOUT(SE_WINLIN);
+KB_COMPILE_LAYOUT(NO_WINLIN);
+KB_COMPILE_LAYOUT(DK_WINLIN);
+KB_COMPILE_LAYOUT(FI_WINLIN);
+KB_COMPILE_LAYOUT(CH_DE_WINLIN);
+KB_COMPILE_LAYOUT(CH_FR_WINLIN);
+KB_COMPILE_LAYOUT(TR_WINLIN);
+KB_COMPILE_LAYOUT(TR_MAC);
+
+struct NamedLayout {
+    const char*    name;
+    KbLayoutTables tables;
+};
+
+const NamedLayout kLayouts[] = {
+    { "US_WINLIN",    KBC_US_WINLIN.view() },
+    { "US_MAC",       KBC_US_MAC.view() },
+    { "UK_WINLIN",    KBC_UK_WINLIN.view() },
+    { "UK_MAC",       KBC_UK_MAC.view() },
+    { "IE_WINLIN",    KBC_IE_WINLIN.view() },
+    { "IE_MAC",       KBC_IE_MAC.view() },
+    { "DE_WINLIN",    KBC_DE_WINLIN.view() },
+    { "DE_MAC",       KBC_DE_MAC.view() },
+    { "FR_WINLIN",    KBC_FR_WINLIN.view() },
+    { "FR_MAC",       KBC_FR_MAC.view() },
+    { "ES_WINLIN",    KBC_ES_WINLIN.view() },
+    { "ES_MAC",       KBC_ES_MAC.view() },
+    { "IT_WINLIN",    KBC_IT_WINLIN.view() },
+    { "IT_MAC",       KBC_IT_MAC.view() },
+    { "PT_PT_WINLIN", KBC_PT_PT_WINLIN.view() },
+    { "PT_PT_MAC",    KBC_PT_PT_MAC.view() },
+    { "PT_BR_WINLIN", KBC_PT_BR_WINLIN.view() },
+    { "PT_BR_MAC",    KBC_PT_BR_MAC.view() },
+    { "SE_WINLIN",    KBC_SE_WINLIN.view() },
+    { "NO_WINLIN",    KBC_NO_WINLIN.view() },
+    { "DK_WINLIN",    KBC_DK_WINLIN.view() },
+    { "FI_WINLIN",    KBC_FI_WINLIN.view() },
+    { "CH_DE_WINLIN", KBC_CH_DE_WINLIN.view() },
+    { "CH_FR_WINLIN", KBC_CH_FR_WINLIN.view() },
+    { "TR_WINLIN",    KBC_TR_WINLIN.view() },
+    { "TR_MAC",       KBC_TR_MAC.view() },
+};
+
+bool find_layout(const std::string& name, KbLayoutTables& out) {
+    // TV profiles type with the US map (same as the firmware)
+    const std::string n = (name.compare(0, 3, "TV_") == 0) ? "US_WINLIN" : name;
+    for (const auto& l : kLayouts) {
+        if (n == l.name) {
+            out = l.tables;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Strict UTF-8 decode; anything malformed is left to the dongle's
+// decoder by sending the text as is.
+bool next_codepoint(const std::string& s, size_t& i, uint32_t& cp) {
+    const uint8_t c0 = static_cast<uint8_t>(s[i]);
+    int len = (c0 < 0x80) ? 1 : ((c0 & 0xE0) == 0xC0) ? 2
+            : ((c0 & 0xF0) == 0xE0) ? 3 : ((c0 & 0xF8) == 0xF0) ? 4 : 0;
+    if (len == 0 || i + len > s.size()) {
+        return false;
+    }
+    cp = (len == 1) ? c0 : (c0 & (0x7F >> len));
+    for (int k = 1; k < len; ++k) {
+        const uint8_t c = static_cast<uint8_t>(s[i + k]);
+        if ((c & 0xC0) != 0x80) {
+            return false;
+        }
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    i += len;
+    return true;
+}
+
+void add_key(std::vector<uint8_t>& out, uint8_t mods, uint8_t usage) {
+    if (usage == 0) {
+        return;
+    }
+    out.push_back(mods);
+    out.push_back(usage);
+}
+
+} // namespace
+
+bool kb_translate(const std::string& layout,
+                  const std::string& utf8,
+                  std::vector<uint8_t>& tokens_out) {
+    KbLayoutTables tbl;
+    if (!find_layout(layout, tbl)) {
+        return false;
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(utf8.size() * 2);
+
+    size_t i = 0;
+    while (i < utf8.size()) {
+        uint32_t cp = 0;
+        if (!next_codepoint(utf8, i, cp)) {
+            return false;
+        }
+        if (cp == 0) {
+            break;  // dongle stops typing at NUL too
+        }
+
+        if (cp < 128) {
+            const KbChord& c = tbl.ascii[cp];
+            add_key(out, c.mods1, c.key1);
+            add_key(out, c.mods2, c.key2);
+        } else if (const KbMapEntry* e = kbFindExt(tbl, cp)) {
+            add_key(out, e->mods1, e->key1);
+            add_key(out, e->mods2, e->key2);
+        } else {
+            out.push_back(0x00);
+            out.push_back(0x00);
+            out.push_back(static_cast<uint8_t>(cp & 0xFF));
+            out.push_back(static_cast<uint8_t>((cp >> 8) & 0xFF));
+            out.push_back(static_cast<uint8_t>((cp >> 16) & 0xFF));
+        }
+    }
+
+    tokens_out.swap(out);
+    return true;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Host-side layout translation for SEND_KEYS (0xD5).
+//
+// Uses the firmware's own kb_layouts tables, so the tokens are exactly
+// the keys the dongle would type for the same text:
+//   [mods][usage]          one key (usage != 0)
+//   [0x00][0x00][cp 3 LE]  codepoint without a map entry, left to the
+//                          dongle (dead key / OS Unicode input)
+//
+// 'layout' is the name reported by GET_INFO, e.g. "DE_WINLIN", "TV_LG".
+// Returns false for an unknown layout or invalid UTF-8 (send as text).
+bool kb_translate(const std::string& layout,
+                  const std::string& utf8,
+                  std::vector<uint8_t>& tokens_out);
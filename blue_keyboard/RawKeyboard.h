@@ -5,6 +5,7 @@
 #include "USBHIDKeyboard.h"
 #include "USBHIDConsumerControl.h"
 #include "USB.h"
+#include "hid_emitter.h"
 
 extern USBHIDConsumerControl MediaControl;
 
@@ -16,6 +17,9 @@ public:
 	//               bit4 RCtrl, bit5 RShift, bit6 RAlt (AltGr), bit7 RGUI
 	void sendRaw(uint8_t mods, uint8_t usage) 
 	{
+		// don't leave packed typing keys held under a standalone tap
+		typeRelease();
+
 		// -check if this usage should be sent as Consumer Control
 		// We only treat it as media if there are *no* modifiers.
 		if (mods == 0 && isConsumerUsage(usage)) {
@@ -27,12 +31,24 @@ public:
 		KeyReport rpt = {};           // press
 		rpt.modifiers = mods;
 		rpt.keys[0]   = usage;        // one usage
-		this->sendReport(&rpt);
-		delay(2);
+		emitReport(rpt);
 
 		KeyReport up = {};            // release
-		this->sendReport(&up);
-		delay(1);
+		emitReport(up);
+	}
+
+	// Send one report, paced by USB completion (see hid_emitter.h). When
+	// the HID emitter task runs the report is only queued and the task
+	// does the sending/waiting, so the caller (protocol task) never blocks on USB.
+	void emitReport(const KeyReport& rpt)
+	{
+		HidOp op = {};
+		op.type  = HIDOP_REPORT;
+		op.rpt   = rpt;
+		if( hid_emitter_push(op) ) return;
+
+		KeyReport r = rpt;
+		hid_sendReportPaced(this, &r);
 	}
 
 	// Convenience
@@ -41,6 +57,56 @@ public:
 	inline void altGrUsage(uint8_t usage)          { sendRaw(0x40, usage); } // Right Alt
 	inline void chord(uint8_t mods, uint8_t usage) { sendRaw(mods, usage);   }
 
+	////////////////////////////////////////////////////////////////
+	// Packed typing (used by the SEND_STRING path)
+	//
+	// Instead of press+release per key, keys are added to one held
+	// report (up to 6 usages). Each report adds exactly one new usage,
+	// so the host still sees the key-downs one at a time and in order.
+	// Keys are only released when it's needed:
+	//   - the usage is already held (repeated key, e.g. "ll")
+	//   - the modifier byte changes (e.g. "aB")
+	//   - the report is full (6 keys)
+	//   - typeRelease() is called (end of string / before other senders)
+	//
+	// Modifiers are tracked separately and stay held across a run of
+	// characters that need the same ones (also across the two chords of
+	// a mods2/key2 dead-key entry). The release report already carries
+	// the modifiers the next key needs, so a modifier never changes in
+	// the same report as a key-down, and "PASSWORD" holds Shift once
+	// instead of toggling it around the repeated S.
+	//
+	// "hello" goes from 10 reports to 7: h, he, hel, (up), l, lo, (up).
+	////////////////////////////////////////////////////////////////
+	void typeUsage(uint8_t mods, uint8_t usage)
+	{
+		if( !usage ) return;
+
+		const bool held = (m_typeCount || m_typeRpt.modifiers);
+		if( held && (mods != m_typeRpt.modifiers || m_typeCount >= 6 || isTypeHeld(usage)) )
+		{
+			// release keys, switch (or keep) modifiers for the next key
+			m_typeRpt = {};
+			m_typeRpt.modifiers = mods;
+			m_typeCount = 0;
+			emitReport(m_typeRpt);
+		}
+
+		m_typeRpt.modifiers = mods;
+		m_typeRpt.keys[m_typeCount++] = usage;
+		emitReport(m_typeRpt);
+	}
+
+	// release everything held by typeUsage() (no-op if nothing is held)
+	void typeRelease()
+	{
+		if( !m_typeCount && !m_typeRpt.modifiers ) return;
+
+		m_typeRpt = {};
+		m_typeCount = 0;
+		emitReport(m_typeRpt);
+	}
+
 	// --- NEW: classify media usage IDs coming from Android fast-keys ---
 	static inline bool isConsumerUsage(uint8_t usage)
 	{
@@ -71,15 +137,32 @@ public:
 	}
 	
 private:
+	bool isTypeHeld(uint8_t usage) const
+	{
+		for( uint8_t i = 0; i < m_typeCount; ++i )
+		{
+			if( m_typeRpt.keys[i] == usage ) return( true );
+		}
+		return( false );
+	}
+
 	// delegate to core's USBHIDConsumerControl device
 	void sendConsumerUsage(uint8_t usage) const
 	{
 		// The ESP32 core's USBHIDConsumerControl uses 16-bit usages.
 		// App sends the low byte (0xCD, 0xB5, 0xE9, etc.),
 		// matches the constants defined in USBHIDConsumerControl.h
-		MediaControl.press(static_cast<uint16_t>(usage));
-		MediaControl.release();
+		// Queued behind any keyboard reports when the emitter task runs.
+		HidOp op = {};
+		op.type  = HIDOP_CONSUMER;
+		op.usage = static_cast<uint16_t>(usage);
+		if( hid_emitter_push(op) ) return;
+
+		hid_sendConsumerPaced(&MediaControl, static_cast<uint16_t>(usage));
 	}
 
+	// packed typing state (what the host currently sees as held)
+	KeyReport m_typeRpt = {};
+	uint8_t   m_typeCount = 0;
 };
 
@@ -51,12 +51,15 @@ extern "C"
 // locals
 #include "mtls.h"
 #include "RawKeyboard.h"
+#include "hid_emitter.h"
+#include "rx_ring.h"
+#include "tx_queue.h"
 #include "layout_kb_profiles.h"
 #include "commands.h"
 #include "setup_portal.h"
 
 // defines
-#define MAX_RX_MESSAGE_LENGTH 4096
+#define MAX_RX_MESSAGE_LENGTH RX_FRAME_MAX
 // Onboard APA102 pins (T-Dongle-S3) - get thsi from pins file instead LED_DI_PIN etc
 //#define LED_DI 40
 //#define LED_CI 39
@@ -68,7 +71,7 @@ extern "C"
 // BLE write handler (secured by link state) 
 ////////////////////////////////////////////////////////////////////
 // forward decls from commands.h / mtls.cpp
-extern bool dispatch_binary_frame(const uint8_t* buf, size_t len);
+extern bool dispatch_binary_frame(uint8_t*& buf, size_t& len, uint32_t rxUs);
 extern void mtls_tick();
 extern "C" void mtls_onDisconnect();
 
@@ -110,8 +113,15 @@ CRGB currentColor = CRGB::Black;
 // flags - schedule display events in the main loop
 static volatile bool g_displayReadyScheduled = false;
 static volatile bool g_blinkLedScheduled = false;
-// have we called mtls_sendHello_B0() for this connection?
+static volatile bool g_recvDrawScheduled = false;   // RECV counter changed
+static volatile bool g_lockedShowScheduled = false; // APPKEY onboarding locked
+// have we scheduled mtls_sendHello_B0() for this connection?
 static volatile bool g_mtlsHelloSeeded = false;  
+// MTLS work asked for by the NimBLE callbacks, done by the protocol
+// task: mtls_onDisconnect() / mtls_sendHello_B0() wipe the record
+// contexts it may be using for a B3 at that moment
+static volatile bool g_mtlsDropScheduled  = false;
+static volatile bool g_mtlsHelloScheduled = false;
 
 // Link security state (BLE layer)
 static volatile bool g_linkEncrypted = false;			 // controller link encrypted
@@ -144,13 +154,36 @@ bool    g_appKeySet  = false;
 
 String g_BleName;  
 
-// Single-slot RX frame queue to keep heavy MTLS/command processing out of callbacks
-static volatile bool   g_framePending = false;
-static uint8_t         g_frameBuf[MAX_RX_MESSAGE_LENGTH];
-static size_t          g_frameLen     = 0;
-
-// mutex locker for critical section
-portMUX_TYPE g_frameMux = portMUX_INITIALIZER_UNLOCKED;
+// RX frames are queued in rx_ring (see rx_ring.h) to keep heavy
+// MTLS/command processing out of callbacks; the protocol task
+// (protoTask) owns everything below
+static bool     g_rxHold = false;     // front slot held, see dispatch_busy()
+static uint8_t* g_rxCur  = nullptr;   // next frame in the front slot
+static size_t   g_rxLeft = 0;         // bytes left there (a B3 record can carry several frames)
+static uint16_t g_rxLink = 0;         // link generation the front slot came in on
+static uint32_t g_rxUs   = 0;         // when the front slot came in over BLE
+
+// protocol task, woken by handleWrite(); nullptr = loop() does its work
+static TaskHandle_t g_protoTask = nullptr;
+static void protoTask(void*);
+
+// TX chunks left in tx_queue because the controller was full; the
+// next notification done (onStatus) wakes the protocol task for them
+static volatile bool g_txWaiting = false;
+
+// Frame being reassembled from several writes (NimBLE task only):
+// where the next bytes go (nullptr = swallowed, frame was dropped),
+// how many are still missing and when the last piece came in
+static uint8_t* g_asmDst  = nullptr;
+static size_t   g_asmLeft = 0;
+static uint32_t g_asmMs   = 0;
+
+// Errors found in handleWrite() are sent from the protocol task: sendFrame()
+// uses the MTLS record buffer/HMAC context, which belong to that task.
+static const char* volatile g_rxErr = nullptr;
+
+// longest protocol pass seen while handling an RX frame (dispatch + typing), us
+uint32_t g_loopStallMaxUs = 0;
 
 //////////
 // exported to settings/commands/mtls
@@ -224,11 +257,37 @@ static bool isLinkSecureForTraffic( uint16_t connHandle )
     return( g_linkEncrypted && g_linkAuthenticated );
 }
 
+////////////////////////////////////////////////////////////////////
+// Hand queued TX chunks to the controller until it runs out of buffers
+// (notify() fails). The rest waits in tx_queue for the next pass;
+// onStatus() of the TX characteristic wakes the protocol task as
+// notifications complete. Protocol task only.
+////////////////////////////////////////////////////////////////////
+static void txDrain()
+{
+	size_t n = 0;
+	const uint8_t* chunk;
+	while( g_txChar && (chunk = tx_queue_peek(n)) != nullptr )
+	{
+		g_txChar->setValue( chunk, n );
+		if( !g_txChar->notify() )
+		{
+			// controller full - left at the front, keeps its place
+			tx_queue_busy();
+			g_txWaiting = true;
+			return;
+		}
+		tx_queue_pop();
+	}
+	g_txWaiting = false;
+}
+
 ////////////////////////////////////////////////////////////////////
 // BLE TX helper (notifications), chunks to (MTU-3).
 // - Handshake ops (B0/B1/B2/D1) may send before link is fully secure.
 // - All other ops require encrypted + (authenticated OR bonded).
-// - Retries notify() up to 3 times per chunk.
+// - Queues the chunks (tx_queue.h) and sends what the controller
+//   takes now, never waits; false only if the frame was not queued.
 ////////////////////////////////////////////////////////////////////
 bool sendTX(const uint8_t* data, size_t len)
 {
@@ -263,49 +322,15 @@ bool sendTX(const uint8_t* data, size_t len)
 
 	//DPRINT("[SENDTX] data=%s, mtu=%d max_payload=%d\n", data, mtu, maxPayload );
 
-	// retry if failing
-	size_t off = 0;
-    while( off < len ) 
-    {
-        size_t n = len - off;
-        if( n > maxPayload ) n = maxPayload;
-        
-        g_txChar->setValue( reinterpret_cast<const uint8_t*>(data + off), n );
-
-        // 3. RETRY LOGIC
-        // We try up to 3 times with increasing delays.
-        bool sent = false;
-        for(int i=0; i<3; i++) 
-		{
-            #if defined(ARDUINO_ARCH_ESP32)
-                if( g_txChar->notify() ) 
-				{
-                    sent = true;
-                    break;
-                }
-            #else
-                g_txChar->notify();
-                sent = true; 
-                break;
-            #endif
-            
-            // If failed, wait a bit for the next connection interval to clear buffers
-            //delay(10 + (i*10)); 
-			delay(2 + (i*2)); 
-        }
-
-        if( !sent ) 
-		{
-             DPRINTLN("[TX] FAILED to notify chunk - aborting");
-             return false; 
-        }
-
-        off += n;
-        // Small yield between chunks is still good practice was 2/use 10
-        delay(0); // - do I need this ? used to be 10
-    }
-    return( true );
+	// behind chunks still waiting, in order
+	if( !tx_queue_push(data, len, maxPayload) )
+	{
+		DPRINTLN("[TX] queue full - frame dropped");
+		return( false );
+	}
 
+	txDrain();
+	return( true );
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -338,14 +363,11 @@ void displayStatus( const String& msg, uint16_t color, bool big = true )
 #endif	
 }
 
-// UI helper used by provisioning code in commands.h
+// UI helper used by provisioning code in commands.h (protocol task).
 // Shows a LOCKED message and triggers a red LED blink in the main loop.
 void showLockedNeedsReset()
 {
-#if !NO_DISPLAY	
-    displayStatus("LOCKED", TFT_RED, true);
-#endif
-	
+	g_lockedShowScheduled = true;
     g_blinkLedScheduled = true;
 }
 
@@ -401,7 +423,8 @@ void drawRecv()
 }
 
 ////////////////////////////////////////////////////////////////////
-// Called after SEND_STRING has been typed; bumps counter + blinks LED.
+// Called after SEND_STRING has been typed (protocol task); bumps the
+// counter, loop() redraws it and blinks the LED.
 ////////////////////////////////////////////////////////////////////
 void onStringTyped( size_t numBytes )
 {
@@ -409,7 +432,7 @@ void onStringTyped( size_t numBytes )
 	(void) numBytes;  
 
 	recvCount++;
-	drawRecv();
+	g_recvDrawScheduled = true;
 
 	// schedule LED blink like before
 	g_blinkLedScheduled = true;
@@ -417,70 +440,100 @@ void onStringTyped( size_t numBytes )
 
 ////////////////////////////////////////////////////////////////////
 // BLE RX handler (Write callback).
-// Validates [OP][LENle][PAYLOAD] then queues one frame for loop() to process.
-// Keeps NimBLE callback path short.
+// Validates [OP][LENle][PAYLOAD] then queues the frame for the protocol task.
+// A write can carry several frames back to back, each is queued on its
+// own; on an error the frames before it stay queued, the rest is dropped.
+//
+// A frame longer than the write (declared length > bytes received) is
+// reassembled: its ring record is reserved up front and the following
+// writes (MTU-sized write-without-response packets, PROTO 1.11+) are
+// copied straight into it until it's complete. The write that brings
+// the last piece may carry more frames after it.
+// A frame that can't be queued (too big, ring full) is still swallowed
+// to its end so its tail isn't taken for a new frame.
+//
+// Keeps NimBLE callback path short: one copy into the ring, nothing
+// allocated.
 ////////////////////////////////////////////////////////////////////
-void handleWrite( const std::string& val_in ) 
+void handleWrite( const uint8_t* b, size_t n ) 
 {	
-	// debug heap alignment problem - just keep this in place for now - todo: clear if all good in the future 
-	String hx; hx.reserve(128); 
-	
-	if( val_in.empty() ) return;
-
-	const uint8_t* b = reinterpret_cast<const uint8_t*>(val_in.data());
-	size_t         n = val_in.size();
+	// continuation of a frame split over several writes
+	if( g_asmLeft )
+	{
+		if( millis() - g_asmMs > RX_ASM_TIMEOUT_MS )
+		{
+			// sender gave up on it - drop the partial frame, this write starts fresh
+			DPRINT("[RX] reassembly timeout, %u bytes missing\n", (unsigned)g_asmLeft);
+			if( g_asmDst ) rx_ring_cancel();
+			g_asmLeft = 0;
+			g_rxErr = "len";
+			
+		} else
+		{
+			const size_t k = (n < g_asmLeft) ? n : g_asmLeft;
+			if( g_asmDst ) 
+			{
+				memcpy(g_asmDst, b, k);
+				g_asmDst += k;
+			}
+			g_asmLeft -= k;
+			g_asmMs = millis();
+			b += k;
+			n -= k;
 
-	if( n < 3 ) 
-	{ 
-		const char* e="short"; 
-		sendFrame(0xFF,(const uint8_t*)e,strlen(e)); 
-		return; 
-	}
-	
-	uint8_t  op  = b[0];
-	uint16_t len = (uint16_t)b[1] | ((uint16_t)b[2]<<8);
-	if( n < 3+len ) 
-	{ 
-		const char* e="len"; 
-		sendFrame(0xFF,(const uint8_t*)e,strlen(e)); 
-		return; 
+			if( !g_asmLeft && g_asmDst ) rx_ring_commit();
+		}
 	}
 
-	//////////////
-	// new processing scheduled for main loop
-    // At this point we know we have a full framed message [OP][LENle][PAYLOAD]
-    const size_t frameLen = 3 + len;
-
-    // Queue the frame for processing in loop(); drop if queue is busy
-    if( !g_framePending ) 
+	while( n )
 	{
+		if( n < 3 ) 
+		{ 
+			g_rxErr = "short"; 
+			break; 
+		}
 		
-        if( frameLen <= MAX_RX_MESSAGE_LENGTH ) 
+		uint16_t len = (uint16_t)b[1] | ((uint16_t)b[2]<<8);
+
+		//////////////
+		// new processing scheduled for the protocol task
+		// At this point we have the header of a framed message [OP][LENle][PAYLOAD]
+		const size_t frameLen = 3 + len;
+		const size_t k = (n < frameLen) ? n : frameLen;
+
+		// Queue the frame for the protocol task; drop if the ring is full
+		uint8_t* dst = nullptr;
+		if( frameLen > MAX_RX_MESSAGE_LENGTH ) 
 		{
-			taskENTER_CRITICAL(&g_frameMux);
-			
-            memcpy((void*)g_frameBuf, b, frameLen);
-            g_frameLen     = frameLen;
-            g_framePending = true;
-			
-			taskEXIT_CRITICAL(&g_frameMux);
+			// too big – send error
+			g_rxErr = "too big";
 			
-        } else 
+		} else if( !(dst = rx_ring_reserve(frameLen)) ) 
 		{
-            // too big – send error
-            const char* e = "too big";
-            sendFrame(0xFF, (const uint8_t*)e, strlen(e));
-        }
-		
-		
-    } else 
-	{
-        // queue busy – optional: send back a "busy" error
-        const char* e = "busy";
-        sendFrame(0xFF, (const uint8_t*)e, strlen(e));
-    }
+			// ring full – counted in rx_ring stats, tell the app
+			g_rxErr = "busy";
+		}
 
-    // Return quickly; actual processing happens in loop()
+		if( dst ) memcpy(dst, b, k);
+		b += k;
+		n -= k;
+
+		if( k < frameLen )
+		{
+			// rest comes in the next write(s)
+			g_asmDst  = dst ? dst + k : nullptr;
+			g_asmLeft = frameLen - k;
+			g_asmMs   = millis();
+			break;
+		}
+
+		if( !dst ) break;
+		rx_ring_commit();
+	}
+
+    // Return quickly; actual processing happens in the protocol task
+	// (woken for errors too, they are sent from there)
+	if( g_protoTask ) xTaskNotifyGive( g_protoTask );
 	return;
 
 }
@@ -608,8 +661,8 @@ class WriteCallback : public NimBLECharacteristicCallbacks
 {
 	
 public:
-  void onWrite(NimBLECharacteristic* chr) { handleWrite(chr->getValue()); }
-  void onWrite(NimBLECharacteristic* chr, NimBLEConnInfo& info) override { (void)info; handleWrite(chr->getValue()); }
+  void onWrite(NimBLECharacteristic* chr) { const NimBLEAttValue& v = chr->getValue(); handleWrite(v.data(), v.size()); }
+  void onWrite(NimBLECharacteristic* chr, NimBLEConnInfo& info) override { (void)info; const NimBLEAttValue& v = chr->getValue(); handleWrite(v.data(), v.size()); }
   
 	void onSubscribe(NimBLECharacteristic* c, NimBLEConnInfo& info, uint16_t subValue) override 
 	{
@@ -636,8 +689,10 @@ public:
 
 			if( isLinkSecureForTraffic(g_txConnHandle) ) 
 			{
-				mtls_sendHello_B0();          // seeds cached B0 + retry timer (does not send immediately)
+				// protoPass() seeds cached B0 + retry timer (does not send immediately)
+				g_mtlsHelloScheduled = true;
 				g_mtlsHelloSeeded = true;
+				if( g_protoTask ) xTaskNotifyGive( g_protoTask );
 			} else 
 			{
 				// na
@@ -647,8 +702,17 @@ public:
 		{
 			// Unsubscribed
 			g_txSubChar = nullptr;
+			tx_queue_dropLink();
 		}
 	} 
+
+	// notification done (sent or failed): the controller has a buffer
+	// free again, queued TX chunks can go (txDrain() in protoPass)
+	void onStatus(NimBLECharacteristic* c, int code) override
+	{
+		(void)c; (void)code;
+		if( g_txWaiting && g_protoTask ) xTaskNotifyGive(g_protoTask);
+	}
   
 };
 
@@ -666,6 +730,9 @@ class ServerCallbacks : public NimBLEServerCallbacks
 		g_isSubscribed = false;
 		g_mtlsHelloSeeded = false;
 
+		// nothing queued before this link is for it
+		tx_queue_dropLink();
+
 		//setLED(CRGB::Green);
 		//currentColor = CRGB::Green;
 		// red-orange = connected but not paired yet
@@ -725,8 +792,20 @@ class ServerCallbacks : public NimBLEServerCallbacks
 		  
 		// kill raw fast mode on link drop
 		g_rawFastMode = false;		  
+
+		// strings already queued still get typed, but nobody is left for D1
+		send_string_dropAcks();
+		rx_credit_dropLink();
+		rx_ring_dropLink();
+		tx_queue_dropLink();
+
+		// a frame cut off mid-way is never completed
+		g_asmLeft = 0;
 		  
-		mtls_onDisconnect();
+		// session wiped by the protocol task (protoPass)
+		g_mtlsHelloScheduled = false;
+		g_mtlsDropScheduled  = true;
+		if( g_protoTask ) xTaskNotifyGive( g_protoTask );
 		  
 		setLED(CRGB::Black);
 		//displayStatus("ADVERTISING", TFT_YELLOW, true);
@@ -783,8 +862,10 @@ class ServerCallbacks : public NimBLEServerCallbacks
 			// If notifications are already enabled, schedule hello now.
 			if( !g_mtlsHelloSeeded && g_isSubscribed && g_txSubChar != nullptr ) 
 			{
-				mtls_sendHello_B0();          // seeds cached B0 + retry timer (does not send immediately)
+				// protoPass() seeds cached B0 + retry timer (does not send immediately)
+				g_mtlsHelloScheduled = true;
 				g_mtlsHelloSeeded = true;
+				if( g_protoTask ) xTaskNotifyGive( g_protoTask );
 			} else 
 			{
 				// We became secure before subscribe. Remember to send on subscribe later.			
@@ -1036,6 +1117,22 @@ void setup()
 	MediaControl.begin();    // Consumer Control (media keys)
 	
 #endif
+
+	// typing runs in its own task, fed by the protocol task through a report ring
+	hid_emitter_begin( &Keyboard, &MediaControl );
+
+	// RX/MTLS/commands in their own task, off the NimBLE host core;
+	// loop() keeps only the UI
+	if( xTaskCreatePinnedToCore( protoTask, "proto", PROTO_TASK_STACK, nullptr,
+									PROTO_TASK_PRIO, &g_protoTask, PROTO_TASK_CORE ) != pdPASS )
+	{
+		DPRINTLN("[PROTO] task create failed - running from loop()");
+		g_protoTask = nullptr;
+	}
+
+	// ephemeral ECDH keypairs made in the background, so B0 is ready
+	// as soon as a client subscribes
+	mtls_keypool_begin();
 	// just to clean up - comment after
 	//NimBLEDevice::deleteAllBonds();
 
@@ -1188,38 +1285,93 @@ void setup()
 }
 
 ////////////////////////////////////////////////////////////////////
-// Main pump:
-// - long-press reset
-// - process queued RX frame
+// Protocol pass:
+// - MTLS session drop / B0 scheduled by the NimBLE callbacks
+// - send TX chunks still queued (controller was full)
+// - send RX errors from handleWrite()
+// - process queued RX frames (MTLS + commands, HID translation)
 // - mtls_tick() when notifications enabled
-// - LED/UI scheduled actions (blink, PIN, READY, heartbeat)
+// Runs in the protocol task (or from loop() if that didn't start).
 ////////////////////////////////////////////////////////////////////
-void loop() 
+static void protoPass()
 {
-	// check for factory reset
-	pollResetButtonLongPress();
+	// report pacing follows the host profile of the active layout
+	hid_setMinGapUs( hidMinGapUsFor(m_nKeyboardLayout) );
+
+	// keep feeding the HID emitter / send D1 for strings done typing
+	const uint32_t tStall = micros();
+
+	// link dropped / client subscribed on a secure link since
+	if( g_mtlsDropScheduled )
+	{
+		g_mtlsDropScheduled = false;
+		mtls_onDisconnect();
+	}
+	if( g_mtlsHelloScheduled )
+	{
+		g_mtlsHelloScheduled = false;
+		mtls_sendHello_B0();
+	}
+
+	// notifications completed since: queue the next TX chunks
+	if( g_txWaiting ) txDrain();
+
+	send_string_tick();
 
 	////////////////////
 	// :: moved from handleWrite
-    // Process any pending BLE frame outside of NimBLE callbacks
-    if( g_framePending ) 
+    // Process queued BLE frames outside of NimBLE callbacks, a few per
+    // pass (held back while a long SEND_STRING is still being queued,
+    // or an E0 burst waits for room in the HID ring, so nothing can
+    // overtake it)
+    if( g_rxErr )
 	{
-        // avoid races with onWrite()
-        noInterrupts();
-		
-		taskENTER_CRITICAL(&g_frameMux);
-		
-        size_t len = g_frameLen;
-        static uint8_t localBuf[MAX_RX_MESSAGE_LENGTH];
-        memcpy(localBuf, g_frameBuf, len);
-        g_framePending = false;
-		
-		taskEXIT_CRITICAL(&g_frameMux);
-		
-        interrupts();
+        const char* e = g_rxErr;
+        g_rxErr = nullptr;
+        sendFrame(0xFF, (const uint8_t*)e, strlen(e));
+    }
+
+    // link dropped: the rest of the front slot's record is for nobody
+    // (the slot itself stays while SEND_STRING still types from it)
+    if( g_rxLeft && g_rxLink != rx_ring_link() )
+	{
+        g_rxLeft = 0;
+        if( !g_rxHold ) rx_ring_pop();
+    }
+
+    // SEND_STRING types straight from the frame (decrypted in place in
+    // the ring slot) - the slot is released once it's done with it and
+    // no frames of the same record are left. An E0 whose taps don't
+    // all fit in the HID ring holds it the same way, so nothing
+    // overtakes them.
+    if( g_rxHold && !dispatch_busy() )
+	{
+        g_rxHold = false;
+        if( !g_rxLeft ) rx_ring_pop();
+    }
+
+    for( uint8_t i = 0; i < RX_DISPATCH_PER_LOOP && !g_rxHold && !dispatch_busy(); ++i ) 
+	{
+        if( !g_rxLeft )
+		{
+            size_t len = 0;
+            uint8_t* frame = rx_ring_peek(len, &g_rxUs, &g_rxLink);
+            if( !frame ) break;
+
+            // queued before the link dropped: discarded, so its credit
+            // is back before the next client's CA
+            if( g_rxLink != rx_ring_link() )
+			{
+                rx_ring_pop();
+                continue;
+            }
+
+            g_rxCur  = frame;
+            g_rxLeft = len;
+        }
 
-        // dispatch the binaty frame - if case just for debuging
-        if( dispatch_binary_frame(localBuf, len) ) 
+        // dispatch straight from the ring slot, one frame per call
+        if( dispatch_binary_frame(g_rxCur, g_rxLeft, g_rxUs) ) 
 		{
             // frame was consumed (B1/B3/A* or a post-decrypt inner frame)
 			
@@ -1227,7 +1379,22 @@ void loop()
 		{
             // Legacy - just drop the case. it should not get here
         }
+
+        if( dispatch_busy() )  g_rxHold = true;
+        else if( !g_rxLeft )   rx_ring_pop();
     }
+
+	// credit for the frames that left the ring (CA/CB clients only)
+	rx_credit_tick();
+
+	// stall instrumentation: typing used to run inline here and
+	// block the loop for the whole string (~3 ms per character)
+	const uint32_t dtStall = micros() - tStall;
+	if( dtStall > g_loopStallMaxUs )
+	{
+		g_loopStallMaxUs = dtStall;
+		DPRINT("[PROTO] max stall %lu us\n", (unsigned long)dtStall);
+	}
 	
 	// drives B0 retries while not active	
 	//mtls_tick();    
@@ -1237,6 +1404,41 @@ void loop()
         // This is now delayed until the remote app explicitly says it's ready
         mtls_tick();    
     }	
+}
+
+////////////////////////////////////////////////////////////////////
+// Protocol task: sleeps until handleWrite() queues something (or
+// PROTO_IDLE_MS for mtls_tick()); goes again right away while frames
+// are waiting, polls every tick while a string is still being
+// translated/typed or frames are held back. TX chunks waiting for the
+// controller wake it through onStatus(), the tick poll is a fallback.
+////////////////////////////////////////////////////////////////////
+static void protoTask( void* )
+{
+	for( ;; )
+	{
+		protoPass();
+
+		size_t waiting = 0;
+		if( !g_rxHold && !dispatch_busy() && (g_rxLeft || rx_ring_peek(waiting)) ) continue;
+
+		const bool busy = send_string_busy() || g_rxHold || g_rxLeft || !hid_emitter_idle() || g_txWaiting;
+		ulTaskNotifyTake( pdTRUE, busy ? 1 : pdMS_TO_TICKS(PROTO_IDLE_MS) );
+	}
+}
+
+////////////////////////////////////////////////////////////////////
+// Main pump (UI only, the protocol runs in protoTask):
+// - long-press reset
+// - LED/UI scheduled actions (blink, PIN, READY, RECV, heartbeat)
+////////////////////////////////////////////////////////////////////
+void loop() 
+{
+	// check for factory reset
+	pollResetButtonLongPress();
+
+	// protocol task didn't start - do its work here, as before
+	if( !g_protoTask ) protoPass();
 	
 	// When MTLS becomes active, move LED to green (only once)
 	static bool s_ledWasMtls = false;
@@ -1248,6 +1450,19 @@ void loop()
 	}
 	s_ledWasMtls = mtlsNow;	
 	
+	// :: TFT updates asked for by the protocol task (drawing there
+	// would hold up RX/typing for the SPI transfer)
+	if( g_lockedShowScheduled )
+	{
+		g_lockedShowScheduled = false;
+		displayStatus("LOCKED", TFT_RED, true);
+	}
+	if( g_recvDrawScheduled )
+	{
+		g_recvDrawScheduled = false;
+		drawRecv();
+	}
+	
 	// :: led cmds
 	if( g_blinkLedScheduled )
 	{
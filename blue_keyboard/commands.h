@@ -10,11 +10,12 @@
 //
 // RX:
 //   dispatch_binary_frame() consumes one framed message from BLE.
-//   B1/B3 are handed to mtls.cpp (handshake / decrypt) and any decrypted
-//   inner frame is re-dispatched here.
+//   B1/B6/B3 are handed to mtls.cpp (handshake / decrypt) and the decrypted
+//   inner frames (one or more back to back) are dispatched here.
 //
 // Op groups:
 //   A*: AppKey onboarding (A0/A2/A3)   (pre-MTLS)
+//   B4: resumption ticket              (requires MTLS)
 //   C*/D*/E*: app commands             (require MTLS; E0 also needs rawFastMode)
 //
 // MTLS handshake/record layer lives in mtls.cpp.
@@ -29,6 +30,7 @@
 #include <string.h>   
 #include <stddef.h>   
 #include <mbedtls/md.h>
+#include "esp_rom_crc.h"
 
 #include <mbedtls/pkcs5.h>
 #include <mbedtls/version.h> 
@@ -42,6 +44,10 @@
 // locals
 #include "settings.h"
 #include "RawKeyboard.h"
+#include "rx_ring.h"
+#include "tx_queue.h"
+#include "hid_emitter.h"
+#include "mtls.h"                 // MtlsHelloStats (C2)
 #include "layout_kb_profiles.h"   // for KeyboardLayout, layoutName, m_nKeyboardLayout
 
 extern RawKeyboard Keyboard;
@@ -61,7 +67,8 @@ extern bool sendWrappedAppKey(const uint8_t verif32[32], const uint8_t chal16[16
 // MTLS helpers (mtls.cpp)
 extern bool mtls_isActive();
 extern bool mtls_wrapAndSendBytes_B3(const uint8_t* plain, size_t n);
-extern bool mtls_tryConsumeOrDecryptFromBinary(uint8_t op, const uint8_t* p, uint16_t n, std::vector<uint8_t>& outPlain);
+extern bool mtls_wrapAndSendFrame_B3(const uint8_t hdr[3], const uint8_t* payload, uint16_t n);
+extern bool mtls_tryConsumeOrDecryptFromBinary(uint8_t op, uint8_t* p, uint16_t n, uint8_t*& plain, uint16_t& plainLen);
 
 // UI feedback when a string has been typed on the host
 extern void onStringTyped(size_t numBytes);
@@ -117,15 +124,11 @@ static bool sendFrame( uint8_t op, const uint8_t* payload, uint16_t n )
 	// If MTLS is active, wrap header+payload inside a B3 record
 	if( mtls_isActive() )
 	{
-		// MTLS: still send as one plaintext blob inside the encrypted record
-		std::vector<uint8_t> blob;
-		blob.reserve(3 + n);
-		blob.insert(blob.end(), hdr, hdr + 3);
-		if (n) blob.insert(blob.end(), payload, payload + n);
-
+		// MTLS: still send as one plaintext frame inside the encrypted record
+		// (built straight in the record buffer, no temporary copy)
 		DPRINT("[TX][MTLS] op=0x%02X len=%u\n", op, (unsigned)n);
 		
-		return( mtls_wrapAndSendBytes_B3(blob.data(), blob.size()) );
+		return( mtls_wrapAndSendFrame_B3(hdr, payload, n) );
 	
 	} else
 	{
@@ -185,381 +188,1137 @@ static inline bool setLayoutByName(const String& raw)
 	else return false;
 
 	saveLayoutToNVS(m_nKeyboardLayout);
+
+#if BK_LAYOUT_REPORT
+	kbPrintLayoutReport(Serial, m_nKeyboardLayout);
+#endif
 	return( true );
 }
 
 ////////////////////////////////////////////////////////////////////
-// handle_appkey_ops(op,p,n)
+// APPKEY onboarding (pre-MTLS, dispatched through k_ops)
 //
 // A0: issue KDF params + random challenge (reply A2)
 // A3: verify proof (HMAC over "APPKEY"||chal) and return wrapped AppKey
-//
-// Runs pre-MTLS. Returns true if consumed.
 ////////////////////////////////////////////////////////////////////
-static bool handle_appkey_ops(uint8_t op, const uint8_t* p, uint16_t n)
-{
-    // Rate-limit APPKEY onboarding attempts: after too many failed proofs
-    // in this boot, block further GET_APPKEY / APPKEY_PROOF handling.
-    if( (op == 0xA0 || op == 0xA3) && g_appkey_fail_count >= APPKEY_FAIL_LIMIT ) 
-    {
-        const char* msg = "GET_APPKEY blocked";
-        sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
-        return( true );
-    }	
+
+// Rate-limit APPKEY onboarding attempts: after too many failed proofs
+// in this boot, block further GET_APPKEY / APPKEY_PROOF handling.
+static bool appkey_blocked()
+{
+	if( g_appkey_fail_count < APPKEY_FAIL_LIMIT ) return( false );
+
+	const char* msg = "GET_APPKEY blocked";
+	sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
+	return( true );
+}
+
+// :: GET_APPKEY (0xA0) — request KDF params + challenge
+static void op_getAppKey( const uint8_t* p, uint16_t n )
+{
+	(void)p; (void)n;
+	if( appkey_blocked() ) return;
+
+	// Strict single-app / single-device mode:
+	// If the AppKey was already provisioned AND both multi flags are disabled,
+	// reject further provisioning attempts and require factory reset.
+	bool allowMultiApp = getAllowMultiAppProvisioning();
+	bool allowMultiDev = getAllowMultiDevicePairing();
+
+	if( isAppKeyMarkedSet() && !allowMultiApp && !allowMultiDev )
+	{
+		const char* msg = "LOCKED_SINGLE_NEED_RESET";
+		sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
+		return;
+	}
+
+	uint8_t salt16[16], verif32[32]; uint32_t iters=0;
+	if( !loadPwKdf(salt16, verif32, &iters) ) 
+	{
+	  const char* msg = "KDF missing";
+	  sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
+	  return;
+	}
+
+	for( int i=0; i<16; i++ ) g_appkey_chal[i] = (uint8_t)esp_random();
+	g_appkey_chal_pending = true;
+
+	uint8_t pay[16 + 4 + 16];
+	memcpy(pay, salt16, 16);
+	pay[16] = (uint8_t)(iters & 0xFF);
+	pay[17] = (uint8_t)((iters >> 8) & 0xFF);
+	pay[18] = (uint8_t)((iters >> 16) & 0xFF);
+	pay[19] = (uint8_t)((iters >> 24) & 0xFF);
+	memcpy(pay + 20, g_appkey_chal, 16);
+
+	DPRINT("[APPKEY] chal issued: iters=%u\n", (unsigned)iters);
+	sendFrame( 0xA2, pay, sizeof(pay) ); // APPKEY_CHALLENGE
+}
+
+// :: APPKEY_PROOF (0xA3) — client proves knowledge of setup password
+//      payload = MAC32 = HMAC(verif32, "APPKEY"||chal16)
+static void op_appKeyProof( const uint8_t* p, uint16_t n )
+{
+	(void)n;
+	if( appkey_blocked() ) return;
+
+	// Basic sanity: must have outstanding challenge (size checked by k_ops)
+	if( !g_appkey_chal_pending ) 
+	{
+		const char* msg = "no pending chal or bad mac size";
+		sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
+		g_appkey_chal_pending = false;
+		
+		return;
+	}
+
+	uint8_t salt16[16], verif32[32]; uint32_t iters = 0;
+	if( !loadPwKdf(salt16, verif32, &iters) ) 
+	{
+		const char* msg = "KDF missing";
+		sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
+		g_appkey_chal_pending = false;
+		return;
+	}
+
+	// Build message once (no duplicate declarations)
+	uint8_t msgbuf[6 + 16];
+	memcpy(msgbuf, "APPKEY", 6);
+	memcpy(msgbuf + 6, g_appkey_chal, 16);
+
+	uint8_t expect[32];
+	if( !hmac_sha256(verif32, 32, msgbuf, sizeof(msgbuf), expect) ) 
+	{
+		const char* e = "HMAC fail";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+		g_appkey_chal_pending = false;
+		return;
+	}
+
+	if( memcmp(expect, p, 32) != 0 ) 
+	{
+		DPRINTLN("[APPKEY] proof BAD");
+		g_appkey_fail_count++;
+		const char* e = "bad proof";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+		g_appkey_chal_pending = false;
+		return;
+	}
+
+	// OK - send wrapped appkey (opaque to passive sniffers)
+	DPRINTLN("[APPKEY] proof OK - returning wrapped APPKEY");
+	
+	// verif32 and g_appkey_chal are in scope
+	bool okWrap = sendWrappedAppKey(verif32, g_appkey_chal);
+	// zero challenge and pending flag regardless
+	memset(g_appkey_chal, 0, sizeof(g_appkey_chal));
+	g_appkey_chal_pending = false;
+	// reset failure counter on success
+	g_appkey_fail_count = 0;  
 	
-	// :: GET_APPKEY (0xA0) — request KDF params + challenge
-	if( op == 0xA0 ) 
-	{ 
-		// Strict single-app / single-device mode:
-		// If the AppKey was already provisioned AND both multi flags are disabled,
-		// reject further provisioning attempts and require factory reset.
-		bool allowMultiApp = getAllowMultiAppProvisioning();
-		bool allowMultiDev = getAllowMultiDevicePairing();
-
-		if( isAppKeyMarkedSet() && !allowMultiApp && !allowMultiDev )
+	if( !okWrap ) 
+	{
+		const char* e = "send fail";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+	}
+}
+
+////////////////////////////////////////////////////////////////////
+// SEND_STRING jobs
+//
+// D0 only queues the text. send_string_tick() (called from the protocol task)
+// translates it into HID reports while the emitter ring has room and
+// then queues a JOB_END marker. Typing itself happens in the HID
+// emitter task (hid_emitter.h), so the protocol task keeps serving BLE/MTLS.
+// When the task reaches the marker the string has been typed and the
+// D1 result (status + md5) is sent, same contract as before.
+//
+// Streamed strings (D2 begin / D3 chunk / D4 end) use the same job:
+// each chunk is translated as soon as it arrives, UTF-8 is decoded
+// byte by byte (sequences may be split across chunks) and the MD5 is
+// updated per chunk. D0 is just open + one chunk + close.
+//
+// D5 (pre-translated keys) is the same job again, but the payload is
+// already HID: (mods, usage) pairs played through the packed typing
+// path, and escapes for codepoints the host left to the dongle.
+//
+// While a chunk is still being translated (ring full) the protocol task holds
+// back the next RX frame so later commands (E0, the next chunk/D0)
+// can't overtake it. E0 taps that don't fit in the ring at once hold
+// it the same way.
+//
+// The chunk is not copied: s_ssBuf points into the RX frame (the ring
+// slot, see rx_ring.h) and the protocol task only releases that slot once
+// send_string_busy() is false. Callers of send_string_append() keep
+// the bytes valid until then.
+//
+// Ack options (C9, per link, off by default so older apps see no change):
+//   SEND_ACK_PROGRESS : D6 = [bytes typed u32le][CRC32 of them u32le]
+//                       every SEND_PROGRESS_BYTES, at most every
+//                       SEND_PROGRESS_MS, while a string is being typed
+//   SEND_ACK_CRC32    : D1 = [status][CRC32 u32le] instead of the MD5
+// Progress is tracked with marks on the emitter op counters: a mark
+// records how many ops were queued when its byte count was reached,
+// and is passed once the task has sent that many.
+////////////////////////////////////////////////////////////////////
+#define SEND_STRING_MAX_PENDING 8
+
+#define SEND_ACK_PROGRESS   0x01
+#define SEND_ACK_CRC32      0x02
+
+#define SEND_PROGRESS_BYTES 256
+#define SEND_PROGRESS_MS    250
+#define SEND_PROGRESS_MARKS 8
+
+struct SendStringAck
+{
+	uint8_t  md5[16];
+	uint32_t crc;
+	size_t   len;
+	uint8_t  mode;      // SEND_ACK_* at the time the string was queued
+	bool     notify;    // false once the link that sent it is gone
+};
+
+struct SendProgressMark
+{
+	uint32_t opIndex;   // hid_emitter_pushed() when the mark was taken
+	uint32_t bytes;
+	uint32_t crc;
+};
+
+static SendStringAck              s_ssAcks[SEND_STRING_MAX_PENDING];
+static uint8_t                    s_ssAckHead   = 0;
+static uint8_t                    s_ssAckCount  = 0;
+static const uint8_t*             s_ssBuf       = nullptr;   // chunk being translated (caller's frame)
+static uint16_t                   s_ssBufLen    = 0;
+static uint16_t                   s_ssBufPos    = 0;
+static Utf8Stream                 s_ssUtf8;
+static bool                       s_ssOpen      = false;   // string accepts chunks
+static bool                       s_ssClosing   = false;   // closed, JOB_END not queued yet
+static bool                       s_ssStop      = false;   // NUL seen, rest is not typed
+static bool                       s_ssKeys      = false;   // D5 key tokens instead of UTF-8
+static SendStringAck*             s_ssOpenAck   = nullptr;
+static SendStringAck*             s_ssJobAck    = nullptr;   // string being translated
+static uint8_t                    s_ssAckMode   = 0;         // SEND_ACK_* set by C9
+static uint32_t                   s_ssRunBytes  = 0;         // bytes translated so far
+static uint32_t                   s_ssRunCrc    = 0;
+static SendProgressMark           s_ssMarks[SEND_PROGRESS_MARKS];
+static uint8_t                    s_ssMarkHead  = 0;
+static uint8_t                    s_ssMarkCount = 0;
+static uint32_t                   s_ssProgressMs = 0;
+static mbedtls_md_context_t       s_ssMd5;
+static bool                       s_ssMd5Ready  = false;
+static uint32_t                   s_ssJobsQueued = 0;      // JOB_END markers queued
+static uint32_t                   s_ssJobsAcked  = 0;
+static volatile bool              s_ssDropAcks   = false;
+
+// true while the current chunk is not fully queued yet
+static inline bool send_string_busy() { return( s_ssBufPos < s_ssBufLen || s_ssClosing ); }
+
+// link dropped: what's queued still gets typed, but no D1 goes out
+static inline void send_string_dropAcks() { s_ssDropAcks = true; }
+
+// E0 taps not queued yet: a repeat can be more than the HID ring takes
+// at once, send_string_tick() queues the rest as the emitter drains.
+// sendRaw() may release the packed typing keys first, then press +
+// release (a consumer usage takes fewer).
+#define E0_OPS_PER_TAP 3
+
+static uint8_t s_tapMods  = 0;
+static uint8_t s_tapUsage = 0;
+static uint8_t s_tapLeft  = 0;
+
+static void raw_tap_tick()
+{
+	while( s_tapLeft && hid_emitter_space() >= E0_OPS_PER_TAP )
+	{
+		Keyboard.sendRaw(s_tapMods, s_tapUsage);
+		s_tapLeft--;
+	}
+}
+
+// true while the front RX slot can't move on: the current chunk or an
+// E0's taps still wait for room in the HID ring, or the ring is full
+// (the next OPS_HID frame's latency stamp needs a slot)
+static inline bool dispatch_busy() { return( send_string_busy() || s_tapLeft != 0 || !hid_emitter_space() ); }
+
+static inline void wr32le( uint8_t* p, uint32_t v )
+{
+	p[0]=(uint8_t)v; p[1]=(uint8_t)(v>>8); p[2]=(uint8_t)(v>>16); p[3]=(uint8_t)(v>>24);
+}
+
+// account n translated payload bytes (running CRC, progress marks)
+static void send_string_progress( const uint8_t* p, uint16_t n )
+{
+	s_ssRunCrc = esp_rom_crc32_le(s_ssRunCrc, p, n);
+
+	const uint32_t before = s_ssRunBytes;
+	s_ssRunBytes += n;
+
+	if( !s_ssJobAck || !s_ssJobAck->notify || !(s_ssJobAck->mode & SEND_ACK_PROGRESS) ) return;
+	if( !hid_emitter_isRunning() ) return;
+	if( before / SEND_PROGRESS_BYTES == s_ssRunBytes / SEND_PROGRESS_BYTES ) return;
+	if( s_ssMarkCount >= SEND_PROGRESS_MARKS ) return;
+
+	SendProgressMark& m = s_ssMarks[(s_ssMarkHead + s_ssMarkCount) % SEND_PROGRESS_MARKS];
+	m.opIndex = hid_emitter_pushed();
+	m.bytes   = s_ssRunBytes;
+	m.crc     = s_ssRunCrc;
+	s_ssMarkCount++;
+}
+
+static void send_string_typeCps( const uint32_t* cps, uint8_t k )
+{
+	for( uint8_t i = 0; i < k && !s_ssStop; ++i )
+	{
+		if( !cps[i] ) { s_ssStop = true; break; }
+		(void)sendCodepointMapped(Keyboard, cps[i]);
+	}
+}
+
+////////////////////////////////////////////////////////////////////
+// D5 key tokens:
+//   [mods][usage]             usage != 0: one key, packed typing
+//   [0x00][0x00][cp 3 bytes]  codepoint (LE) the host could not map;
+//                             dongle types it (dead key / OS input)
+////////////////////////////////////////////////////////////////////
+#define SEND_KEYS_ESC_LEN 5
+
+// whole payload must be well formed before anything is typed
+static bool send_keys_valid( const uint8_t* p, uint16_t n )
+{
+	uint16_t i = 0;
+	while( i < n )
+	{
+		if( n - i < 2 ) return( false );
+		if( p[i+1] ) { i += 2; continue; }
+
+		if( p[i] || n - i < SEND_KEYS_ESC_LEN ) return( false );
+		i += SEND_KEYS_ESC_LEN;
+	}
+	return( true );
+}
+
+// play one token, returns its length
+static uint8_t send_keys_play( const uint8_t* t )
+{
+	if( t[1] )
+	{
+		Keyboard.typeUsage(t[0], t[1]);
+		return( 2 );
+	}
+
+	const uint32_t cp = (uint32_t)t[2] | ((uint32_t)t[3] << 8) | ((uint32_t)t[4] << 16);
+	(void)sendCodepointMapped(Keyboard, cp);
+	return( SEND_KEYS_ESC_LEN );
+}
+
+static void send_string_tick()
+{
+	if( s_ssDropAcks )
+	{
+		s_ssDropAcks = false;
+		for( uint8_t i = 0; i < SEND_STRING_MAX_PENDING; ++i ) s_ssAcks[i].notify = false;
+
+		// a stream cut off mid-way: type what arrived and end it
+		if( s_ssOpen )
 		{
-			const char* msg = "LOCKED_SINGLE_NEED_RESET";
-			sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
-			return( true );
+			s_ssOpen    = false;
+			s_ssClosing = true;
+			s_ssOpenAck = nullptr;
 		}
 
-		uint8_t salt16[16], verif32[32]; uint32_t iters=0;
-		if( !loadPwKdf(salt16, verif32, &iters) ) 
+		// ack options belong to the link
+		s_ssAckMode   = 0;
+		s_ssMarkCount = 0;
+	}
+
+	// :: taps of an E0 that didn't fit at once (it came in first)
+	raw_tap_tick();
+
+	// :: translate as much of the current chunk as the ring can take
+	// (one byte can give up to UTF8_STREAM_MAX_CP codepoints)
+	while( s_ssBufPos < s_ssBufLen && hid_emitter_space() >= UTF8_STREAM_MAX_CP * HID_MAX_OPS_PER_CP )
+	{
+		const uint16_t at = s_ssBufPos;
+		if( s_ssKeys )
 		{
-		  const char* msg = "KDF missing";
-		  sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
-		  return( true );
+			s_ssBufPos += send_keys_play(&s_ssBuf[at]);
+
+		} else
+		{
+			uint32_t cps[UTF8_STREAM_MAX_CP];
+			const uint8_t k = utf8StreamFeed(s_ssUtf8, s_ssBuf[s_ssBufPos++], cps);
+			send_string_typeCps(cps, k);
 		}
+		send_string_progress(&s_ssBuf[at], (uint16_t)(s_ssBufPos - at));
+	}
 
-		for( int i=0; i<16; i++ ) g_appkey_chal[i] = (uint8_t)esp_random();
-		g_appkey_chal_pending = true;
+	// :: chunk used up. With the string still open the next one can be
+	// a while (BLE): let go of the keys, or the host auto-repeats the
+	// last one. Closing releases them below.
+	if( s_ssBuf && s_ssBufPos >= s_ssBufLen && (!s_ssOpen || hid_emitter_space() >= 1) )
+	{
+		if( s_ssOpen ) Keyboard.typeRelease();
 
-		uint8_t pay[16 + 4 + 16];
-		memcpy(pay, salt16, 16);
-		pay[16] = (uint8_t)(iters & 0xFF);
-		pay[17] = (uint8_t)((iters >> 8) & 0xFF);
-		pay[18] = (uint8_t)((iters >> 16) & 0xFF);
-		pay[19] = (uint8_t)((iters >> 24) & 0xFF);
-		memcpy(pay + 20, g_appkey_chal, 16);
+		s_ssBuf = nullptr;
+		s_ssBufLen = s_ssBufPos = 0;
+	}
 
-		DPRINT("[APPKEY] chal issued: iters=%u\n", (unsigned)iters);
-		sendFrame( 0xA2, pay, sizeof(pay) ); // APPKEY_CHALLENGE
-		
-		return( true );
+	// :: string complete - flush the decoder and mark the job end
+	if( s_ssClosing && !s_ssBuf && hid_emitter_space() >= UTF8_STREAM_MAX_CP * HID_MAX_OPS_PER_CP )
+	{
+		uint32_t cps[UTF8_STREAM_MAX_CP];
+		const uint8_t k = utf8StreamFlush(s_ssUtf8, cps);
+		send_string_typeCps(cps, k);
+
+		Keyboard.typeRelease();
+
+		HidOp end = {};
+		end.type = HIDOP_JOB_END;
+		(void)hid_emitter_push(end);
+		s_ssJobsQueued++;
+
+		// CRC over everything translated = whole payload
+		if( s_ssJobAck ) s_ssJobAck->crc = s_ssRunCrc;
+		s_ssJobAck  = nullptr;
+		s_ssClosing = false;
+		s_ssStop    = false;
 	}
 
-	// :: APPKEY_PROOF (0xA3) — client proves knowledge of setup password
-	//      payload = MAC32 = HMAC(verif32, "APPKEY"||chal16)
-	if( op == 0xA3 )
+	// :: progress (D6) for the string being typed
+	if( s_ssMarkCount )
 	{
-		 // Basic sanity: must have outstanding challenge and correct size
-		if( !g_appkey_chal_pending || n != 32 ) 
+		const uint32_t popped = hid_emitter_popped();
+		SendProgressMark mark = {};
+		bool passed = false;
+		while( s_ssMarkCount && (int32_t)(popped - s_ssMarks[s_ssMarkHead].opIndex) >= 0 )
 		{
-			const char* msg = "no pending chal or bad mac size";
-			sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
-			g_appkey_chal_pending = false;
-			
-			return( true );
+			mark = s_ssMarks[s_ssMarkHead];
+			passed = true;
+			s_ssMarkHead = (uint8_t)((s_ssMarkHead + 1) % SEND_PROGRESS_MARKS);
+			s_ssMarkCount--;
 		}
 
-		uint8_t salt16[16], verif32[32]; uint32_t iters = 0;
-		if( !loadPwKdf(salt16, verif32, &iters) ) 
+		if( passed && (millis() - s_ssProgressMs) >= SEND_PROGRESS_MS )
 		{
-			const char* msg = "KDF missing";
-			sendFrame(0xFF, (const uint8_t*)msg, (uint16_t)strlen(msg));
-			g_appkey_chal_pending = false;
-			return( true );
+			s_ssProgressMs = millis();
+
+			uint8_t out[8];
+			wr32le(out, mark.bytes);
+			wr32le(out+4, mark.crc);
+			sendFrame(0xD6, out, sizeof(out)); // SEND_PROGRESS
 		}
+	}
+
+	// :: results for strings the emitter has finished typing
+	// (no emitter task: everything was typed synchronously above)
+	const uint32_t done = hid_emitter_isRunning() ? hid_emitter_jobsDone() : s_ssJobsQueued;
+	while( s_ssJobsAcked != done && s_ssAckCount )
+	{
+		SendStringAck& a = s_ssAcks[s_ssAckHead];
 
-		// Build message once (no duplicate declarations)
-		uint8_t msgbuf[6 + 16];
-		memcpy(msgbuf, "APPKEY", 6);
-		memcpy(msgbuf + 6, g_appkey_chal, 16);
+		// UI feedback - string was typed
+		onStringTyped( a.len );
 
-		uint8_t expect[32];
-		if( !hmac_sha256(verif32, 32, msgbuf, sizeof(msgbuf), expect) ) 
+		if( a.notify && (a.mode & SEND_ACK_CRC32) )
 		{
-			const char* e = "HMAC fail";
-			sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
-			g_appkey_chal_pending = false;
-			return( true );
-		}
+			uint8_t out[1+4];
+			out[0]=0; 							// status = 0 (OK)
+			wr32le(out+1, a.crc);
+			sendFrame(0xD1, out, sizeof(out)); // SEND_RESULT (short)
 
-		if( memcmp(expect, p, 32) != 0 ) 
+		} else if( a.notify )
 		{
-			DPRINTLN("[APPKEY] proof BAD");
-			g_appkey_fail_count++;
-			const char* e = "bad proof";
-			sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
-			g_appkey_chal_pending = false;
-			return( true );
+			uint8_t out[1+16];
+			out[0]=0; 							// status = 0 (OK)
+			memcpy(out+1, a.md5, 16);
+			sendFrame(0xD1, out, sizeof(out)); // SEND_RESULT
 		}
 
-		// OK - send wrapped appkey (opaque to passive sniffers)
-		DPRINTLN("[APPKEY] proof OK - returning wrapped APPKEY");
-		
-		// verif32 and g_appkey_chal are in scope
-		bool okWrap = sendWrappedAppKey(verif32, g_appkey_chal);
-		// zero challenge and pending flag regardless
-		memset(g_appkey_chal, 0, sizeof(g_appkey_chal));
-		g_appkey_chal_pending = false;
-		// reset failure counter on success
-		g_appkey_fail_count = 0;  
-		
-		if( !okWrap ) 
-		{
-			const char* e = "send fail";
-			sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
-		}
-		
-		return( true );	  
+		s_ssAckHead = (uint8_t)((s_ssAckHead + 1) % SEND_STRING_MAX_PENDING);
+		s_ssAckCount--;
+		s_ssJobsAcked++;
+
+		HidPaceStats st;
+		hid_getPaceStats(st);
+		DPRINT("[HID] reports=%lu waits=%lu wait=%lu us send=%lu us timeouts=%lu overruns=%lu\n",
+				(unsigned long)st.reports, (unsigned long)st.waits, (unsigned long)st.waitUs,
+				(unsigned long)st.sendUs, (unsigned long)st.timeouts, (unsigned long)st.overruns);
 	}
+}
 
-	// Not an APPKEY opcode
-	return( false ); 
+// Start a new string. False if one is still open/being translated or
+// too many results are outstanding.
+static bool send_string_open( bool keys = false )
+{
+	if( s_ssOpen || send_string_busy() || s_ssAckCount >= SEND_STRING_MAX_PENDING ) return( false );
+
+	if( !s_ssMd5Ready )
+	{
+		mbedtls_md_init(&s_ssMd5);
+		if( mbedtls_md_setup(&s_ssMd5, mbedtls_md_info_from_type(MBEDTLS_MD_MD5), 0) != 0 ) return( false );
+		s_ssMd5Ready = true;
+	}
+	s_ssOpenAck = &s_ssAcks[(s_ssAckHead + s_ssAckCount) % SEND_STRING_MAX_PENDING];
+	s_ssOpenAck->len    = 0;
+	s_ssOpenAck->crc    = 0;
+	s_ssOpenAck->mode   = s_ssAckMode;
+	s_ssOpenAck->notify = true;
+	s_ssAckCount++;
+
+	// no MD5 needed when the result carries the CRC
+	if( !(s_ssAckMode & SEND_ACK_CRC32) ) mbedtls_md_starts(&s_ssMd5);
+
+	// previous string is fully translated (not busy), this one is next
+	s_ssJobAck   = s_ssOpenAck;
+	s_ssRunBytes = 0;
+	s_ssRunCrc   = 0;
+
+	s_ssUtf8 = Utf8Stream();
+	s_ssStop = false;
+	s_ssKeys = keys;
+	s_ssOpen = true;
+	return( true );
+}
+
+// Add a chunk to the open string and start typing it right away.
+// MD5 covers the exact payload bytes, no trimming.
+static bool send_string_append( const uint8_t* p, uint16_t n )
+{
+	if( !s_ssOpen || send_string_busy() ) return( false );
+
+	if( !(s_ssOpenAck->mode & SEND_ACK_CRC32) ) mbedtls_md_update(&s_ssMd5, p, n);
+	s_ssOpenAck->len += n;
+
+	if( n )
+	{
+		// translated straight from the frame, see above
+		s_ssBuf    = p;
+		s_ssBufLen = n;
+		s_ssBufPos = 0;
+	}
+
+	send_string_tick();
+	return( true );
+}
+
+// Last chunk received: D1 goes out once everything is typed
+static bool send_string_close()
+{
+	if( !s_ssOpen ) return( false );
+
+	if( !(s_ssOpenAck->mode & SEND_ACK_CRC32) ) mbedtls_md_finish(&s_ssMd5, s_ssOpenAck->md5);
+	s_ssOpenAck = nullptr;
+	s_ssOpen    = false;
+	s_ssClosing = true;
+
+	send_string_tick();
+	return( true );
+}
+
+// Queue a whole string for typing (D0), or key tokens (D5)
+static bool send_string_begin( const uint8_t* p, uint16_t n, bool keys = false )
+{
+	if( !send_string_open(keys) ) return( false );
+
+	(void)send_string_append(p, n);
+	(void)send_string_close();
+	return( true );
 }
 
 ////////////////////////////////////////////////////////////////////
-// handle_mtls_ops(op,p,n)
+// RX credit flow control (CA/CB)
+//
+// Off by default, so older apps see no change (they get "busy" when
+// the RX ring is full). CA turns it on for the link and is answered
+// with CB = [limit u32le][overhead u16le][max frame u16le]: the client
+// may keep writing frames as long as their total cost, counted from
+// (and including) the CA record, stays within limit. A frame costs
+// its length + overhead (RX_CREDIT_OVERHEAD), so the client never has
+// more than RX_CREDIT_WINDOW in the ring and pipelines without drops.
+//
+// As frames leave the ring rx_credit_tick() sends CB = [limit u32le]
+// with the new limit. Limits are cumulative (wrap at 2^32), a lost or
+// late grant only delays the client. Grants are coalesced: sent once a
+// quarter window is free again, or when the ring has drained.
+////////////////////////////////////////////////////////////////////
+static bool          s_crOn   = false;
+static uint32_t      s_crBase = 0;    // rx_ring_creditFreed() when CA came in
+static uint32_t      s_crSent = 0;    // last limit sent
+static volatile bool s_crDrop = false;
+
+// link dropped (NimBLE task): credit mode ends with it
+static inline void rx_credit_dropLink() { s_crDrop = true; }
+
+static inline uint32_t rx_credit_limit()
+{
+	return( rx_ring_creditFreed() - s_crBase + RX_CREDIT_WINDOW );
+}
+
+[[maybe_unused]] static void rx_credit_tick()
+{
+	if( s_crDrop || (s_crOn && !mtls_isActive()) )
+	{
+		s_crDrop = false;
+		s_crOn   = false;
+	}
+	if( !s_crOn ) return;
+
+	const uint32_t limit = rx_credit_limit();
+	if( limit == s_crSent ) return;
+
+	size_t len = 0;
+	if( limit - s_crSent < RX_CREDIT_WINDOW / 4 && rx_ring_peek(len) ) return;
+
+	uint8_t out[4];
+	wr32le(out, limit);
+	if( sendFrame(0xCB, out, sizeof(out)) ) s_crSent = limit;
+}
+
+////////////////////////////////////////////////////////////////////
+// App op handlers (MTLS session required, dispatched through k_ops)
 //
-// Requires mtls_isActive().
 // C0: set layout
 // C1: get info (reply C2)
 // C4: clear AppKey/setup (factory-unlock)
-// D0: type UTF-8 string (reply D1 = status + MD5(payload))
+// C5: get per-opcode stats (reply C6)
+// D0: type UTF-8 string (reply D1 = status + MD5(payload), once typed)
+// D2: begin streamed string (ACK)
+// D3: string chunk, any split of the UTF-8 bytes (ACK once accepted)
+// D4: end streamed string (reply D1 = status + MD5(all chunks), once typed)
+// D5: type pre-translated key tokens (reply D1 = status + MD5(payload), once typed)
+// C9: set ack mode for strings (D6 progress, CRC32 instead of MD5 in D1)
+// CA: RX credit flow control on/off (reply CB when on, else ACK)
 // C8: toggle raw fast mode
 // E0: raw key tap (only when raw fast mode enabled; no ACK)
 //
+// Session state and payload length are checked by op_dispatch()
+// before a handler runs.
 ////////////////////////////////////////////////////////////////////
-static bool handle_mtls_ops( uint8_t op, const uint8_t* p, uint16_t n )
+// :: SET_LAYOUT (0xC0)
+static void op_setLayout( const uint8_t* p, uint16_t n )
 {
-	// :: SET_LAYOUT (0xC0)
-	if( op == 0xC0 ) 
-	{ 
-        // Payload is an ASCII name, not necessarily NUL-terminated.
-		// We copy into a temporary buffer and trim, then delegate to setLayoutByName().
-		std::unique_ptr<char[]> tmp(new char[n+1]);
-		memcpy(tmp.get(), p, n); tmp[n] = 0;
+    // Payload is an ASCII name, not necessarily NUL-terminated.
+	// We copy into a temporary buffer and trim, then delegate to setLayoutByName().
+	std::unique_ptr<char[]> tmp(new char[n+1]);
+	memcpy(tmp.get(), p, n); tmp[n] = 0;
 
-		String name = String(tmp.get());
-		name.trim();
+	String name = String(tmp.get());
+	name.trim();
 
-		bool ok = setLayoutByName(name);
-		DPRINT("[LAYOUT] set by name '%s' -> %d\n", name.c_str(), ok ? 1 : 0);
+	bool ok = setLayoutByName(name);
+	DPRINT("[LAYOUT] set by name '%s' -> %d\n", name.c_str(), ok ? 1 : 0);
+	
+	if( ok ) 
+	{
+		// ACK_OK
+		sendFrame(0x00, nullptr, 0);
 		
-		if( ok ) 
-		{
-			// ACK_OK
-			sendFrame(0x00, nullptr, 0);
-			
-		} else 
-		{
-			const char* e = "bad layout";
-			sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
-		}
-		return( true );
-	}
-
-	// :: GET_INFO (0xC1)
-	// Replies with 0xC2 = INFO_VALUE containing a short ASCII summary:
-	// "LAYOUT=<SHORT>; PROTO=<PROTO_VER>; FW=<FW_VER>"
-	if( op == 0xC1 )
-	{ 
-		// Build "LAYOUT=UK_WINLIN; PROTO=1.2; FW=1.1.1" as ASCII payload
-		String s = "LAYOUT=";
-
-        // layoutName(...) returns strings like "LAYOUT_UK_WINLIN";
-        // strip the "LAYOUT_" prefix if present.}
-		const char* full = layoutName(m_nKeyboardLayout); 
-		const char* shortName = (strncmp(full, "LAYOUT_", 7)==0) ? (full+7) : full;
-		s += shortName;
-		s += "; PROTO=" PROTO_VER "; FW=" FW_VER;
-
-		// Send inside MTLS using standard frame: [0xC2][LEN][BYTES]
-		sendFrame(0xC2, reinterpret_cast<const uint8_t*>(s.c_str()), (uint16_t)s.length());
-		return( true );
-	}
-  
-    // :: RESET_TO_DEFAULT (0xC4)
-	if( op == 0xC4 ) 
-	{ 
-		DPRINTLN("[RESET] clear appkey+setup");
-		clearAppKeyAndFlag();
-		sendFrame(0x00, nullptr, 0); // ACK_OK
-		return( true );
+	} else 
+	{
+		const char* e = "bad layout";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
 	}
-	
-    // :: SEND_STRING (0xD0)
-    // Types arbitrary UTF-8 text received from the app.
-	if( op == 0xD0 ) 
-	{ 
-		// Make a NUL-terminated copy for sendUnicodeAware(...)
-		std::unique_ptr<char[]> tmp(new char[n+1]);
-		memcpy(tmp.get(), p, n); tmp[n]=0;
+}
 
-		// Type it via RawKeyboard + layout-aware helper
-		sendUnicodeAware(Keyboard, tmp.get());
+// :: GET_INFO (0xC1)
+// Replies with 0xC2 = INFO_VALUE containing a short ASCII summary:
+// "LAYOUT=<SHORT>; PROTO=<PROTO_VER>; FW=<FW_VER>; RXDROP=<n>; RXHW=<n>"
+// RXDROP = frames dropped (RX ring full), RXHW = most frames queued.
+// Then "; B0US=<n>; B0POOL=<hits>/<n>": last B0 preparation time (us)
+// and how many B0s got a pre-generated keypair, and "; REC=<CTR|GCM>;
+// SEQ=<16|32|64>; KEYUPD=<n>": record mode, sequence number width and
+// key updates so far of this session, and "; TXHW=<n>; TXDROP=<n>;
+// TXBUSY=<n>": most notification chunks queued, frames dropped (TX
+// queue full) and notify() calls the controller had no buffer for.
+static void op_getInfo( const uint8_t* p, uint16_t n )
+{
+	(void)p; (void)n;
 
-		// UI feedback - string was typed
-		onStringTyped( n );
+	// Build "LAYOUT=UK_WINLIN; PROTO=1.2; FW=1.1.1" as ASCII payload
+	String s = "LAYOUT=";
 
-		 // Compute MD5 over the exact payload bytes, no trimming.
-		uint8_t md5[16]; 
-		md5_of(p, n, md5);
+    // layoutName(...) returns strings like "LAYOUT_UK_WINLIN";
+    // strip the "LAYOUT_" prefix if present.}
+	const char* full = layoutName(m_nKeyboardLayout); 
+	const char* shortName = (strncmp(full, "LAYOUT_", 7)==0) ? (full+7) : full;
+	s += shortName;
+	s += "; PROTO=" PROTO_VER "; FW=" FW_VER;
 
-		uint8_t out[1+16]; 
-		out[0]=0; 							// status = 0 (OK)
-		memcpy(out+1, md5, 16);
-		sendFrame(0xD1, out, sizeof(out)); // SEND_RESULT
-		
-		return( true );
-	}
-
-    // :: SET_RAW_FAST_MODE (0xC8)
-    // payload: [mode1]
-    //   mode1 = 0x00 - disable raw fast mode
-    //   mode1 = 0x01 - enable raw fast mode
-    if( op == 0xC8 )
-    {
-        if( n != 1 )
-        {
-            const char* e = "bad len";
-            sendFrame( 0xFF, (const uint8_t*)e, (uint16_t)strlen(e) );
-            return( true );
-        }
-
-        uint8_t mode = p[0];
-        g_rawFastMode = (mode != 0);
-
-        DPRINT("[RAW] fast_mode=%d\n", g_rawFastMode ? 1 : 0);
-
-        // ACK_OK, no extra payload
-        sendFrame(0x00, nullptr, 0);
-        return( true );
-    }
-
-	// :: RAW_KEY_TAP (0xE0)
-	// Fast-path: send a single HID usage (mods + usage), no MD5, no ACK.
-	// Only honored when g_rawFastMode == true.
-	// Payload:
-	//    [mods1][usage1]            (len = 2)
-	// or [mods1][usage1][repeat1]   (len = 3)
-	if( op == 0xE0 )
-	{
-		// we only accept this if raw mode is enabled
-		if( !g_rawFastMode )
-		{
-			// Raw mode not enabled - treat as error but still consume.
-			const char* e = "raw off";
-			sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
-			return true;
-		}
+	RxRingStats rx;
+	rx_ring_getStats(rx);
+	s += "; RXDROP="; s += String((unsigned long)rx.drops);
+	s += "; RXHW=";   s += String((unsigned)rx.hwFrames);
 
-		if( n < 2 )
-		{
-			const char* e = "bad len";
-			sendFrame( 0xFF, (const uint8_t*)e, (uint16_t)strlen(e) );
-			return true;
-		}
+	MtlsHelloStats hs;
+	mtls_getHelloStats(hs);
+	s += "; B0US=";   s += String((unsigned long)hs.lastUs);
+	s += "; B0POOL="; s += String((unsigned long)hs.poolHits);
+	s += "/";         s += String((unsigned long)hs.hellos);
+	s += "; REC=";    s += (mtls_recMode() == MTLS_REC_GCM) ? "GCM" : "CTR";
+	s += "; SEQ=";    s += String((unsigned)mtls_recSeqBits());
+	s += "; KEYUPD="; s += String((unsigned long)mtls_keyUpdates());
 
-		uint8_t mods   = p[0];
-		uint8_t usage  = p[1];
-		uint8_t repeat = (n >= 3 && p[2] != 0) ? p[2] : 1;
+	TxQueueStats tx;
+	tx_queue_getStats(tx);
+	s += "; TXHW=";   s += String((unsigned)tx.hwChunks);
+	s += "; TXDROP="; s += String((unsigned long)tx.drops);
+	s += "; TXBUSY="; s += String((unsigned long)tx.busy);
 
-		// by layout type:
-		//  - If a TV layout is selected (layout id >= BK_TV_LAYOUT_BASE), remap the
-		//    standard consumer usage bytes to the TV's expected mapping.
-		//  - Some TV mappings may require sending a *keyboard* usage (e.g. Samsung
-		//    volume uses F8/F9/F10), which is supported via TvMediaRemap.
-		if( mods == 0x00 && isTvLayout(m_nKeyboardLayout) && RawKeyboard::isConsumerUsage(usage) )
-		{
-			TvMediaRemap r = remapConsumerForTv(m_nKeyboardLayout, usage);
-			for( uint8_t i = 0; i < repeat; ++i )
-			{
-				// If asKeyboard=true, r.usage is a keyboard HID usage (F8/F9/F10...).
-				// If asKeyboard=false, r.usage is a consumer low byte (0xCD/0xB7/0xE9...).
-				Keyboard.sendRaw(0x00, r.usage);
-			}
-		}
-		else
-		{
-			// Normal raw keyboard usage path (also handles consumer usages automatically when mods==0)
-			for( uint8_t i = 0; i < repeat; ++i )
-			{
-				Keyboard.sendRaw(mods, usage);
-			}
-		}
+	// Send inside MTLS using standard frame: [0xC2][LEN][BYTES]
+	sendFrame(0xC2, reinterpret_cast<const uint8_t*>(s.c_str()), (uint16_t)s.length());
+}
+
+// :: RESET_TO_DEFAULT (0xC4)
+static void op_resetToDefault( const uint8_t* p, uint16_t n )
+{
+	(void)p; (void)n;
+
+	DPRINTLN("[RESET] clear appkey+setup");
+	clearAppKeyAndFlag();
+	mtls_forgetTickets();
+	sendFrame(0x00, nullptr, 0); // ACK_OK
+}
+
+// :: SEND_STRING (0xD0)
+// Types arbitrary UTF-8 text received from the app.
+// Queued for the HID emitter; D1 goes out from send_string_tick()
+// once the text has actually been typed.
+static void op_sendString( const uint8_t* p, uint16_t n )
+{
+	if( !send_string_begin(p, n) )
+	{
+		const char* e = "busy";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+	}
+}
 
-		// NOTE: no ACK (no sendFrame back), no MD5, no UI update.
-		// Pure fire-and-forget for maximum throughput.
-		return true;
+// :: SEND_STRING_BEGIN / CHUNK / END (0xD2 / 0xD3 / 0xD4)
+// Same as D0 but the text comes in as many frames as needed, so
+// there's no 4 KB limit and typing starts with the first chunk.
+// Each chunk is ACKed once it's taken; the next one is held back
+// by the protocol task until it has been translated (simple flow control).
+static void op_streamBegin( const uint8_t* p, uint16_t n )
+{
+	(void)p; (void)n;
+
+	if( !send_string_open() )
+	{
+		const char* e = "busy";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+		return;
 	}
-	
-	// Not a known MTLS-protected opcode
-	return( false );
+	sendFrame(0x00, nullptr, 0);
+}
+
+static void op_streamChunk( const uint8_t* p, uint16_t n )
+{
+	if( !send_string_append(p, n) )
+	{
+		const char* e = s_ssOpen ? "busy" : "no stream";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+		return;
+	}
+	sendFrame(0x00, nullptr, 0);
+}
+
+// D4 is answered by D1 once typed
+static void op_streamEnd( const uint8_t* p, uint16_t n )
+{
+	(void)p; (void)n;
+
+	if( !send_string_close() )
+	{
+		const char* e = s_ssOpen ? "busy" : "no stream";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+	}
+}
+
+// :: SEND_KEYS (0xD5)
+// Host did the layout translation (same kb_layouts tables), the
+// dongle only plays the keys. Token format: see send_keys_valid().
+static void op_sendKeys( const uint8_t* p, uint16_t n )
+{
+	const char* e = nullptr;
+	if( !send_keys_valid(p, n) )             e = "bad keys";
+	else if( !send_string_begin(p, n, true) ) e = "busy";
+
+	if( e ) sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+}
+
+// :: SET_ACK_MODE (0xC9)
+// payload: [flags1]
+//   bit0 SEND_ACK_PROGRESS - D6 progress while a string is typed
+//   bit1 SEND_ACK_CRC32    - D1 = status + CRC32 instead of MD5
+// For this link only, applies to strings queued after it.
+static void op_setAckMode( const uint8_t* p, uint16_t n )
+{
+	(void)n;
+
+	s_ssAckMode = p[0] & (SEND_ACK_PROGRESS | SEND_ACK_CRC32);
+	DPRINT("[SEND] ack_mode=0x%02x\n", s_ssAckMode);
+
+	sendFrame(0x00, nullptr, 0);
+}
+
+// :: SET_CREDIT (0xCA)
+// payload: [on1]
+//   on1 = 0x01 - credit flow control for this link, reply
+//                CB [limit u32le][overhead u16le][max frame u16le]
+//   on1 = 0x00 - back to "busy" on a full ring, reply ACK
+static void op_setCredit( const uint8_t* p, uint16_t n )
+{
+	(void)n;
+
+	if( !p[0] )
+	{
+		s_crOn = false;
+		sendFrame(0x00, nullptr, 0);
+		return;
+	}
+
+	// the CA record itself is still in the ring, its credit comes back
+	// with the first grant (the client counts it)
+	s_crOn   = true;
+	s_crDrop = false;
+	s_crBase = rx_ring_creditFreed();
+	s_crSent = RX_CREDIT_WINDOW;
+	DPRINT("[RX] credit on, window=%u\n", (unsigned)RX_CREDIT_WINDOW);
+
+	uint8_t out[8];
+	wr32le(out, RX_CREDIT_WINDOW);
+	out[4] = (uint8_t)(RX_CREDIT_OVERHEAD & 0xFF);
+	out[5] = (uint8_t)(RX_CREDIT_OVERHEAD >> 8);
+	out[6] = (uint8_t)(RX_FRAME_MAX & 0xFF);
+	out[7] = (uint8_t)(RX_FRAME_MAX >> 8);
+	sendFrame(0xCB, out, sizeof(out));
+}
+
+// :: GET_TICKET (0xB4), PROTO 1.15+
+// Reply B5 [id16][lifetime s u16le]: a session resumption ticket, good
+// for one B6 RESUME on a later connection (see mtls.cpp).
+static void op_getTicket( const uint8_t* p, uint16_t n )
+{
+	(void)p; (void)n;
+
+	uint8_t t[18];
+	if( !mtls_issueTicket(t) )
+	{
+		const char* e = "NOSESSION";
+		sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+		return;
+	}
+	sendFrame(0xB5, t, sizeof(t));
 }
 
+// :: SET_RAW_FAST_MODE (0xC8)
+// payload: [mode1]
+//   mode1 = 0x00 - disable raw fast mode
+//   mode1 = 0x01 - enable raw fast mode
+static void op_setRawFastMode( const uint8_t* p, uint16_t n )
+{
+	(void)n;
+
+	uint8_t mode = p[0];
+	g_rawFastMode = (mode != 0);
+
+	DPRINT("[RAW] fast_mode=%d\n", g_rawFastMode ? 1 : 0);
+
+	// ACK_OK, no extra payload
+	sendFrame(0x00, nullptr, 0);
+}
+
+// :: RAW_KEY_TAP (0xE0)
+// Fast-path: send a single HID usage (mods + usage), no MD5, no ACK.
+// Only honored when g_rawFastMode == true (OPS_FAST, else "raw off").
+// Payload:
+//    [mods1][usage1]            (len = 2)
+// or [mods1][usage1][repeat1]   (len = 3)
+static void op_rawKeyTap( const uint8_t* p, uint16_t n )
+{
+	uint8_t mods   = p[0];
+	uint8_t usage  = p[1];
+	uint8_t repeat = (n >= 3 && p[2] != 0) ? p[2] : 1;
+
+	// by layout type:
+	//  - If a TV layout is selected (layout id >= BK_TV_LAYOUT_BASE), remap the
+	//    standard consumer usage bytes to the TV's expected mapping.
+	//  - Some TV mappings may require sending a *keyboard* usage (e.g. Samsung
+	//    volume uses F8/F9/F10), which is supported via TvMediaRemap.
+	if( mods == 0x00 && isTvLayout(m_nKeyboardLayout) && RawKeyboard::isConsumerUsage(usage) )
+	{
+		// If asKeyboard=true, r.usage is a keyboard HID usage (F8/F9/F10...).
+		// If asKeyboard=false, r.usage is a consumer low byte (0xCD/0xB7/0xE9...).
+		TvMediaRemap r = remapConsumerForTv(m_nKeyboardLayout, usage);
+		mods  = 0x00;
+		usage = r.usage;
+	}
+
+	// Normal raw keyboard usage path (also handles consumer usages automatically when mods==0).
+	// What doesn't fit in the HID ring now is queued by send_string_tick(),
+	// the RX slot is held until then (dispatch_busy()).
+	s_tapMods  = mods;
+	s_tapUsage = usage;
+	s_tapLeft  = repeat;
+	raw_tap_tick();
+
+	// NOTE: no ACK (no sendFrame back), no MD5, no UI update.
+	// Pure fire-and-forget for maximum throughput.
+}
+
+// :: GET_STATS (0xC5) - defined after k_ops
+static void op_getStats( const uint8_t* p, uint16_t n );
+
 ////////////////////////////////////////////////////////////////////
-// dispatch_binary_frame(buf,len)
+// Opcode table
 //
-// Consumes one framed message: [OP][LENle][PAYLOAD].
+// One entry per opcode: the session state it needs, payload length
+// limits and its handler. op_dispatch() checks state and length, so a
+// handler only ever sees a frame it can take. B1/B6/B3 are the MTLS
+// handshake and record layer (mtls.cpp, see dispatch_binary_frame());
+// they are listed for the metrics only.
 //
-// - B1/B3: hand to mtls.cpp; if B3 decrypts an inner frame, re-dispatch it.
-// - Pre-MTLS: only APPKEY ops (A0/A2/A3).
-// - Post-MTLS: handle app ops (C*/D*/E*).
+// Per opcode protocol task time in the handler is counted: calls, total
+// and worst case us (GET_STATS). Typing runs in the HID emitter task and
+// is not part of it; B3 is the MAC check + decrypt. Ops that type
+// (OPS_HID) also stamp the HID ring with the frame's BLE write time for
+// the write -> first HID report latency.
+////////////////////////////////////////////////////////////////////
+enum : uint8_t
+{
+	OPS_PRE_MTLS = 0x01,   // only before MTLS (APPKEY onboarding)
+	OPS_MTLS     = 0x02,   // only with an MTLS session
+	OPS_FAST     = 0x04,   // needs raw fast mode too (C8)
+	OPS_RECORD   = 0x08,   // MTLS record layer, no handler here
+	OPS_HID      = 0x10    // sends HID reports (latency stamp)
+};
+
+#define OP_ANY_LEN 0xFFFF
+
+typedef void (*OpHandler)(const uint8_t* p, uint16_t n);
+
+struct OpEntry
+{
+	uint8_t   op;
+	uint8_t   flags;      // OPS_*
+	uint16_t  minLen;     // payload length limits
+	uint16_t  maxLen;
+	OpHandler fn;
+};
+
+static constexpr OpEntry k_ops[] =
+{
+	// op    state                  min  max          handler
+	{ 0xA0,  OPS_PRE_MTLS,          0,   OP_ANY_LEN,  op_getAppKey        },
+	{ 0xA3,  OPS_PRE_MTLS,          32,  32,          op_appKeyProof      },
+	{ 0xB1,  OPS_RECORD,            0,   OP_ANY_LEN,  nullptr             },
+	{ 0xB3,  OPS_RECORD,            0,   OP_ANY_LEN,  nullptr             },
+	{ 0xB4,  OPS_MTLS,              0,   0,           op_getTicket        },
+	{ 0xB6,  OPS_RECORD,            0,   OP_ANY_LEN,  nullptr             },
+	{ 0xC0,  OPS_MTLS,              1,   64,          op_setLayout        },
+	{ 0xC1,  OPS_MTLS,              0,   OP_ANY_LEN,  op_getInfo          },
+	{ 0xC4,  OPS_MTLS,              0,   OP_ANY_LEN,  op_resetToDefault   },
+	{ 0xC5,  OPS_MTLS,              0,   1,           op_getStats         },
+	{ 0xC8,  OPS_MTLS,              1,   1,           op_setRawFastMode   },
+	{ 0xC9,  OPS_MTLS,              1,   1,           op_setAckMode       },
+	{ 0xCA,  OPS_MTLS,              1,   1,           op_setCredit        },
+	{ 0xD0,  OPS_MTLS | OPS_HID,    0,   OP_ANY_LEN,  op_sendString       },
+	{ 0xD2,  OPS_MTLS,              0,   OP_ANY_LEN,  op_streamBegin      },
+	{ 0xD3,  OPS_MTLS,              0,   OP_ANY_LEN,  op_streamChunk      },
+	{ 0xD4,  OPS_MTLS,              0,   OP_ANY_LEN,  op_streamEnd        },
+	{ 0xD5,  OPS_MTLS | OPS_HID,    0,   OP_ANY_LEN,  op_sendKeys         },
+	{ 0xE0,  OPS_MTLS | OPS_FAST | OPS_HID,  2,  3,   op_rawKeyTap        },
+};
+
+#define OPS_COUNT (sizeof(k_ops) / sizeof(k_ops[0]))
+
+struct OpStats
+{
+	uint32_t calls;
+	uint32_t totalUs;
+	uint32_t maxUs;
+};
+
+static OpStats s_opStats[OPS_COUNT];
+
+static int op_find( uint8_t op )
+{
+	for( size_t i = 0; i < OPS_COUNT; ++i )
+		if( k_ops[i].op == op ) return( (int)i );
+
+	return( -1 );
+}
+
+static inline void op_count( int i, uint32_t us )
+{
+	if( i < 0 ) return;
+
+	OpStats& st = s_opStats[i];
+	st.calls++;
+	st.totalUs += us;
+	if( us > st.maxUs ) st.maxUs = us;
+}
+
+static void op_reject( const char* e )
+{
+	sendFrame(0xFF, (const uint8_t*)e, (uint16_t)strlen(e));
+}
+
+////////////////////////////////////////////////////////////////////
+// op_dispatch(op,p,n,rxUs)
 //
-// Returns true if handled (including errors).
+// Looks the opcode up in k_ops, checks the session state and payload
+// length, then runs (and times) the handler. Errors:
+//   "need MTLS" - pre-MTLS, anything but APPKEY onboarding
+//   "bad op"    - with MTLS, unknown (or pre-MTLS only) opcode
+//   "raw off"   - E0 without raw fast mode
+//   "bad len"   - payload outside the entry's limits
+// rxUs is when the frame came in over BLE (rx_ring), for OPS_HID.
 ////////////////////////////////////////////////////////////////////
-static bool dispatch_binary_frame( const uint8_t* buf, size_t len )
+static void op_dispatch( uint8_t op, const uint8_t* p, uint16_t n, uint32_t rxUs )
 {
-	if( len < 3 ) return( false );
-	uint8_t  op = buf[0];
-	uint16_t L  = rd16le(buf+1);
-	if( len < 3 + L ) return( false );
+	const int i = op_find(op);
+	const OpEntry* e = (i >= 0) ? &k_ops[i] : nullptr;
 
-	const uint8_t* p = buf + 3;
-	DPRINT("[RX][%s] op=0x%02X len=%u\n", mtls_isActive() ? "MTLS":"RAW", op, (unsigned)L);
+	if( !mtls_isActive() )
+	{
+		// APPKEY onboarding is allowed only pre-MTLS
+		if( !e || !(e->flags & OPS_PRE_MTLS) ) { op_reject("need MTLS"); return; }
+		
+	} else if( !e || !(e->flags & OPS_MTLS) ) 
+	{
+		op_reject("bad op");
+		return;
+	}
+
+	if( (e->flags & OPS_FAST) && !g_rawFastMode ) { op_reject("raw off"); return; }
+	if( n < e->minLen || n > e->maxLen )          { op_reject("bad len"); return; }
+
+	if( e->flags & OPS_HID ) hid_emitter_stamp(rxUs);
 
-	// 1) Pre-handle MTLS frames B1 (KEYX) and B3 (ENC)
-	if( op == 0xB1 || op == 0xB3 ) 
+	const uint32_t t0 = micros();
+	e->fn(p, n);
+	op_count(i, micros() - t0);
+}
+
+// :: GET_STATS (0xC5)
+// payload: [] or [flags1], bit0 = clear the counters after reading
+// reply C6: [count1] then per opcode
+//   [op1][calls u32le][total us u32le][max us u32le]
+// then (PROTO 1.13+) BLE write -> first HID report latency
+//   [samples u32le][total us u32le][max us u32le]
+// then (PROTO 1.16+) B3 records per record mode, sent + received
+//   [modes1] then per mode [mode1][records u32le][crypto us u32le][air bytes u32le]
+static void op_getStats( const uint8_t* p, uint16_t n )
+{
+	uint8_t out[1 + OPS_COUNT * 13 + 12 + 1 + MTLS_REC_MODES * 13];
+	uint8_t* w = out;
+
+	*w++ = (uint8_t)OPS_COUNT;
+	for( size_t i = 0; i < OPS_COUNT; ++i )
 	{
-		DPRINT("[DISPATCH] entering B* pre-handler: op=0x%02X len=%u\n", (unsigned)op, (unsigned)L);
-		std::vector<uint8_t> inner;
-		if( mtls_tryConsumeOrDecryptFromBinary(op, p, L, inner) ) 
-		{
-			DPRINT("[DISPATCH] B* handler returned TRUE (consumed=%s)\n", inner.empty()?"yes":"no");
-			
-			 // B1: handshake-only, no inner frame
-			if( inner.empty() ) return true;
-			
-			// B3: inner now holds decrypted app frame [OP|LEN|PAYLOAD]
-			return( dispatch_binary_frame(inner.data(), inner.size()) );
-		}
-		// If mtls_* did not consume, fall through and treat it as a normal op
-		DPRINTLN("[DISPATCH] B* handler returned FALSE — falling through");
+		*w++ = k_ops[i].op;
+		wr32le(w, s_opStats[i].calls);   w += 4;
+		wr32le(w, s_opStats[i].totalUs); w += 4;
+		wr32le(w, s_opStats[i].maxUs);   w += 4;
 	}
 
-	// 2) APPKEY onboarding is allowed only pre-MTLS
-	if( !mtls_isActive() ) 
+	HidLatStats lat;
+	hid_getLatStats(lat);
+	wr32le(w, lat.count);   w += 4;
+	wr32le(w, lat.totalUs); w += 4;
+	wr32le(w, lat.maxUs);   w += 4;
+
+	MtlsRecStats rec[MTLS_REC_MODES];
+	mtls_getRecStats(rec);
+	*w++ = (uint8_t)MTLS_REC_MODES;
+	for( uint8_t m = 0; m < MTLS_REC_MODES; ++m )
 	{
-		if( handle_appkey_ops(op, p, L) ) return( true );
-		
-		// Anything else before MTLS is considered an error
-		const char* e = "need MTLS";
-		sendFrame( 0xFF, (const uint8_t*)e, (uint16_t)strlen(e) );
-		
-		return( true );
+		*w++ = m;
+		wr32le(w, rec[m].records);  w += 4;
+		wr32le(w, rec[m].cryptoUs); w += 4;
+		wr32le(w, rec[m].airBytes); w += 4;
 	}
+	sendFrame(0xC6, out, (uint16_t)sizeof(out));
 
-	// 3) MTLS-protected application ops (layout, info, reset, typing)
-	// Note: we process commands even if the were not encapsulated in B3, 
-	// for max security all highly sensitive data needs to be encapsulated in B3
-	if( handle_mtls_ops(op, p, L) ) return( true );
+	if( n && (p[0] & 0x01) ) 
+	{
+		memset(s_opStats, 0, sizeof(s_opStats));
+		hid_clearLatStats();
+		mtls_clearRecStats();
+	}
+}
 
-	// Unknown op at this point
-	const char* e = "bad op";
-	sendFrame( 0xFF, (const uint8_t*)e, (uint16_t)strlen(e) );
-	
+////////////////////////////////////////////////////////////////////
+// dispatch_binary_frame(buf,len,rxUs)
+//
+// Consumes the next framed message [OP][LENle][PAYLOAD] at buf and
+// moves buf/len past it. A buffer can hold several frames back to
+// back (one B3 record carrying a batch of E0 taps, C8+D0, ...); the
+// caller keeps calling while len != 0.
+//
+// - B1/B6/B3: hand to mtls.cpp, only as a whole buffer (not batched behind
+//   other frames). B3 is decrypted in place (buf is the RX slot, owned
+//   by the caller), buf/len then point at the inner frames and the first
+//   of them is handled in the same pass - no copy, no allocation.
+// - Everything else: op_dispatch() / k_ops (APPKEY ops pre-MTLS only,
+//   app ops C*/D*/E* with MTLS only).
+//
+// rxUs: micros() the buffer came in at (rx_ring_peek()).
+//
+// Returns true if handled (including errors). A malformed frame drops
+// the rest of the buffer (len = 0) and returns false.
+////////////////////////////////////////////////////////////////////
+[[maybe_unused]] static bool dispatch_binary_frame( uint8_t*& buf, size_t& len, uint32_t rxUs )
+{
+	uint8_t  op;
+	uint16_t L;
+	uint8_t* p;
+
+	for( ;; )
+	{
+		if( len < 3 || len < 3 + (size_t)rd16le(buf+1) ) 
+		{
+			DPRINT("[DISPATCH] bad frame, %u bytes dropped\n", (unsigned)len);
+			len = 0;
+			return( false );
+		}
+		op = buf[0];
+		L  = rd16le(buf+1);
+		p  = buf + 3;
+
+		// consumed whatever happens below
+		buf += 3 + (size_t)L;
+		len -= 3 + (size_t)L;
+		DPRINT("[RX][%s] op=0x%02X len=%u\n", mtls_isActive() ? "MTLS":"RAW", op, (unsigned)L);
+
+		// 1) Pre-handle MTLS frames B1 (KEYX), B6 (RESUME) and B3 (ENC)
+		if( (op != 0xB1 && op != 0xB3 && op != 0xB6) || len ) break;
+
+		DPRINT("[DISPATCH] entering B* pre-handler: op=0x%02X len=%u\n", (unsigned)op, (unsigned)L);
+		uint8_t* inner    = nullptr;
+		uint16_t innerLen = 0;
+		const uint32_t t0 = micros();
+		if( !mtls_tryConsumeOrDecryptFromBinary(op, p, L, inner, innerLen) ) 
+		{
+			// If mtls_* did not consume, fall through and treat it as a normal op
+			DPRINTLN("[DISPATCH] B* handler returned FALSE — falling through");
+			break;
+		}
+		DPRINT("[DISPATCH] B* handler returned TRUE (consumed=%s)\n", innerLen ? "no":"yes");
+		op_count(op_find(op), micros() - t0);
+
+		// B1/B6: handshake-only, no inner frame
+		if( !innerLen ) return( true );
+
+		// B3: inner is the decrypted app frame(s) [OP|LEN|PAYLOAD]..., in place
+		buf = inner;
+		len = innerLen;
+	}
+
+	// 2) Everything else goes through the opcode table
+	op_dispatch(op, p, L, rxUs);
 	return( true );
 }
 
@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////
+// hid_emitter.cpp - HID typing task + SPSC report ring
+//
+// See hid_emitter.h. The protocol task is the only producer, the emitter task
+// the only consumer; head/tail are free-running 32-bit indexes and
+// the slot is (index & mask).
+////////////////////////////////////////////////////////////////////
+#include "hid_emitter.h"
+#include "tusb.h"
+#include <atomic>
+
+// debug
+#define DEBUG_ENABLED 1
+#include "debug_utils.h"
+
+static_assert( (HID_RING_SIZE & (HID_RING_SIZE - 1)) == 0, "HID_RING_SIZE must be a power of 2" );
+static_assert( HID_RING_SIZE > HID_MAX_OPS_PER_CP, "HID_RING_SIZE too small" );
+
+static HidOp                 s_ring[HID_RING_SIZE];
+static std::atomic<uint32_t> s_head{0};       // written by producer
+static std::atomic<uint32_t> s_tail{0};       // written by consumer
+static std::atomic<uint32_t> s_jobsDone{0};
+
+static USBHIDKeyboard*        s_kb   = nullptr;
+static USBHIDConsumerControl* s_cc   = nullptr;
+static TaskHandle_t           s_task = nullptr;
+
+// pacing
+static volatile uint32_t s_minGapUs   = 0;
+static uint32_t          s_lastSendUs = 0;
+static HidPaceStats      s_stats      = {};
+static uint32_t          s_overruns   = 0;    // producer side, see hid_emitter_push()
+
+// write -> HID latency, owned by whoever sends (like s_stats); a clear
+// from the protocol task is only a request, done by the sender
+static bool              s_stampSet = false;
+static uint32_t          s_stampUs  = 0;
+static HidLatStats       s_lat      = {};
+static volatile bool     s_latClear = false;
+
+////////////////////////////////////////////////////////////////////
+// Wait until the next report can go out: HID endpoint free (previous
+// report fetched by the host) and the host profile minimum gap passed.
+// Returns false if the endpoint did not come ready in time (USB not
+// mounted / suspended host) - the report is skipped then.
+////////////////////////////////////////////////////////////////////
+static bool hid_waitSlot()
+{
+	const uint32_t t0 = micros();
+	bool waited = false;
+
+	if( !tud_hid_ready() )
+	{
+		waited = true;
+		while( !tud_hid_ready() )
+		{
+			if( !tud_mounted() || (micros() - t0) > (uint32_t)HID_READY_TIMEOUT_MS * 1000u )
+			{
+				s_stats.timeouts++;
+				s_stats.waits++;
+				s_stats.waitUs += micros() - t0;
+				return( false );
+			}
+			delay(1);
+		}
+	}
+
+	const uint32_t gap = s_minGapUs;
+	const uint32_t since = micros() - s_lastSendUs;
+	if( gap && since < gap )
+	{
+		waited = true;
+		const uint32_t left = gap - since;
+		if( left >= 1000 ) delay( left / 1000 );
+		delayMicroseconds( left % 1000 );
+	}
+
+	if( waited )
+	{
+		s_stats.waits++;
+		s_stats.waitUs += micros() - t0;
+	}
+	return( true );
+}
+
+////////////////////////////////////////////////////////////////////
+// First report sent after a stamp: one latency sample
+////////////////////////////////////////////////////////////////////
+static void hid_latSample()
+{
+	if( s_latClear )
+	{
+		s_lat = {};
+		s_latClear = false;
+	}
+	if( !s_stampSet ) return;
+	s_stampSet = false;
+
+	const uint32_t us = s_lastSendUs - s_stampUs;
+	s_lat.count++;
+	s_lat.totalUs += us;
+	s_lat.lastUs = us;
+	if( us > s_lat.maxUs ) s_lat.maxUs = us;
+}
+
+void hid_sendReportPaced( USBHIDKeyboard* kb, KeyReport* rpt )
+{
+	if( !hid_waitSlot() ) return;
+
+	const uint32_t t0 = micros();
+	kb->sendReport( rpt );
+	s_lastSendUs = micros();
+	s_stats.sendUs += s_lastSendUs - t0;
+	s_stats.reports++;
+	hid_latSample();
+}
+
+void hid_sendConsumerPaced( USBHIDConsumerControl* cc, uint16_t usage )
+{
+	if( !cc ) return;
+
+	// press + release are two reports on the same endpoint
+	if( hid_waitSlot() ) { cc->press( usage ); s_stats.reports++; }
+	if( hid_waitSlot() ) { cc->release(); s_stats.reports++; }
+	s_lastSendUs = micros();
+	hid_latSample();
+}
+
+void hid_setMinGapUs( uint32_t us )
+{
+	s_minGapUs = us;
+}
+
+void hid_getPaceStats( HidPaceStats& out )
+{
+	out = s_stats;
+	out.overruns = s_overruns;
+}
+
+void hid_getLatStats( HidLatStats& out )
+{
+	if( s_latClear ) out = {};
+	else out = s_lat;
+}
+
+void hid_clearLatStats()
+{
+	s_latClear = true;
+}
+
+////////////////////////////////////////////////////////////////////
+// Emitter task: pop ops and do the blocking USB part
+////////////////////////////////////////////////////////////////////
+static void hid_emitter_task( void* )
+{
+	for( ;; )
+	{
+		const uint32_t tail = s_tail.load(std::memory_order_relaxed);
+		if( tail == s_head.load(std::memory_order_acquire) )
+		{
+			// nothing queued - sleep until the producer pokes us
+			ulTaskNotifyTake( pdTRUE, pdMS_TO_TICKS(100) );
+			continue;
+		}
+
+		HidOp& op = s_ring[tail & (HID_RING_SIZE - 1)];
+		switch( op.type )
+		{
+			case HIDOP_REPORT:
+				hid_sendReportPaced( s_kb, &op.rpt );
+				break;
+
+			case HIDOP_CONSUMER:
+				hid_sendConsumerPaced( s_cc, op.usage );
+				break;
+
+			case HIDOP_JOB_END:
+				s_jobsDone.fetch_add( 1, std::memory_order_release );
+				break;
+
+			case HIDOP_STAMP:
+				s_stampUs  = op.rxUs;
+				s_stampSet = true;
+				break;
+		}
+
+		s_tail.store( tail + 1, std::memory_order_release );
+	}
+}
+
+////////////////////////////////////////////////////////////////////
+bool hid_emitter_begin( USBHIDKeyboard* kb, USBHIDConsumerControl* cc )
+{
+	if( s_task ) return( true );
+
+	s_kb = kb;
+	s_cc = cc;
+
+	BaseType_t ok = xTaskCreatePinnedToCore( hid_emitter_task, "hid_emit", 4096, nullptr,
+												HID_EMITTER_PRIO, &s_task, HID_EMITTER_CORE );
+	if( ok != pdPASS )
+	{
+		DPRINTLN("[HID] emitter task create failed - typing stays synchronous");
+		s_task = nullptr;
+		return( false );
+	}
+
+	DPRINT("[HID] emitter task on core %d, ring=%d ops\n", HID_EMITTER_CORE, HID_RING_SIZE);
+	return( true );
+}
+
+bool hid_emitter_isRunning()
+{
+	return( s_task != nullptr );
+}
+
+uint16_t hid_emitter_space()
+{
+	const uint32_t used = s_head.load(std::memory_order_relaxed) - s_tail.load(std::memory_order_acquire);
+	return( (uint16_t)(HID_RING_SIZE - used) );
+}
+
+bool hid_emitter_push( const HidOp& op )
+{
+	if( !s_task ) return( false );
+
+	// full: callers reserve room with hid_emitter_space() first, so
+	// this is a bug - drop the op rather than stall the protocol task
+	// (and don't send it directly either, it would overtake the ring)
+	if( hid_emitter_space() == 0 )
+	{
+		s_overruns++;
+		DPRINTLN("[HID] ring full, op dropped");
+		return( true );
+	}
+
+	const uint32_t head = s_head.load(std::memory_order_relaxed);
+	s_ring[head & (HID_RING_SIZE - 1)] = op;
+	s_head.store( head + 1, std::memory_order_release );
+
+	xTaskNotifyGive( s_task );
+	return( true );
+}
+
+void hid_emitter_stamp( uint32_t rxUs )
+{
+	// direct mode: the caller is the sender too
+	if( !s_task )
+	{
+		s_stampUs  = rxUs;
+		s_stampSet = true;
+		return;
+	}
+
+	HidOp op = {};
+	op.type = HIDOP_STAMP;
+	op.rxUs = rxUs;
+	hid_emitter_push( op );
+}
+
+uint32_t hid_emitter_jobsDone()
+{
+	return( s_jobsDone.load(std::memory_order_acquire) );
+}
+
+uint32_t hid_emitter_pushed()
+{
+	return( s_head.load(std::memory_order_relaxed) );
+}
+
+uint32_t hid_emitter_popped()
+{
+	return( s_tail.load(std::memory_order_acquire) );
+}
+
+bool hid_emitter_idle()
+{
+	return( s_head.load(std::memory_order_relaxed) == s_tail.load(std::memory_order_acquire) );
+}
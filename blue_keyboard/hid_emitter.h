@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////
+//  HID emitter — typing runs in its own FreeRTOS task
+//
+//  The protocol task translates text into ready-made HID
+//  reports and pushes them into a single-producer/single-consumer
+//  ring. A dedicated task, pinned to the core the protocol task is
+//  not on, pops the ops and does the blocking part: the paced
+//  sendReport() calls.
+//
+//  So a long SEND_STRING no longer stalls BLE frame processing,
+//  mtls_tick() or the UI while it is being typed.
+//
+//  Tasks (see also PROTO_TASK_* in settings.h):
+//    NimBLE host  core 0  BLE callbacks, handleWrite() -> rx_ring
+//    protocol     core 1  rx_ring -> MTLS/commands -> this ring
+//    HID emitter  core 0  this ring -> USB
+//    loop()       core 1  UI only (TFT, LED, reset button)
+//
+//  Ring ops:
+//    REPORT   : send the keyboard report (paced, see below)
+//    CONSUMER : press + release a consumer control usage
+//    JOB_END  : marker, bumps hid_emitter_jobsDone() when reached
+//    STAMP    : BLE write time of the frame the next reports belong to
+//               (write -> first HID report latency, hid_getLatStats())
+//
+//  Pacing: no fixed delays. The core's SendReport() already blocks
+//  until TinyUSB reports the IN transfer complete (host fetched it);
+//  on top of that we wait for tud_hid_ready() before each report, so
+//  the core never finds the endpoint busy and drops one, and apply an
+//  optional minimum gap per host profile (hid_setMinGapUs()).
+//
+//  Producer is the protocol task only (RawKeyboard, SEND_STRING pump); the
+//  consumer is the emitter task only. No locks, just the two indexes.
+//
+//  If the task is not started (or failed to start) push returns false
+//  and RawKeyboard sends the report directly, as before.
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <Arduino.h>
+#include "USBHIDKeyboard.h"
+#include "USBHIDConsumerControl.h"
+
+// ring size in ops, must be a power of 2 (12 bytes per op)
+#ifndef HID_RING_SIZE
+#define HID_RING_SIZE 512
+#endif
+
+// emitter task placement: the protocol task runs on core 1, so use core 0.
+// It shares that core with the NimBLE host, which is fine: the emitter
+// spends its time blocked on USB completion, and the host task runs at a
+// higher priority, so BLE callbacks still preempt it. On core 1 it would
+// compete with the protocol task's decryption/translation instead.
+#ifndef HID_EMITTER_CORE
+#define HID_EMITTER_CORE 0
+#endif
+#ifndef HID_EMITTER_PRIO
+#define HID_EMITTER_PRIO 2
+#endif
+
+// how long to wait for the HID endpoint before giving up on a report
+#ifndef HID_READY_TIMEOUT_MS
+#define HID_READY_TIMEOUT_MS 250
+#endif
+
+// worst case number of ops a single codepoint can translate into
+// (Alt+numpad with 10 digits, or a macOS surrogate pair, plus release)
+#define HID_MAX_OPS_PER_CP 32
+
+enum : uint8_t
+{
+	HIDOP_REPORT   = 0,
+	HIDOP_CONSUMER = 1,
+	HIDOP_JOB_END  = 2,
+	HIDOP_STAMP    = 3
+};
+
+struct HidOp
+{
+	uint8_t   type;
+	uint8_t   reserved;
+	uint16_t  usage;    // CONSUMER usage
+	union
+	{
+		KeyReport rpt;  // REPORT payload
+		uint32_t  rxUs; // STAMP: micros() the frame came in at
+	};
+};
+
+// Pacing counters (written by whoever sends: emitter task or direct path)
+struct HidPaceStats
+{
+	uint32_t reports;     // keyboard + consumer reports sent
+	uint32_t waits;       // reports that had to wait (endpoint busy / min gap)
+	uint32_t waitUs;      // total time spent in those waits
+	uint32_t sendUs;      // total time in SendReport (until host fetched it)
+	uint32_t timeouts;    // endpoint never got ready - report skipped
+	uint32_t overruns;    // ops pushed into a full ring - dropped
+};
+
+// Start the emitter task. Returns false if the task could not be created
+// (the caller keeps working in direct/synchronous mode).
+bool hid_emitter_begin(USBHIDKeyboard* kb, USBHIDConsumerControl* cc);
+
+// True once the task is up and pushes are accepted
+bool hid_emitter_isRunning();
+
+// Producer side (protocol task only). push never waits: callers check
+// hid_emitter_space() first and hold their input back until the ops
+// fit (SEND_STRING and E0 taps, send_string_tick()). An op pushed into a full
+// ring anyway is dropped and counted in HidPaceStats::overruns.
+// Returns false if the emitter is not running.
+bool hid_emitter_push(const HidOp& op);
+uint16_t hid_emitter_space();
+
+// Number of JOB_END markers the task has reached so far
+uint32_t hid_emitter_jobsDone();
+
+// Free-running op counters: ops pushed so far / ops the task has
+// finished. An op pushed as number N has been sent once popped > N.
+uint32_t hid_emitter_pushed();
+uint32_t hid_emitter_popped();
+
+// True when the ring is empty (everything queued has been sent)
+bool hid_emitter_idle();
+
+// Paced send, used by the task and by the direct (no task) fallback
+void hid_sendReportPaced(USBHIDKeyboard* kb, KeyReport* rpt);
+void hid_sendConsumerPaced(USBHIDConsumerControl* cc, uint16_t usage);
+
+// Minimum time between two reports, per host profile (0 = USB pacing only)
+void hid_setMinGapUs(uint32_t us);
+
+void hid_getPaceStats(HidPaceStats& out);
+
+// BLE write -> first HID report latency: from the time the frame came
+// in (rx_ring) to the end of the first report it caused (host fetched
+// it). One sample per stamped frame.
+struct HidLatStats
+{
+	uint32_t count;
+	uint32_t totalUs;
+	uint32_t maxUs;
+	uint32_t lastUs;
+};
+
+// Producer side: the next report sent belongs to a frame received at
+// rxUs. Goes through the ring, so it is matched with the right report.
+void hid_emitter_stamp(uint32_t rxUs);
+
+void hid_getLatStats(HidLatStats& out);
+void hid_clearLatStats();
@@ -33,7 +33,7 @@
 //    - For "dead key then space" we use key2=SPACE.
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_DE_MAC[] =
+static constexpr KbMapEntry KBMAP_DE_MAC[] =
 {
   // ---- QWERTZ swaps ----
   { 'y',       0,        0x1D, 0, 0 },            // y -> Z key
@@ -30,7 +30,7 @@
 // Handy
 #define SPACE_KEY 0x2C
 
-static const KbMapEntry KBMAP_DE_WINLIN[] = {
+static constexpr KbMapEntry KBMAP_DE_WINLIN[] = {
 
   // ----- QWERTZ letter swap -----
   { 'y', 0,         0x1D, 0, 0 },         // y -> press physical Z key
@@ -77,12 +77,12 @@ static const KbMapEntry KBMAP_DE_WINLIN[] = {
 
   // ----- Dead keys: ^ ° and ´ ` -----
   // ^ is usually a dead key on DE Win/Linux. To output a literal '^', press it then SPACE.
-  { '^', 0,         0x35, SPACE_KEY, 0 },         // '^' then Space
+  { '^', 0,         0x35, 0, SPACE_KEY },         // '^' then Space
   { 0x00B0 /*°*/, MOD_SHIFT, 0x35, 0, 0 },        // Shift + ^ key
 
   // ´ and ` are usually dead keys on the key right of ß (usage 0x2E).
-  { 0x00B4 /*´*/, 0,         0x2E, SPACE_KEY, 0 }, // ´ then Space
-  { '`',          MOD_SHIFT, 0x2E, SPACE_KEY, 0 }, // ` then Space
+  { 0x00B4 /*´*/, 0,         0x2E, 0, SPACE_KEY }, // ´ then Space
+  { '`',          MOD_SHIFT, 0x2E, 0, SPACE_KEY }, // ` then Space
 
   // ----- AltGr programming symbols -----
   { '@',  MOD_ALTGR, 0x14, 0, 0 }, // AltGr+Q
@@ -37,7 +37,7 @@
   #define DK_KEY_O_SLASH 0x33  // US ';' position
 #endif
 
-static const KbMapEntry KBMAP_DK_WINLIN[] =
+static constexpr KbMapEntry KBMAP_DK_WINLIN[] =
 {
   // ------------------------------------------------------------------------
   // Danish letters
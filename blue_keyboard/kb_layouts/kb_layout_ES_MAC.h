@@ -35,7 +35,7 @@
   #define ES_KEY_N_TILDE 0x33
 #endif
 
-static const KbMapEntry KBMAP_ES_MAC[] =
+static constexpr KbMapEntry KBMAP_ES_MAC[] =
 {
   // --------------------------------------------------------------------------
   // Spanish letters / punctuation (physical keys)
@@ -59,9 +59,9 @@ static const KbMapEntry KBMAP_ES_MAC[] =
   { U'Ó',  MOD_ALT, 0x08 /*E*/, MOD_SHIFT, 0x12 /*O*/ },
   { U'Ú',  MOD_ALT, 0x08 /*E*/, MOD_SHIFT, 0x18 /*U*/ },
 
-  // Tilde: Option+N then letter (ñ/Ñ can also be produced this way)
-  { U'ñ',  MOD_ALT, 0x11 /*N*/, 0x00, 0x11 /*N*/ },
-  { U'Ñ',  MOD_ALT, 0x11 /*N*/, MOD_SHIFT, 0x11 /*N*/ },
+  // Tilde: Option+N then letter. ñ/Ñ can also be produced this way, but the
+  // dedicated key above wins (one entry per codepoint):
+  //   ñ = Option+N, N      Ñ = Option+N, Shift+N
 
   // Umlaut: Option+U then vowel
   { U'ü',  MOD_ALT, 0x18 /*U*/, 0x00, 0x18 /*U*/ },
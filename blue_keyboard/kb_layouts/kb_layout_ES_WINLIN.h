@@ -42,7 +42,7 @@
 //  '.'      = 0x37
 //  '/'      = 0x38
 
-static const KbMapEntry KBMAP_ES_WINLIN[] =
+static constexpr KbMapEntry KBMAP_ES_WINLIN[] =
 {
   // --------------------------------------------------------------------------
   // Spanish-specific letters / punctuation
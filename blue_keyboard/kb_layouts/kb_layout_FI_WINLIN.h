@@ -33,7 +33,7 @@
   #define FI_KEY_O_UML 0x33   // US ';' position
 #endif
 
-static const KbMapEntry KBMAP_FI_WINLIN[] =
+static constexpr KbMapEntry KBMAP_FI_WINLIN[] =
 {
   // ------------------------------------------------------------------------
   // Finnish letters
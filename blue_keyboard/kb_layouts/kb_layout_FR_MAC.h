@@ -50,7 +50,7 @@
 //  - For dead-key style outputs you can use mods2/key2 as a 2nd chord.
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_FR_MAC[] = {
+static constexpr KbMapEntry KBMAP_FR_MAC[] = {
 
   // --------------------------------------------------------------------------
   // AZERTY letter swaps (so "kb.write('a')" would be wrong on FR; map explicitly)
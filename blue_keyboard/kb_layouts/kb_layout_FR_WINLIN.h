@@ -38,7 +38,7 @@
 #define FR_KEY_5_LPAREN   0x22  // base: (   shift: 5   altgr: [
 #define FR_KEY_6_MINUS    0x23  // base: -   shift: 6   altgr: |
 #define FR_KEY_7_EGRAVE   0x24  // base: è   shift: 7   altgr: `
-#define FR_KEY_8_UNDERSC  0x25  // base: _   shift: 8   altgr: \
+#define FR_KEY_8_UNDERSC  0x25  // base: _   shift: 8   altgr: backslash
 
 #define FR_KEY_9_CCED     0x26  // base: ç   shift: 9   altgr: ^
 #define FR_KEY_0_AGRAVE   0x27  // base: à   shift: 0   altgr: @
@@ -67,7 +67,7 @@
 // mods2/key2 are 0 if unused.
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_FR_WINLIN[] =
+static constexpr KbMapEntry KBMAP_FR_WINLIN[] =
 {
   // ----- AZERTY letter swaps (type Latin letters correctly when host is FR) -----
   // a <-> q
@@ -137,7 +137,7 @@ static const KbMapEntry KBMAP_FR_WINLIN[] =
 
   // ----- ¨ and ^ key (often dead keys; still useful) -----
   { U'¨', 0x00,      FR_KEY_DIAERESIS, 0x00, 0x00 },
-  { U'^', MOD_SHIFT, FR_KEY_DIAERESIS, 0x00, 0x00 },
+  // ^ is Shift+¨ (dead) here; the AltGr+9 entry above is used instead.
 
   // ----- Currency key: $ £ ¤ -----
   { U'$', 0x00,      FR_KEY_CURRENCY,  0x00, 0x00 },
@@ -21,7 +21,7 @@
   #define IE_DEAD_ACUTE_KEY 0x08  // 'E' usage
 #endif
 
-static const KbMapEntry KBMAP_IE_MAC[] =
+static constexpr KbMapEntry KBMAP_IE_MAC[] =
 {
   // --------------------------------------------------------------------------
   // Currency (British/Irish family on macOS)
@@ -37,7 +37,7 @@ static const KbMapEntry KBMAP_IE_MAC[] =
   { '"',    MOD_SHIFT, QUOTE_KEY, 0, 0 },   // " = Shift+' (British-family)
 
   // Backslash / pipe: often on ANSI backslash position on mac; keep as best-effort.
-  { '\\',   0,         ANSI_BSLASH_KEY, 0, 0 }, // \
+  { '\\',   0,         ANSI_BSLASH_KEY, 0, 0 }, // backslash
   { '|',    MOD_SHIFT, ANSI_BSLASH_KEY, 0, 0 }, // |
 
   // Tilde/backtick: physical key under ESC.
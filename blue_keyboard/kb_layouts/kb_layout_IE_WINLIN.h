@@ -24,7 +24,7 @@
   #define IE_DEAD_ACUTE_KEY QUOTE_KEY  // physical apostrophe key (usage 0x34)
 #endif
 
-static const KbMapEntry KBMAP_IE_WINLIN[] =
+static constexpr KbMapEntry KBMAP_IE_WINLIN[] =
 {
   // --------------------------------------------------------------------------
   // UK/IE swapped punctuation and ISO keys
@@ -69,7 +69,7 @@
 ////////////////////////////////////////////////////////////////////
 // Mapping table
 ////////////////////////////////////////////////////////////////////
-static const KbMapEntry KBMAP_IT_MAC[] =
+static constexpr KbMapEntry KBMAP_IT_MAC[] =
 {
   // --------------------------------------------------------------------------
   // Dedicated Italian letters (type directly via the Italian input source)
@@ -116,21 +116,9 @@ static const KbMapEntry KBMAP_IT_MAC[] =
   // Acute: Option+E then vowel.  
   // --------------------------------------------------------------------------
 
-  // Grave (Option+` then vowel)
-  { 0x00E0 /*à*/, MOD_ALT, IT_MAC_KEY_GRAVE, 0,        HID_KEY_A },
-  { 0x00C0 /*À*/, MOD_ALT, IT_MAC_KEY_GRAVE, MOD_SHIFT,HID_KEY_A },
-
-  { 0x00E8 /*è*/, MOD_ALT, IT_MAC_KEY_GRAVE, 0,        HID_KEY_E },
-  { 0x00C8 /*È*/, MOD_ALT, IT_MAC_KEY_GRAVE, MOD_SHIFT,HID_KEY_E },
-
-  { 0x00EC /*ì*/, MOD_ALT, IT_MAC_KEY_GRAVE, 0,        HID_KEY_I },
-  { 0x00CC /*Ì*/, MOD_ALT, IT_MAC_KEY_GRAVE, MOD_SHIFT,HID_KEY_I },
-
-  { 0x00F2 /*ò*/, MOD_ALT, IT_MAC_KEY_GRAVE, 0,        HID_KEY_O },
-  { 0x00D2 /*Ò*/, MOD_ALT, IT_MAC_KEY_GRAVE, MOD_SHIFT,HID_KEY_O },
-
-  { 0x00F9 /*ù*/, MOD_ALT, IT_MAC_KEY_GRAVE, 0,        HID_KEY_U },
-  { 0x00D9 /*Ù*/, MOD_ALT, IT_MAC_KEY_GRAVE, MOD_SHIFT,HID_KEY_U },
+  // Grave (Option+` then vowel): à è ì ò ù and capitals have dedicated keys
+  // above, which win (one entry per codepoint). Dead-key form if needed:
+  //   Option+`, vowel   /   Option+`, Shift+vowel
 
   // Acute (Option+E then vowel)
   { 0x00E1 /*á*/, MOD_ALT, HID_KEY_E, 0,        HID_KEY_A },
@@ -73,7 +73,7 @@
 //    The “core” ones (@ # [ ] € è é ò à ù ç) are consistent.
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_IT_WINLIN[] = {
+static constexpr KbMapEntry KBMAP_IT_WINLIN[] = {
 
   // ----- Digits row: Shift layer symbols (IT differs from US mapping) -----
   { U'!',  MOD_SHIFT, 0x1E, 0, 0 }, // Shift+1
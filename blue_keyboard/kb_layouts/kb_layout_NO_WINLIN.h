@@ -37,7 +37,7 @@
   #define NO_KEY_AE QUOTE_KEY  // typically 0x34
 #endif
 
-static const KbMapEntry KBMAP_NO_WINLIN[] =
+static constexpr KbMapEntry KBMAP_NO_WINLIN[] =
 {
   // ------------------------------------------------------------------------
   // Norwegian letters
@@ -31,7 +31,7 @@
   #define BR_KEY_C_CEDILLA 0x33
 #endif
 
-static const KbMapEntry KBMAP_PT_BR_MAC[] =
+static constexpr KbMapEntry KBMAP_PT_BR_MAC[] =
 {
   // --------------------------------------------------------------------------
   // Core coding symbols (Option combos)
@@ -45,10 +45,10 @@ static const KbMapEntry KBMAP_PT_BR_MAC[] =
   { U'}',  MOD_ALT | MOD_SHIFT,  0x26 }, // Option+Shift+9
 
   // Backslash / pipe (best-effort using ANSI backslash position)
-  { U'\\', 0x00,                 ANSI_BSLASH_KEY },       // \
+  { U'\\', 0x00,                 ANSI_BSLASH_KEY },       // backslash
   { U'|',  MOD_SHIFT,            ANSI_BSLASH_KEY },       // |
-  { U'\\', MOD_ALT | MOD_SHIFT,  ANSI_BSLASH_KEY },       // Option+Shift+\ (fallback)
-  { U'|',  MOD_ALT,              ANSI_BSLASH_KEY },       // Option+\ (fallback)
+  // Alternatives if the host layout needs Option (one entry per codepoint):
+  //   Option+Shift+ANSI_BSLASH_KEY for backslash, Option+ANSI_BSLASH_KEY for |
 
   // --------------------------------------------------------------------------
   // Brazilian-specific letter
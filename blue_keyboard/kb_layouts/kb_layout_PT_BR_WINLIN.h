@@ -33,7 +33,7 @@
 // '-'      = 0x2D
 // '='      = 0x2E
 
-static const KbMapEntry KBMAP_PT_BR_WINLIN[] =
+static constexpr KbMapEntry KBMAP_PT_BR_WINLIN[] =
 {
   // --------------------------------------------------------------------------
   // Core AltGr symbols used for programming (pt-BR)
@@ -26,7 +26,7 @@
 //  '2' = 0x1F, '3' = 0x20, '7' = 0x24, '8' = 0x25, '9' = 0x26
 //  '[' = 0x2F, ']' = 0x30 on US physical positions (used as physical keys only)
 
-static const KbMapEntry KBMAP_PT_PT_MAC[] =
+static constexpr KbMapEntry KBMAP_PT_PT_MAC[] =
 {
   // --------------------------------------------------------------------------
   // Core programming symbols on Portuguese mac layout (Option combinations)
@@ -72,7 +72,7 @@
 ////////////////////////////////////////////////////////////////////
 //  Table: { Unicode codepoint, modifiers, HID usage }
 ////////////////////////////////////////////////////////////////////
-static const KbMapEntry KBMAP_PT_PT_WINLIN[] =
+static constexpr KbMapEntry KBMAP_PT_PT_WINLIN[] =
 {
   // ----- Digits row (Shift layer on pt-PT) -----
   { U'!',  MOD_SHIFT, 0x1E }, // Shift+1
@@ -138,7 +138,7 @@ static const KbMapEntry KBMAP_PT_PT_WINLIN[] =
   { U'-',  MOD_SHIFT, 0x38 /* '/' key */ },
 
   // ----- Alternate Euro (pt-PT also shows € on AltGr+E) -----
-  { 0x20AC /*€*/, MOD_ALTGR, 0x08 /* 'E' */ }, 
+  // Not mapped: AltGr+5 above is used (one entry per codepoint).
 };
 
 
@@ -37,7 +37,7 @@
   #define SE_KEY_O_UML  0x33   // US ';' position
 #endif
 
-static const KbMapEntry KBMAP_SE_WINLIN[] =
+static constexpr KbMapEntry KBMAP_SE_WINLIN[] =
 {
   // ------------------------------------------------------------------------
   // Swedish letters
@@ -67,7 +67,7 @@
 // For macOS: Option = MOD_ALT, Shift = MOD_SHIFT.
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_TR_MAC[] =
+static constexpr KbMapEntry KBMAP_TR_MAC[] =
 {
   // ------------------------------------------------------------------------
   // Turkish letters (lowercase + uppercase)
@@ -44,7 +44,7 @@
   #define TR_KEY_C_CEDILLA 0x00
 #endif
 
-static const KbMapEntry KBMAP_TR_WINLIN[] =
+static constexpr KbMapEntry KBMAP_TR_WINLIN[] =
 {
   // ------------------------------------------------------------------------
   // Turkish letters
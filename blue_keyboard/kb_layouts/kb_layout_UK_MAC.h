@@ -6,7 +6,7 @@
 //  Host OS must be set to: British (not "British - PC").
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_UK_MAC[] =
+static constexpr KbMapEntry KBMAP_UK_MAC[] =
 {
   // Core currency + common programming symbols
   { 0x00A3, MOD_SHIFT, 0x20, 0, 0 }, // £  = Shift + 3
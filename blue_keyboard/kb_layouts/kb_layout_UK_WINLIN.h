@@ -18,7 +18,7 @@
   #define UK_KEY_TLDE 0x35  // physical key under ESC (grave/tilde on US)
 #endif
 
-static const KbMapEntry KBMAP_UK_WINLIN[] = {
+static constexpr KbMapEntry KBMAP_UK_WINLIN[] = {
 
   // Currency
   { 0x00A3, MOD_SHIFT, 0x20, 0, 0 }, // £ = Shift+3
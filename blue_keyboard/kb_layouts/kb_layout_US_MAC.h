@@ -9,7 +9,7 @@
 //  common Unicode symbols users expect on Mac via Option.
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_US_MAC[] =
+static constexpr KbMapEntry KBMAP_US_MAC[] =
 {
   // Euro on macOS US: Option+Shift+2
   { 0x20AC, MOD_ALT | MOD_SHIFT, 0x1F /* '2' */, 0, 0 }, // €
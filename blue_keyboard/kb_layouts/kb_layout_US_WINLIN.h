@@ -9,7 +9,7 @@
 //  so we don't need any overrides.
 ////////////////////////////////////////////////////////////////////
 
-static const KbMapEntry KBMAP_US_WINLIN[] = {
+static constexpr KbMapEntry KBMAP_US_WINLIN[] = {
   // empty on purpose
 };
 
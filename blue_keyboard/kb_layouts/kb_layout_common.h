@@ -1,5 +1,11 @@
 #pragma once
+#include <stdint.h>
+
+// The tables below are plain data and also build on the host (the Linux
+// CLI translates text with them); only the send helper needs the device.
+#ifdef ARDUINO
 #include "../RawKeyboard.h"
+#endif
 
 ////////////////////////////////////////////////////////////////////
 // Common key aliases that are stable across TinyUSB naming variants.
@@ -71,10 +77,11 @@ struct KbMapEntry
   uint32_t cp;     // Unicode codepoint (e.g. 0x20AC for €)
   uint8_t  mods1;  // modifier bitmask
   uint8_t  key1;   // HID usage
-  uint8_t  mods2;  // optional second chord modifiers
-  uint8_t  key2;   // optional second chord key
+  uint8_t  mods2 = 0;  // optional second chord modifiers
+  uint8_t  key2  = 0;  // optional second chord key
 };
 
+#ifdef ARDUINO
 // Convenience: tap or chord
 static inline void sendChordOrTap(RawKeyboard& kb, uint8_t mods, uint8_t usage)
 {
@@ -82,6 +89,241 @@ static inline void sendChordOrTap(RawKeyboard& kb, uint8_t mods, uint8_t usage)
   if (mods == 0) kb.tapUsage(usage);
   else kb.chord(mods, usage);
 }
+#endif
+
+////////////////////////////////////////////////////////////////////
+// Compiled layout tables (built at compile time from the KBMAP_* arrays)
+//
+// Each layout map is turned into:
+//   - ascii[128] : direct-indexed by codepoint. Starts as the US base map
+//                  (same as the core's USBHIDKeyboard::write()) with the
+//                  layout's ASCII entries on top; key1 == 0 means the
+//                  character has no key (NUL, CR, ESC, ...) and types nothing
+//   - ext[]      : non-ASCII entries sorted by codepoint (binary search)
+//
+// The build is also where the maps get validated. Any of these is a
+// compile error (the message names the kb_err_* function below):
+//   - the same codepoint mapped twice (the old linear scan silently
+//     used the first one and the rest were dead entries)
+//   - invalid codepoint (0, UTF-16 surrogate, > U+10FFFF)
+//   - second chord with modifiers but no key (mods2 != 0, key2 == 0)
+//   - second chord without a first one
+//   - modifier usages (0xE0..0xE7) used as keys; use the mods bitmask
+//
+// Entries with key1 == 0 and no second chord are unconfigured
+// placeholders (see TR_KEY_* in the TR layouts); they are skipped so
+// the codepoint takes the US base / OS Unicode fallback path instead.
+////////////////////////////////////////////////////////////////////
+struct KbChord
+{
+  uint8_t mods1;
+  uint8_t key1;
+  uint8_t mods2;
+  uint8_t key2;
+};
+
+// Runtime view of one compiled layout
+struct KbLayoutTables
+{
+  const KbChord*    ascii;     // 128 entries
+  const KbMapEntry* ext;       // sorted by cp
+  uint16_t          extCount;
+};
+
+// Never called at runtime: reaching one of these while evaluating a
+// constexpr table makes the build fail with the function name as reason.
+inline void kb_err_duplicate_codepoint() {}
+inline void kb_err_invalid_codepoint() {}
+inline void kb_err_second_chord_without_key() {}
+inline void kb_err_second_chord_without_first() {}
+inline void kb_err_modifier_usage_as_key() {}
+
+#define KB_MAP_COUNT(arr) ((uint16_t)(sizeof(arr) / sizeof(KbMapEntry)))
+
+static constexpr bool kbIsPlaceholder(const KbMapEntry& e)
+{
+  return( e.key1 == 0 && e.mods2 == 0 && e.key2 == 0 );
+}
+
+// Validate the map and count the non-ASCII entries (size of ext[]).
+static constexpr uint16_t kbCountExt(const KbMapEntry* map, uint16_t n)
+{
+  uint16_t ext = 0;
+  for( uint16_t i = 0; i < n; ++i )
+  {
+    const KbMapEntry& e = map[i];
+
+    if( e.cp == 0 || e.cp > 0x10FFFFu || (e.cp >= 0xD800u && e.cp <= 0xDFFFu) ) kb_err_invalid_codepoint();
+    if( e.mods2 != 0 && e.key2 == 0 ) kb_err_second_chord_without_key();
+    if( e.key2 != 0 && e.key1 == 0 ) kb_err_second_chord_without_first();
+    if( e.key1 >= 0xE0 || e.key2 >= 0xE0 ) kb_err_modifier_usage_as_key();
+
+    for( uint16_t j = 0; j < i; ++j )
+    {
+      if( map[j].cp == e.cp ) kb_err_duplicate_codepoint();
+    }
+
+    if( e.cp >= 128 && !kbIsPlaceholder(e) ) ++ext;
+  }
+  return( ext );
+}
+
+// US base map for ASCII, mirrors the core's en_US _asciimap:
+// HID usage, | KB_US_SHIFT when Shift is needed, 0 = no key
+#define KB_US_SHIFT 0x80
+static constexpr uint8_t KB_US_ASCII[128] =
+{
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   // NUL..BEL
+  0x2A, 0x2B, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00,   // BS TAB LF VT FF CR SO SI
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   // DLE..ETB
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   // CAN..US
+  0x2C,                     // ' '
+  0x1E | KB_US_SHIFT,       // !
+  0x34 | KB_US_SHIFT,       // "
+  0x20 | KB_US_SHIFT,       // #
+  0x21 | KB_US_SHIFT,       // $
+  0x22 | KB_US_SHIFT,       // %
+  0x24 | KB_US_SHIFT,       // &
+  0x34,                     // '
+  0x26 | KB_US_SHIFT,       // (
+  0x27 | KB_US_SHIFT,       // )
+  0x25 | KB_US_SHIFT,       // *
+  0x2E | KB_US_SHIFT,       // +
+  0x36,                     // ,
+  0x2D,                     // -
+  0x37,                     // .
+  0x38,                     // /
+  0x27, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26,   // 0..9
+  0x33 | KB_US_SHIFT,       // :
+  0x33,                     // ;
+  0x36 | KB_US_SHIFT,       // <
+  0x2E,                     // =
+  0x37 | KB_US_SHIFT,       // >
+  0x38 | KB_US_SHIFT,       // ?
+  0x1F | KB_US_SHIFT,       // @
+  0x04 | KB_US_SHIFT, 0x05 | KB_US_SHIFT, 0x06 | KB_US_SHIFT, 0x07 | KB_US_SHIFT,   // A..D
+  0x08 | KB_US_SHIFT, 0x09 | KB_US_SHIFT, 0x0A | KB_US_SHIFT, 0x0B | KB_US_SHIFT,   // E..H
+  0x0C | KB_US_SHIFT, 0x0D | KB_US_SHIFT, 0x0E | KB_US_SHIFT, 0x0F | KB_US_SHIFT,   // I..L
+  0x10 | KB_US_SHIFT, 0x11 | KB_US_SHIFT, 0x12 | KB_US_SHIFT, 0x13 | KB_US_SHIFT,   // M..P
+  0x14 | KB_US_SHIFT, 0x15 | KB_US_SHIFT, 0x16 | KB_US_SHIFT, 0x17 | KB_US_SHIFT,   // Q..T
+  0x18 | KB_US_SHIFT, 0x19 | KB_US_SHIFT, 0x1A | KB_US_SHIFT, 0x1B | KB_US_SHIFT,   // U..X
+  0x1C | KB_US_SHIFT, 0x1D | KB_US_SHIFT,                                           // Y Z
+  0x2F,                     // [
+  0x31,                     // backslash
+  0x30,                     // ]
+  0x23 | KB_US_SHIFT,       // ^
+  0x2D | KB_US_SHIFT,       // _
+  0x35,                     // `
+  0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,    // a..m
+  0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D,    // n..z
+  0x2F | KB_US_SHIFT,       // {
+  0x31 | KB_US_SHIFT,       // |
+  0x30 | KB_US_SHIFT,       // }
+  0x35 | KB_US_SHIFT,       // ~
+  0x00                      // DEL
+};
+
+// Dead-key compositions (accent, then base letter) for characters a
+// layout can reach through its own dead keys. A layout declares a dead
+// key by mapping the accent as "dead key, then Space" (see DE_WINLIN
+// '^', ES_MAC '~'); the OS then composes accent + letter by itself.
+struct KbCompose
+{
+  uint16_t cp;       // composed character
+  uint8_t  accent;   // spacing accent the dead key types: ` ^ ~ or 0xB4 ´ / 0xA8 ¨
+  uint8_t  base;     // ASCII letter
+};
+
+static constexpr KbCompose KB_COMPOSE[] =
+{
+  { 0x00C0, '`',  'A' }, { 0x00C1, 0xB4, 'A' }, { 0x00C2, '^',  'A' }, { 0x00C3, '~',  'A' }, { 0x00C4, 0xA8, 'A' },
+  { 0x00C8, '`',  'E' }, { 0x00C9, 0xB4, 'E' }, { 0x00CA, '^',  'E' }, { 0x00CB, 0xA8, 'E' },
+  { 0x00CC, '`',  'I' }, { 0x00CD, 0xB4, 'I' }, { 0x00CE, '^',  'I' }, { 0x00CF, 0xA8, 'I' },
+  { 0x00D1, '~',  'N' },
+  { 0x00D2, '`',  'O' }, { 0x00D3, 0xB4, 'O' }, { 0x00D4, '^',  'O' }, { 0x00D5, '~',  'O' }, { 0x00D6, 0xA8, 'O' },
+  { 0x00D9, '`',  'U' }, { 0x00DA, 0xB4, 'U' }, { 0x00DB, '^',  'U' }, { 0x00DC, 0xA8, 'U' },
+  { 0x00DD, 0xB4, 'Y' },
+  { 0x00E0, '`',  'a' }, { 0x00E1, 0xB4, 'a' }, { 0x00E2, '^',  'a' }, { 0x00E3, '~',  'a' }, { 0x00E4, 0xA8, 'a' },
+  { 0x00E8, '`',  'e' }, { 0x00E9, 0xB4, 'e' }, { 0x00EA, '^',  'e' }, { 0x00EB, 0xA8, 'e' },
+  { 0x00EC, '`',  'i' }, { 0x00ED, 0xB4, 'i' }, { 0x00EE, '^',  'i' }, { 0x00EF, 0xA8, 'i' },
+  { 0x00F1, '~',  'n' },
+  { 0x00F2, '`',  'o' }, { 0x00F3, 0xB4, 'o' }, { 0x00F4, '^',  'o' }, { 0x00F5, '~',  'o' }, { 0x00F6, 0xA8, 'o' },
+  { 0x00F9, '`',  'u' }, { 0x00FA, 0xB4, 'u' }, { 0x00FB, '^',  'u' }, { 0x00FC, 0xA8, 'u' },
+  { 0x00FD, 0xB4, 'y' }, { 0x00FF, 0xA8, 'y' },
+};
+
+static inline const KbCompose* kbFindCompose(uint32_t cp)
+{
+  for( const KbCompose& c : KB_COMPOSE )
+  {
+    if( c.cp == cp ) return( &c );
+  }
+  return( nullptr );
+}
+
+template <uint16_t NEXT>
+struct KbCompiledMap
+{
+  KbChord    ascii[128];
+  KbMapEntry ext[NEXT ? NEXT : 1];
+  uint16_t   extCount;
+
+  constexpr KbLayoutTables view() const { return { ascii, ext, extCount }; }
+};
+
+template <uint16_t NEXT>
+static constexpr KbCompiledMap<NEXT> kbCompileMap(const KbMapEntry* map, uint16_t n)
+{
+  KbCompiledMap<NEXT> t{};
+
+  for( uint8_t c = 0; c < 128; ++c )
+  {
+    const uint8_t u = KB_US_ASCII[c];
+    t.ascii[c] = { (uint8_t)((u & KB_US_SHIFT) ? MOD_SHIFT : 0), (uint8_t)(u & 0x7F), 0, 0 };
+  }
+
+  for( uint16_t i = 0; i < n; ++i )
+  {
+    const KbMapEntry& e = map[i];
+    if( kbIsPlaceholder(e) ) continue;
+
+    if( e.cp < 128 )
+    {
+      t.ascii[e.cp] = { e.mods1, e.key1, e.mods2, e.key2 };
+      continue;
+    }
+
+    // insertion sort by codepoint
+    uint16_t k = t.extCount++;
+    while( k > 0 && t.ext[k - 1].cp > e.cp )
+    {
+      t.ext[k] = t.ext[k - 1];
+      --k;
+    }
+    t.ext[k] = e;
+  }
+  return( t );
+}
+
+// Compile KBMAP_<NAME> into KBC_<NAME> (validation happens here)
+#define KB_COMPILE_LAYOUT(NAME) \
+  static constexpr auto KBC_##NAME = \
+    kbCompileMap<kbCountExt(KBMAP_##NAME, KB_MAP_COUNT(KBMAP_##NAME))>(KBMAP_##NAME, KB_MAP_COUNT(KBMAP_##NAME))
+
+// Lookup of a non-ASCII codepoint in a compiled layout (nullptr if absent)
+static inline const KbMapEntry* kbFindExt(const KbLayoutTables& t, uint32_t cp)
+{
+  uint16_t lo = 0, hi = t.extCount;
+  while( lo < hi )
+  {
+    const uint16_t mid = (uint16_t)((lo + hi) >> 1);
+    const uint32_t v   = t.ext[mid].cp;
+    if( v == cp ) return( &t.ext[mid] );
+    if( v < cp ) lo = (uint16_t)(mid + 1);
+    else hi = mid;
+  }
+  return( nullptr );
+}
 
 ////////////////////////////////////////////////////////////////////
 // TV media remap result
@@ -208,6 +208,80 @@ static inline const KbMapEntry* getLayoutMap(KeyboardLayout lay, uint16_t& count
   }
 }
 
+////////////////////////////////////////////////////////////////////
+// :: Compiled layout tables (see kb_layout_common.h)
+// Built and validated at compile time; a duplicate or malformed entry in
+// any KBMAP_* table fails the build here.
+////////////////////////////////////////////////////////////////////
+KB_COMPILE_LAYOUT(US_WINLIN);
+KB_COMPILE_LAYOUT(US_MAC);
+KB_COMPILE_LAYOUT(UK_WINLIN);
+KB_COMPILE_LAYOUT(UK_MAC);
+KB_COMPILE_LAYOUT(IE_WINLIN);
+KB_COMPILE_LAYOUT(IE_MAC);
+KB_COMPILE_LAYOUT(DE_WINLIN);
+KB_COMPILE_LAYOUT(DE_MAC);
+KB_COMPILE_LAYOUT(FR_WINLIN);
+KB_COMPILE_LAYOUT(FR_MAC);
+KB_COMPILE_LAYOUT(ES_WINLIN);
+KB_COMPILE_LAYOUT(ES_MAC);
+KB_COMPILE_LAYOUT(IT_WINLIN);
+KB_COMPILE_LAYOUT(IT_MAC);
+KB_COMPILE_LAYOUT(PT_PT_WINLIN);
+KB_COMPILE_LAYOUT(PT_PT_MAC);
+KB_COMPILE_LAYOUT(PT_BR_WINLIN);
+KB_COMPILE_LAYOUT(PT_BR_MAC);
+KB_COMPILE_LAYOUT(SE_WINLIN);
+KB_COMPILE_LAYOUT(NO_WINLIN);
+KB_COMPILE_LAYOUT(DK_WINLIN);
+KB_COMPILE_LAYOUT(FI_WINLIN);
+KB_COMPILE_LAYOUT(CH_DE_WINLIN);
+KB_COMPILE_LAYOUT(CH_FR_WINLIN);
+KB_COMPILE_LAYOUT(TR_WINLIN);
+KB_COMPILE_LAYOUT(TR_MAC);
+
+static inline KbLayoutTables getLayoutTables(KeyboardLayout lay)
+{
+  switch (lay)
+  {
+    case KeyboardLayout::US_WINLIN:    return KBC_US_WINLIN.view();
+    case KeyboardLayout::US_MAC:       return KBC_US_MAC.view();
+    case KeyboardLayout::UK_WINLIN:    return KBC_UK_WINLIN.view();
+    case KeyboardLayout::UK_MAC:       return KBC_UK_MAC.view();
+    case KeyboardLayout::IE_WINLIN:    return KBC_IE_WINLIN.view();
+    case KeyboardLayout::IE_MAC:       return KBC_IE_MAC.view();
+    case KeyboardLayout::DE_WINLIN:    return KBC_DE_WINLIN.view();
+    case KeyboardLayout::DE_MAC:       return KBC_DE_MAC.view();
+    case KeyboardLayout::FR_WINLIN:    return KBC_FR_WINLIN.view();
+    case KeyboardLayout::FR_MAC:       return KBC_FR_MAC.view();
+    case KeyboardLayout::ES_WINLIN:    return KBC_ES_WINLIN.view();
+    case KeyboardLayout::ES_MAC:       return KBC_ES_MAC.view();
+    case KeyboardLayout::IT_WINLIN:    return KBC_IT_WINLIN.view();
+    case KeyboardLayout::IT_MAC:       return KBC_IT_MAC.view();
+    case KeyboardLayout::PT_PT_WINLIN: return KBC_PT_PT_WINLIN.view();
+    case KeyboardLayout::PT_PT_MAC:    return KBC_PT_PT_MAC.view();
+    case KeyboardLayout::PT_BR_WINLIN: return KBC_PT_BR_WINLIN.view();
+    case KeyboardLayout::PT_BR_MAC:    return KBC_PT_BR_MAC.view();
+    case KeyboardLayout::SE_WINLIN:    return KBC_SE_WINLIN.view();
+    case KeyboardLayout::NO_WINLIN:    return KBC_NO_WINLIN.view();
+    case KeyboardLayout::DK_WINLIN:    return KBC_DK_WINLIN.view();
+    case KeyboardLayout::FI_WINLIN:    return KBC_FI_WINLIN.view();
+    case KeyboardLayout::CH_DE_WINLIN: return KBC_CH_DE_WINLIN.view();
+    case KeyboardLayout::CH_FR_WINLIN: return KBC_CH_FR_WINLIN.view();
+    case KeyboardLayout::TR_WINLIN:    return KBC_TR_WINLIN.view();
+    case KeyboardLayout::TR_MAC:       return KBC_TR_MAC.view();
+
+    // tv layouts type with the US map
+    case KeyboardLayout::TV_SAMSUNG:
+    case KeyboardLayout::TV_LG:
+    case KeyboardLayout::TV_ANDROID:
+    case KeyboardLayout::TV_ROKU:
+    case KeyboardLayout::TV_FIRETV:
+    default:
+      return KBC_US_WINLIN.view();
+  }
+}
+
 // ---------------------------------------------------------------------------
 // TV layout helpers (layouts >= 200)
 // ---------------------------------------------------------------------------
@@ -315,16 +389,95 @@ inline void sendAltGrCombo(RawKeyboard& kb, uint8_t baseUsage)
 #endif
 }
 
+////////////////////////////////////////////////////////////////////
+// Compiled key sequences
+//
+// What a codepoint without a plain map entry turns into (dead-key
+// composition or OS Unicode input), built once into a list of steps
+// and replayed from the sequence cache (see kbSeqFor()).
+//   raw = 0 : steps are keys for the packed typing path (typeUsage)
+//   raw = 1 : steps are whole reports, one key at most, sent as is
+//             (Alt+numpad, Option+hex need the modifier held alone)
+////////////////////////////////////////////////////////////////////
+// Option+hex surrogate pair: 2 x (Option, 4 x (key, Option), release)
+#define KB_SEQ_MAX 20
+
+struct KbSeqStep
+{
+  uint8_t mods;
+  uint8_t usage;
+};
+
+struct KbSeq
+{
+  uint8_t   raw;
+  uint8_t   n;
+  KbSeqStep step[KB_SEQ_MAX];
+};
+
+static inline bool kbSeqAdd(KbSeq& seq, uint8_t mods, uint8_t usage)
+{
+  if( seq.n >= KB_SEQ_MAX ) return( false );
+  seq.step[seq.n++] = { mods, usage };
+  return( true );
+}
+
+// packed typing keys of a map chord pair (mods2/key2 optional)
+static inline void kbSeqChords(KbSeq& seq, uint8_t mods1, uint8_t key1, uint8_t mods2, uint8_t key2)
+{
+  if( key1 ) kbSeqAdd(seq, mods1, key1);
+  if( key2 ) kbSeqAdd(seq, mods2, key2);
+}
+
+static inline void kbSeqEmit(RawKeyboard& kb, const KbSeq& seq)
+{
+  if( !seq.raw )
+  {
+    for( uint8_t i = 0; i < seq.n; ++i ) kb.typeUsage(seq.step[i].mods, seq.step[i].usage);
+    return;
+  }
+
+  kb.typeRelease();
+  for( uint8_t i = 0; i < seq.n; ++i )
+  {
+    KeyReport rpt = {};
+    rpt.modifiers = seq.step[i].mods;
+    rpt.keys[0]   = seq.step[i].usage;
+    kb.emitReport(rpt);
+  }
+}
+
+// Number of HID reports the sequence sends (from and back to all-up),
+// replays the packed typing rules of RawKeyboard::typeUsage().
+static inline uint8_t kbSeqCost(const KbSeq& seq)
+{
+  if( seq.raw ) return( seq.n );
+
+  uint8_t cost = 0, mods = 0, count = 0;
+  uint8_t keys[6] = {};
+  for( uint8_t i = 0; i < seq.n; ++i )
+  {
+    const KbSeqStep& st = seq.step[i];
+    bool held = false;
+    for( uint8_t k = 0; k < count; ++k ) held |= (keys[k] == st.usage);
+
+    if( (count || mods) && (st.mods != mods || count >= 6 || held) ) { cost++; count = 0; }
+    mods = st.mods;
+    keys[count++] = st.usage;
+    cost++;
+  }
+  if( count || mods ) cost++;
+  return( cost );
+}
+
 // ---------- Alt+Numpad using RAW reports (Windows US path) ----------
-inline void altNumpadRaw( RawKeyboard& kb, const char* digits ) 
+inline void kbSeqAltNumpad( KbSeq& seq, const char* digits ) 
 {
   // Hold Left-Alt (modifier bit 0x04) and tap keypad digits as raw usages
   // Press Alt only once, then send each digit in the same report sequence.
   // (Windows accepts either style - is this approach reliable?)
-  KeyReport rpt = {};
-  rpt.modifiers = 0x04; // LAlt
-  kb.sendReport(&rpt);  // press Alt
-  delay(2);
+  seq.raw = 1;
+  kbSeqAdd(seq, 0x04, 0);  // press Alt (LAlt)
 
   for( const char* p = digits; *p; ++p ) 
   {
@@ -344,21 +497,12 @@ inline void altNumpadRaw( RawKeyboard& kb, const char* digits )
       default: continue;
     }
 
-    // press digit
-    KeyReport down = rpt;
-    down.keys[0] = u;
-    kb.sendReport(&down);
-    delay(2);
-
-    // release digit (keep Alt held)
-    kb.sendReport(&rpt);
-    delay(2);
+    kbSeqAdd(seq, 0x04, u);  // press digit
+    kbSeqAdd(seq, 0x04, 0);  // release digit (keep Alt held)
   }
 
   // release Alt
-  KeyReport up = {};
-  kb.sendReport(&up);
-  delay(2);
+  kbSeqAdd(seq, 0, 0);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -408,6 +552,76 @@ static inline bool utf8NextCodepoint(const char*& s, uint32_t& outCp)
   return true;
 }
 
+////////////////////////////////////////////////////////////////////
+// Incremental UTF-8 -> codepoint (streamed SEND_STRING)
+//
+// Fed one byte at a time, so a sequence may be split across chunks.
+// Gives the same codepoints as utf8NextCodepoint(): a bad sequence
+// yields U+FFFD for its lead byte and the bytes after it are decoded
+// again. A NUL byte yields cp 0 (caller stops there, like the walker).
+////////////////////////////////////////////////////////////////////
+struct Utf8Stream
+{
+  uint8_t seq[4];
+  uint8_t have = 0;   // bytes of the current sequence collected
+  uint8_t need = 0;   // its full length (0 = between sequences)
+};
+
+// at most this many codepoints come out of one byte
+#define UTF8_STREAM_MAX_CP 4
+
+// end of text (or bad byte): an unfinished sequence is U+FFFD per byte
+static inline uint8_t utf8StreamFlush(Utf8Stream& u, uint32_t* out)
+{
+  const uint8_t n = u.have;
+  for (uint8_t i = 0; i < n; ++i) out[i] = 0xFFFD;
+  u.have = u.need = 0;
+  return n;
+}
+
+static inline uint8_t utf8StreamStart(Utf8Stream& u, uint8_t b, uint32_t* out)
+{
+  if (b < 0x80) { out[0] = b; return 1; }
+
+  const uint8_t len = ((b & 0xE0) == 0xC0) ? 2 :
+                      ((b & 0xF0) == 0xE0) ? 3 :
+                      ((b & 0xF8) == 0xF0) ? 4 : 0;
+  if (!len) { out[0] = 0xFFFD; return 1; }
+
+  u.seq[0] = b;
+  u.have   = 1;
+  u.need   = len;
+  return 0;
+}
+
+// feed one byte, returns the number of codepoints written to out
+static inline uint8_t utf8StreamFeed(Utf8Stream& u, uint8_t b, uint32_t out[UTF8_STREAM_MAX_CP])
+{
+  if (!u.need) return utf8StreamStart(u, b, out);
+
+  if ((b & 0xC0) != 0x80)
+  {
+    // bad sequence: lead + collected bytes become U+FFFD, b starts over
+    const uint8_t n = utf8StreamFlush(u, out);
+    return (uint8_t)(n + utf8StreamStart(u, b, out + n));
+  }
+
+  u.seq[u.have++] = b;
+  if (u.have < u.need) return 0;
+
+  const uint8_t* c = u.seq;
+  if (u.need == 2)
+    out[0] = ((uint32_t)(c[0] & 0x1F) << 6) | (uint32_t)(c[1] & 0x3F);
+  else if (u.need == 3)
+    out[0] = ((uint32_t)(c[0] & 0x0F) << 12) | ((uint32_t)(c[1] & 0x3F) << 6) | (uint32_t)(c[2] & 0x3F);
+  else
+    out[0] = ((uint32_t)(c[0] & 0x07) << 18) | ((uint32_t)(c[1] & 0x3F) << 12) |
+             ((uint32_t)(c[2] & 0x3F) << 6)  |  (uint32_t)(c[3] & 0x3F);
+
+  u.have = u.need = 0;
+  return 1;
+}
+
 ////////////////////////////////////////////////////////////////////
 static inline bool isMacLayout(KeyboardLayout lay)
 {
@@ -416,51 +630,42 @@ static inline bool isMacLayout(KeyboardLayout lay)
 }
 
 ////////////////////////////////////////////////////////////////////
-// ========================= Send one codepoint using current layout map =========================
-// - If codepoint exists in map: emit (mods1,key1) then optional (mods2,key2)
-// - Else if ASCII (<128): fallback kb.write()
-// - Else: drop silently (Option A)
+// Minimum gap between HID reports per host family, in us.
+// 0 = USB pacing only (report complete + tud_hid_ready, see hid_emitter.h).
+// Raise it for hosts/apps that lose keys at the full endpoint rate
+// (remote desktops, VMs). TV boxes keep roughly the old fixed timing.
 ////////////////////////////////////////////////////////////////////
-static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
-{
-	uint16_t n = 0;
-	const KbMapEntry* map = getLayoutMap(m_nKeyboardLayout, n);
-
-	// 1) Try explicit layout map first (special chars)
-	if( map )
-	{
-		for( uint16_t i = 0; i < n; ++i )
-		{
-			if( map[i].cp == cp )
-			{
-				sendChordOrTap(kb, map[i].mods1, map[i].key1);
-				sendChordOrTap(kb, map[i].mods2, map[i].key2);
-				return( true );
-			}
-		}
-	}
-
-	// 2) ASCII fallback (existing behavior)
-	if( cp < 128 )
-	{
-		kb.write( (char)cp );
-		return( true );
-	}
-
-	// 3) Unicode fallback (OS-specific input sequence)
-	// Note: HID cannot "send unicode" - can only type OS input sequences.
+#ifndef BK_HID_MIN_GAP_US_PC
+  #define BK_HID_MIN_GAP_US_PC  0
+#endif
+#ifndef BK_HID_MIN_GAP_US_MAC
+  #define BK_HID_MIN_GAP_US_MAC 0
+#endif
+#ifndef BK_HID_MIN_GAP_US_TV
+  #define BK_HID_MIN_GAP_US_TV  2000
+#endif
 
-	// Reject invalid Unicode scalars
-	if( cp > 0x10FFFFu || (cp >= 0xD800u && cp <= 0xDFFFu) ) return( false );
+static inline uint32_t hidMinGapUsFor(KeyboardLayout lay)
+{
+    if( isTvLayout(lay) ) return( BK_HID_MIN_GAP_US_TV );
+    if( isMacLayout(lay) ) return( BK_HID_MIN_GAP_US_MAC );
+    return( BK_HID_MIN_GAP_US_PC );
+}
 
+////////////////////////////////////////////////////////////////////
+// OS-specific Unicode input sequence for a codepoint (last resort)
+// Note: HID cannot "send unicode" - can only type OS input sequences.
+////////////////////////////////////////////////////////////////////
+static inline bool kbPlanOsInput(KeyboardLayout lay, uint32_t cp, KbSeq& seq)
+{
 	///////////////////////////////
     // :: If MAC layout active: use macOS Unicode Hex Input (Option+hex)
     // Requires "Unicode Hex Input" enabled on the host.
-    if( isMacLayout(m_nKeyboardLayout) )
+    if( isMacLayout(lay) )
     {
         // macOS expects UTF-16 code units. For emoji (cp > 0xFFFF),
         // send surrogate pair as two 4-hex sequences.
-        auto sendMacHex4 = [&](uint16_t u16) -> void {
+        auto addMacHex4 = [&](uint16_t u16) -> void {
             const uint8_t MOD_LALT = 0x04; // Option (Left Alt)
 
             auto hexNibbleToUsage = [](uint8_t nib) -> uint8_t {
@@ -476,10 +681,7 @@ static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
             };
 
             // press+hold Option
-            KeyReport held = {};
-            held.modifiers = MOD_LALT;
-            kb.sendReport(&held);
-            delay(2);
+            kbSeqAdd(seq, MOD_LALT, 0);
 
             for( int shift = 12; shift >= 0; shift -= 4 )
             {
@@ -487,33 +689,28 @@ static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
                 const uint8_t usage = hexNibbleToUsage(nib);
                 if( !usage ) break;
 
-                KeyReport down = held;
-                down.keys[0] = usage;
-                kb.sendReport(&down);
-                delay(2);
-
+                kbSeqAdd(seq, MOD_LALT, usage);
+                
                 // release key, keep Option held
-                kb.sendReport(&held);
-                delay(2);
+                kbSeqAdd(seq, MOD_LALT, 0);
             }
 
             // release Option
-            KeyReport up = {};
-            kb.sendReport(&up);
-            delay(2);
+            kbSeqAdd(seq, 0, 0);
         };
 
+        seq.raw = 1;
         if( cp > 0xFFFFu )
         {
             const uint32_t v = cp - 0x10000u;
             const uint16_t hi = (uint16_t)(0xD800u + (v >> 10));
             const uint16_t lo = (uint16_t)(0xDC00u + (v & 0x3FFu));
-            sendMacHex4(hi);
-            sendMacHex4(lo);
+            addMacHex4(hi);
+            addMacHex4(lo);
         }
         else
         {
-            sendMacHex4((uint16_t)cp);
+            addMacHex4((uint16_t)cp);
         }
 
         return( true );
@@ -542,7 +739,7 @@ static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
 		return 0;
 	};
 
-	auto sendHexDigits = [&](uint32_t value) -> bool {
+	auto addHexDigits = [&](uint32_t value) -> bool {
 		// minimal hex (no leading zeros), lowercase
 		char buf[9] = {0}; // up to 8 hex digits + NUL
 		int idx = 0;
@@ -564,7 +761,7 @@ static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
 				u = hexLetterUsage(c);
 
 			if (!u) return false;
-			kb.sendRaw(0x00, u);
+			kbSeqAdd(seq, 0x00, u);
 		}
 		return( true );
 	};
@@ -573,11 +770,11 @@ static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
 	const uint8_t USAGE_U          = 0x18;
 	const uint8_t USAGE_ENTER      = 0x28;
 
-	kb.sendRaw( MOD_LCTRL_LSHIFT, USAGE_U );
+	kbSeqAdd(seq, MOD_LCTRL_LSHIFT, USAGE_U);
 
-	if( !sendHexDigits(cp) ) return false;
+	if( !addHexDigits(cp) ) return false;
 
-	kb.sendRaw(0x00, USAGE_ENTER);
+	kbSeqAdd(seq, 0x00, USAGE_ENTER);
 	return( true );
 
 #else
@@ -620,13 +817,248 @@ static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
 		digits[pos] = 0;
 	}
 
-	altNumpadRaw(kb, digits);
+	kbSeqAltNumpad(seq, digits);
 	return( true );
 
 #endif
+}
 
-	// dead end - should not reach here
+////////////////////////////////////////////////////////////////////
+// Dead-key composition through the layout's own dead keys
+// (see KB_COMPOSE): accent dead key, then the base letter.
+// Off with BK_DEADKEY_COMPOSE 0 (hosts using "no dead keys" variants).
+////////////////////////////////////////////////////////////////////
+#ifndef BK_DEADKEY_COMPOSE
+  #define BK_DEADKEY_COMPOSE 1
+#endif
+
+static inline bool kbPlanDeadKey(const KbLayoutTables& tbl, uint32_t cp, KbSeq& seq)
+{
+#if BK_DEADKEY_COMPOSE
+	const KbCompose* c = kbFindCompose(cp);
+	if( !c ) return( false );
+
+	// the accent must be mapped as "dead key, then Space"
+	KbChord dead = {};
+	if( c->accent < 128 )
+	{
+		dead = tbl.ascii[c->accent];
+	} else if( const KbMapEntry* e = kbFindExt(tbl, c->accent) )
+	{
+		dead = { e->mods1, e->key1, e->mods2, e->key2 };
+	}
+	if( !dead.key1 || dead.mods2 || dead.key2 != 0x2C ) return( false );
+
+	// and the letter a single chord
+	const KbChord& base = tbl.ascii[c->base];
+	if( !base.key1 || base.key2 ) return( false );
+
+	kbSeqAdd(seq, dead.mods1, dead.key1);
+	kbSeqAdd(seq, base.mods1, base.key1);
+	return( true );
+#else
+	(void)tbl; (void)cp; (void)seq;
 	return( false );
+#endif
+}
+
+////////////////////////////////////////////////////////////////////
+// Pick the encoding for a codepoint: the cheapest (fewest HID reports)
+// of map entry, dead-key composition and OS Unicode input.
+////////////////////////////////////////////////////////////////////
+enum KbPath : uint8_t
+{
+	KB_PATH_NONE = 0,   // not typeable (invalid scalar)
+	KB_PATH_ASCII,      // ascii[] table (layout entry or US base)
+	KB_PATH_MAP,        // layout map entry (one chord, or dead key + chord)
+	KB_PATH_DEADKEY,    // composed via the layout's dead keys
+	KB_PATH_OS          // Alt+numpad / Ctrl+Shift+U / Option+hex
+};
+
+static inline const char* kbPathName(uint8_t path)
+{
+	switch( path )
+	{
+		case KB_PATH_ASCII:   return "ascii";
+		case KB_PATH_MAP:     return "map";
+		case KB_PATH_DEADKEY: return "deadkey";
+		case KB_PATH_OS:      return "os";
+		default:              return "none";
+	}
+}
+
+static inline uint8_t kbPlanCodepoint(KeyboardLayout lay, uint32_t cp, KbSeq& seq)
+{
+	const KbLayoutTables tbl = getLayoutTables(lay);
+	seq = KbSeq();
+
+	if( cp < 128 )
+	{
+		const KbChord& c = tbl.ascii[cp];
+		kbSeqChords(seq, c.mods1, c.key1, c.mods2, c.key2);
+		return( KB_PATH_ASCII );
+	}
+
+	// a layout entry is what the layout author chose - always used
+	if( const KbMapEntry* e = kbFindExt(tbl, cp) )
+	{
+		kbSeqChords(seq, e->mods1, e->key1, e->mods2, e->key2);
+		return( KB_PATH_MAP );
+	}
+
+	// Reject invalid Unicode scalars
+	if( cp > 0x10FFFFu || (cp >= 0xD800u && cp <= 0xDFFFu) ) return( KB_PATH_NONE );
+
+	KbSeq os = {};
+	const bool haveOs = kbPlanOsInput(lay, cp, os);
+
+	if( kbPlanDeadKey(tbl, cp, seq) && (!haveOs || kbSeqCost(seq) <= kbSeqCost(os)) ) return( KB_PATH_DEADKEY );
+
+	if( !haveOs ) return( KB_PATH_NONE );
+	seq = os;
+	return( KB_PATH_OS );
+}
+
+////////////////////////////////////////////////////////////////////
+// LRU cache of compiled sequences, keyed by (layout, codepoint).
+// Only codepoints that need planning (dead key / OS input) go in;
+// ASCII and map entries are direct table lookups already.
+////////////////////////////////////////////////////////////////////
+#ifndef BK_SEQ_CACHE_SIZE
+  #define BK_SEQ_CACHE_SIZE 32
+#endif
+
+struct KbSeqCacheEntry
+{
+	uint32_t cp;
+	uint32_t lastUse;   // 0 = empty slot
+	uint8_t  layout;
+	uint8_t  path;
+	KbSeq    seq;
+};
+
+static KbSeqCacheEntry s_kbSeqCache[BK_SEQ_CACHE_SIZE];
+static uint32_t        s_kbSeqClock  = 0;
+static uint32_t        s_kbSeqHits   = 0;
+static uint32_t        s_kbSeqMisses = 0;
+
+// Compiled sequence for a codepoint (nullptr if it can't be typed)
+static inline const KbSeqCacheEntry* kbSeqFor(KeyboardLayout lay, uint32_t cp)
+{
+	KbSeqCacheEntry* victim = &s_kbSeqCache[0];
+	for( KbSeqCacheEntry& e : s_kbSeqCache )
+	{
+		if( e.lastUse && e.cp == cp && e.layout == (uint8_t)lay )
+		{
+			e.lastUse = ++s_kbSeqClock;
+			s_kbSeqHits++;
+			return( &e );
+		}
+		if( e.lastUse < victim->lastUse ) victim = &e;
+	}
+
+	s_kbSeqMisses++;
+	KbSeq seq;
+	const uint8_t path = kbPlanCodepoint(lay, cp, seq);
+	if( path == KB_PATH_NONE ) return( nullptr );
+
+	victim->cp      = cp;
+	victim->layout  = (uint8_t)lay;
+	victim->path    = path;
+	victim->seq     = seq;
+	victim->lastUse = ++s_kbSeqClock;
+	return( victim );
+}
+
+////////////////////////////////////////////////////////////////////
+// ========================= Send one codepoint using current layout map =========================
+// - If codepoint exists in map: emit (mods1,key1) then optional (mods2,key2)
+// - Else if ASCII (<128): US base map (same keys the core's kb.write() used)
+// - Else: dead-key composition or OS-specific Unicode input sequence,
+//   whichever is shorter (compiled once, then from the sequence cache)
+//
+// Map lookup is O(1) for ASCII (direct index) and a binary search over the
+// layout's sorted non-ASCII entries otherwise.
+//
+// Mapped keys go through the packed typing path (RawKeyboard::typeUsage);
+// the caller must kb.typeRelease() when done (sendUnicodeAware does).
+////////////////////////////////////////////////////////////////////
+static inline bool sendCodepointMapped(RawKeyboard& kb, uint32_t cp)
+{
+	const KbLayoutTables tbl = getLayoutTables(m_nKeyboardLayout);
+
+	// 1) ASCII: layout map entry, else US base (both are in the compiled table)
+	if( cp < 128 )
+	{
+		const KbChord& c = tbl.ascii[cp];
+		kb.typeUsage(c.mods1, c.key1);
+		kb.typeUsage(c.mods2, c.key2);
+		return( true );
+	}
+
+	// 2) Explicit layout map for non-ASCII (special chars)
+	if( const KbMapEntry* e = kbFindExt(tbl, cp) )
+	{
+		kb.typeUsage(e->mods1, e->key1);
+		kb.typeUsage(e->mods2, e->key2);
+		return( true );
+	}
+
+	// 3) Dead-key composition / Unicode fallback
+	const KbSeqCacheEntry* c = kbSeqFor(m_nKeyboardLayout, cp);
+	if( !c ) return( false );
+
+	kbSeqEmit(kb, c->seq);
+	return( true );
+}
+
+////////////////////////////////////////////////////////////////////
+// Per-layout encoding report (BK_LAYOUT_REPORT 1: printed on layout
+// change). Lists which path each non-ASCII codepoint of interest takes
+// (Latin-1, the layout's own map, common typography) and its cost in
+// HID reports, then a summary per path.
+////////////////////////////////////////////////////////////////////
+#ifndef BK_LAYOUT_REPORT
+  #define BK_LAYOUT_REPORT 0
+#endif
+
+[[maybe_unused]] static void kbPrintLayoutReport(Print& out, KeyboardLayout lay)
+{
+	static const uint32_t extra[] = { 0x2013, 0x2014, 0x2018, 0x2019, 0x201C, 0x201D,
+	                                  0x2022, 0x2026, 0x20AC, 0x2122, 0x1F600 };
+	uint32_t count[KB_PATH_OS + 1] = {};
+	uint32_t cost[KB_PATH_OS + 1]  = {};
+
+	auto one = [&](uint32_t cp) {
+		KbSeq seq;
+		const uint8_t path = kbPlanCodepoint(lay, cp, seq);
+		const uint8_t c = (path == KB_PATH_NONE) ? 0 : kbSeqCost(seq);
+		count[path]++;
+		cost[path] += c;
+		if( path != KB_PATH_ASCII ) out.printf("  U+%04lX %-8s %u\n", (unsigned long)cp, kbPathName(path), c);
+	};
+
+	out.printf("[LAYOUT] %s encoding report\n", layoutName(lay));
+
+	for( uint32_t cp = 0x20; cp < 0x7F; ++cp ) one(cp);
+	for( uint32_t cp = 0xA0; cp <= 0xFF; ++cp ) one(cp);
+
+	const KbLayoutTables tbl = getLayoutTables(lay);
+	for( uint16_t i = 0; i < tbl.extCount; ++i )
+	{
+		if( tbl.ext[i].cp > 0xFF ) one(tbl.ext[i].cp);
+	}
+	for( uint32_t cp : extra )
+	{
+		if( !kbFindExt(tbl, cp) ) one(cp);
+	}
+
+	for( uint8_t p = KB_PATH_ASCII; p <= KB_PATH_OS; ++p )
+	{
+		out.printf("  %-8s %3lu chars, avg %lu reports\n", kbPathName(p), (unsigned long)count[p],
+					(unsigned long)(count[p] ? cost[p] / count[p] : 0));
+	}
+	out.printf("  seq cache hits=%lu misses=%lu\n", (unsigned long)s_kbSeqHits, (unsigned long)s_kbSeqMisses);
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -640,15 +1072,13 @@ static inline void sendUnicodeAware(RawKeyboard& kb, const char* s)
     if (!utf8NextCodepoint(s, cp))
       break;
 
-    // Keep current behavior for basic controls:
-    if( cp == '\t' || cp == '\n' || cp == '\r' )
-    {
-      kb.write((char)cp);
-      continue;
-    }
-
+    // basic controls (\t \n, \r types nothing) come from the US base
+    // part of the ASCII table, same as the old kb.write() path
     (void)sendCodepointMapped(kb, cp);
   }
+
+  // release whatever the packed typing path still holds
+  kb.typeRelease();
 }
 
 #endif
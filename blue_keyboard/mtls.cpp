@@ -32,6 +32,21 @@
 //   K_mac = HMAC(sessKey32, "MAC")
 //   K_iv  = HMAC(sessKey32, "IVK")
 //
+// Resumption (PROTO 1.15+, see "Session resumption tickets" below):
+//
+//   B4/B5 = ticket request / ticket (inside B3)
+//   B6  = client -> dongle : RESUME, instead of B1
+//   B7  = dongle -> client : RESUMED, instead of B2
+//
+// Record mode (PROTO 1.16+, see "Record modes" below): an offer byte
+// after the B1/B6 MAC, the answer after the B2/B7 MAC; MTLS_REC_GCM
+// sessions seal B3 with AES-256-GCM instead of CTR + HMAC. From 1.17
+// the offer can also ask for 32-bit sequence numbers (MTLS_REC_SEQ32),
+// from 1.18 for key updates on top (MTLS_REC_REKEY, see "Key update").
+//
+// Inbound records are checked against a sliding replay window, so one
+// that is lost or late doesn't end the session.
+//
 // Once s_active==true, outbound app frames are wrapped via
 // mtls_wrapAndSendBytes_B3(), and inbound B1/B3 are handled via
 // mtls_tryConsumeOrDecryptFromBinary().
@@ -45,7 +60,9 @@
 #include <mbedtls/ecdh.h>
 #include <mbedtls/md.h>
 #include <mbedtls/aes.h>
+#include <mbedtls/gcm.h>
 #include <mbedtls/sha256.h>
+#include <atomic>
 
 // debug
 #define DEBUG_ENABLED 1
@@ -64,9 +81,12 @@ static uint8_t  s_b0Retries  = 0;         // how many B0 retries we've done
 
 // ------------------------------------------------------------
 // B2 delayed-send state (workaround for iOS notify timing)
+// Also used for B7, which ends a resumed handshake the same way.
 // ------------------------------------------------------------
 static bool     s_b2Pending   = false;
-static uint8_t  s_b2Mac[16]   = {0};
+static uint8_t  s_b2Op        = 0xB2;
+static uint8_t  s_b2Pay[16 + 16 + 2 + 16 + 1] = {0}; // B2 mac16 [mode1], or B7
+static uint16_t s_b2Len       = 0;
 static uint32_t s_b2SendAtMs  = 0;
 
 ////////////////////////////////////////////////////////////////////
@@ -74,19 +94,30 @@ static uint32_t s_b2SendAtMs  = 0;
 //
 //  s_active   : true once B0/B1/B2 handshake has completed
 //  s_sessKey  : 32-byte session key derived via HKDF(AppKey, ECDH)
-//  s_seqIn    : expected next inbound sequence (for replay protection)
+//  s_seqIn    : one past the highest inbound sequence accepted
+//  s_seqWin   : replay window below it (bit i = s_seqIn-1-i seen)
 //  s_seqOut   : next outbound sequence to use
+//  s_seqWide  : 32-bit sequence numbers (MTLS_REC_SEQ32 negotiated)
+//  s_rekey    : key update every epoch, 64-bit sequence numbers
+//               (MTLS_REC_REKEY negotiated)
 //  s_sid      : 32-bit session ID chosen by the dongle (in B0)
 ////////////////////////////////////////////////////////////////////
 static bool     s_active      = false;
 static uint8_t  s_sessKey[32] = {0};
-// Key separation (derived once per handshake from s_sessKey)
-static uint8_t  s_kEnc[32] = {0};
+// Handshake MAC key (SFIN / RFIN), from s_sessKey; the record keys
+// are in the RecKeys sets below
 static uint8_t  s_kMac[32] = {0};
-static uint8_t  s_kIv[32]  = {0};
-static uint16_t s_seqIn  = 0;
-static uint16_t s_seqOut = 0;
+static uint64_t s_seqIn  = 0;
+static uint64_t s_seqWin = 0;
+static uint64_t s_seqOut = 0;
 static uint32_t s_sid    = 0;
+static uint8_t  s_recMode = MTLS_REC_CTR;   // B3 record mode, set with B2/B7
+static bool     s_seqWide = false;
+static bool     s_rekey   = false;
+static uint32_t s_keyUpdates = 0;           // epochs moved to, both ways
+
+// per record mode: records, crypto time, bytes on air (C6)
+static MtlsRecStats s_recStats[MTLS_REC_MODES];
 
 // P-256 ECDH server keys: static to the process.
 // We re-generate the ephemeral keypair on each B0.
@@ -119,11 +150,11 @@ extern const uint8_t* getAppKey(); // from settings.h
 //
 //  - hx/toHex: debugging helpers for hex logging
 //  - esp_mbedtls_rng: RNG adapter for mbedTLS (uses esp_random())
-//  - hmac: thin wrapper around mbedtls_md_hmac(SHA256)
+//  - hmac/hmac2: HMAC-SHA256 on one reused context
 //  - hkdf_sha256: single-block HKDF implementation used for sessKey32
 ////////////////////////////////////////////////////////////////////
 static inline char hx(uint8_t v){ return (v<10)?('0'+v):('a'+v-10); }
-static void toHex(const uint8_t* in, size_t n, String& out)
+[[maybe_unused]] static void toHex(const uint8_t* in, size_t n, String& out)
 {
 	out.reserve(out.length()+n*2); 
 	for( size_t i=0; i<n; ++i )
@@ -145,10 +176,149 @@ static int esp_mbedtls_rng(void*, unsigned char* buf, size_t len)
 	return 0;
 }
 
+////////////////////////////////////////////////////////////////////
+// HMAC-SHA256 over up to two pieces (header + data), so record MACs
+// don't need the pieces copied together first. mbedtls_md_hmac() sets
+// up (allocates) a new context per call; this one is set up once and
+// reused. Only used from the protocol task (dispatch, sendFrame, mtls_tick).
+////////////////////////////////////////////////////////////////////
+static void hmac2(const uint8_t* key, size_t klen, const uint8_t* a, size_t alen,
+                  const uint8_t* b, size_t blen, uint8_t out[32])
+{
+	static mbedtls_md_context_t ctx;
+	static bool ready = false;
+	if( !ready )
+	{
+		mbedtls_md_init(&ctx);
+		mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 1);
+		ready = true;
+	}
+
+	mbedtls_md_hmac_starts(&ctx, key, klen);
+	mbedtls_md_hmac_update(&ctx, a, alen);
+	if( blen ) mbedtls_md_hmac_update(&ctx, b, blen);
+	mbedtls_md_hmac_finish(&ctx, out);
+}
+
 static void hmac(const uint8_t* key, size_t klen, const uint8_t* msg, size_t mlen, uint8_t out[32])
+{
+	hmac2(key, klen, msg, mlen, nullptr, 0, out);
+}
+
+////////////////////////////////////////////////////////////////////
+// HMAC-SHA256 with a fixed 32-byte key, keyed once: the SHA-256
+// states after the ipad and the opad block are kept, and every MAC
+// starts from copies of them. For a short record that is 2 of the
+// 4 compressions (and no key hashing); used for K_iv / K_mac, which
+// are fixed for the whole session.
+////////////////////////////////////////////////////////////////////
+struct HmacKeyed
+{
+	mbedtls_md_context_t in;   // state after key ^ ipad
+	mbedtls_md_context_t out;  // state after key ^ opad
+};
+
+static mbedtls_md_context_t s_hmacWork;
+
+static void hmacKeyedInit(HmacKeyed& h)
 {
 	const mbedtls_md_info_t* md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
-	mbedtls_md_hmac(md, key, klen, msg, mlen, out);
+	mbedtls_md_init(&h.in);
+	mbedtls_md_init(&h.out);
+	mbedtls_md_setup(&h.in, md, 0);
+	mbedtls_md_setup(&h.out, md, 0);
+}
+
+static void hmacKeyedSet(HmacKeyed& h, const uint8_t key[32])
+{
+	uint8_t pad[64];
+	for( int i = 0; i < 64; ++i ) pad[i] = (uint8_t)((i < 32 ? key[i] : 0) ^ 0x36);
+	mbedtls_md_starts(&h.in);
+	mbedtls_md_update(&h.in, pad, 64);
+
+	for( int i = 0; i < 64; ++i ) pad[i] ^= 0x36 ^ 0x5C;
+	mbedtls_md_starts(&h.out);
+	mbedtls_md_update(&h.out, pad, 64);
+	memset(pad, 0, sizeof(pad));
+}
+
+static void hmacKeyed2(const HmacKeyed& h, const uint8_t* a, size_t alen,
+                       const uint8_t* b, size_t blen, uint8_t out[32])
+{
+	uint8_t inner[32];
+	mbedtls_md_clone(&s_hmacWork, &h.in);
+	mbedtls_md_update(&s_hmacWork, a, alen);
+	if( blen ) mbedtls_md_update(&s_hmacWork, b, blen);
+	mbedtls_md_finish(&s_hmacWork, inner);
+
+	mbedtls_md_clone(&s_hmacWork, &h.out);
+	mbedtls_md_update(&s_hmacWork, inner, 32);
+	mbedtls_md_finish(&s_hmacWork, out);
+}
+
+////////////////////////////////////////////////////////////////////
+// Record crypto contexts, keyed once per session (and per key update)
+// in recKeysSet(): AES key schedule for K_enc, keyed HMAC states for
+// K_iv / K_mac, and the GCM context (K_enc too) for MTLS_REC_GCM
+// sessions. mbedTLS already runs AES / SHA-256 on the S3 accelerators;
+// this keeps the setkey and the key hashing out of every record.
+//
+// One set per direction, as they move to new keys at different times
+// (see "Key update" below), plus the inbound set of the next epoch
+// while it is being tried. Swapped by pointer, the mbedTLS contexts
+// are not copied.
+////////////////////////////////////////////////////////////////////
+struct RecKeys
+{
+	mbedtls_aes_context aes;
+	mbedtls_gcm_context gcm;
+	HmacKeyed           hIv;
+	HmacKeyed           hMac;
+	uint8_t             nonce[12];    // K_iv[0..11], GCM nonce base
+	uint8_t             secret[32];   // traffic secret of this epoch
+	uint64_t            epoch;
+};
+
+static RecKeys  s_recKeys[3];
+static RecKeys* s_recTx     = &s_recKeys[0];
+static RecKeys* s_recRx     = &s_recKeys[1];
+static RecKeys* s_recRxNext = &s_recKeys[2];
+static bool     s_recRxNextOk  = false;   // s_recRxNext keyed for s_recRx->epoch + 1
+static bool     s_recCtxReady  = false;
+
+static void recordCtxInit()
+{
+	if( s_recCtxReady ) return;
+
+	for( RecKeys& k : s_recKeys )
+	{
+		mbedtls_aes_init(&k.aes);
+		mbedtls_gcm_init(&k.gcm);
+		hmacKeyedInit(k.hIv);
+		hmacKeyedInit(k.hMac);
+	}
+	mbedtls_md_init(&s_hmacWork);
+	mbedtls_md_setup(&s_hmacWork, mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), 0);
+	s_recCtxReady = true;
+}
+
+// Nothing of the session left in a set. Protocol task only, like
+// recordSeal()/recordOpen(): the free releases the cipher context
+// inside the GCM one. Freed and re-initialised rather than keyed with
+// zeros (mbedtls_gcm_setkey() frees and allocates it again);
+// recKeysSet() keys them for the next session.
+static void recKeysWipe(RecKeys& k)
+{
+	static const uint8_t zero[32] = {0};
+	mbedtls_aes_free(&k.aes);
+	mbedtls_aes_init(&k.aes);
+	mbedtls_gcm_free(&k.gcm);
+	mbedtls_gcm_init(&k.gcm);
+	hmacKeyedSet(k.hIv, zero);
+	hmacKeyedSet(k.hMac, zero);
+	memset(k.nonce, 0, sizeof(k.nonce));
+	memset(k.secret, 0, sizeof(k.secret));
+	k.epoch = 0;
 }
 
 ////////////////////////////////////////////////////////////////////
@@ -162,7 +332,6 @@ static void hkdf_sha256(const uint8_t* salt, size_t slen, const uint8_t* ikm, si
 {
 	uint8_t prk[32];
 	hmac(salt, slen, ikm, ikmlen, prk);
-	uint8_t T[32]; // single block OKM
 	const mbedtls_md_info_t* md = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
 	mbedtls_md_context_t ctx; 
 	mbedtls_md_init(&ctx);
@@ -185,11 +354,21 @@ void mtls_reset()
 {
 	s_active = false; 
 	s_seqIn = s_seqOut = 0; 
+	s_seqWin = 0;
 	s_sid = 0;
+	s_recMode = MTLS_REC_CTR;
+	s_seqWide = false;
+	s_rekey   = false;
+	s_keyUpdates = 0;
 	memset(s_sessKey, 0, sizeof(s_sessKey));
-	memset(s_kEnc,    0, sizeof(s_kEnc));
 	memset(s_kMac,    0, sizeof(s_kMac));
-	memset(s_kIv,     0, sizeof(s_kIv));
+	// free and re-init the record contexts (recKeysWipe()), nothing of
+	// the session left
+	if( s_recCtxReady )
+	{
+		for( RecKeys& k : s_recKeys ) recKeysWipe(k);
+	}
+	s_recRxNextOk = false;
 }
 
 extern "C" void mtls_onDisconnect()
@@ -203,15 +382,15 @@ extern "C" void mtls_onDisconnect()
 	// clean B2 flags
 	s_b2Pending  = false;
 	s_b2SendAtMs = 0;
-	memset(s_b2Mac, 0, sizeof(s_b2Mac));
+	memset(s_b2Pay, 0, sizeof(s_b2Pay));
 }
 
 ////////////////////////////////////////////////////////////////////
 // Drop MTLS session and force a fresh handshake (B0).
 //
 // Use this when we detect protocol errors (REPLAY/BADMAC), or when
-// seq is about to wrap (CTR IV reuse risk), without needing a full BLE
-// disconnect.
+// seq is about to wrap (CTR IV reuse risk; sessions without key
+// updates only), without needing a full BLE disconnect.
 //
 // What it does:
 //  - wipes MTLS session keys/state
@@ -241,7 +420,7 @@ static void mtls_dropSessionAndRequireHandshake(const char* why)
     // Clear delayed B2 state
     s_b2Pending  = false;
     s_b2SendAtMs = 0;
-    memset(s_b2Mac, 0, sizeof(s_b2Mac));
+    memset(s_b2Pay, 0, sizeof(s_b2Pay));
 
 	// Schedule a fresh HELLO (B0) via mtls_sendHello_B0() - mtls_tick() will transmit.
     (void)mtls_sendHello_B0();
@@ -258,7 +437,7 @@ static void ensureGroupInit()
 	mbedtls_ecp_group_init(&s_grp); 
 	mbedtls_mpi_init(&s_priv); 
 	mbedtls_ecp_point_init(&s_pub);
-	int rc = mbedtls_ecp_group_load(&s_grp, MBEDTLS_ECP_DP_SECP256R1);
+	[[maybe_unused]] int rc = mbedtls_ecp_group_load(&s_grp, MBEDTLS_ECP_DP_SECP256R1);
 	
 	/* DEBUG
 	if( rc!=0 )
@@ -304,6 +483,156 @@ static bool genKeypair()
 	return( true );
 }
 
+////////////////////////////////////////////////////////////////////
+// Ephemeral keypair pool
+//
+// The P-256 keygen is the slow part of B0 and used to run right when
+// it was needed: in the NimBLE callback on subscribe, or in the
+// protocol task on a re-handshake. A low priority task keeps
+// MTLS_KEYPOOL_SIZE keypairs ready instead; mtls_sendHello_B0() takes
+// one and pokes the task to make the next. genKeypair() is still the
+// fallback when the pool is empty (task not running, handshakes back
+// to back).
+//
+// Slot state goes EMPTY -> READY (pool task) and READY -> TAKEN ->
+// EMPTY (B0 side). The NimBLE host and the protocol task can both
+// take, hence the CAS. The task has its own group: mbedtls keeps
+// per-group tables for the generator multiplication.
+////////////////////////////////////////////////////////////////////
+enum : uint8_t { KP_EMPTY = 0, KP_READY = 1, KP_TAKEN = 2 };
+
+struct KeySlot
+{
+	std::atomic<uint8_t> state{KP_EMPTY};
+	mbedtls_mpi          d;
+	mbedtls_ecp_point    Q;
+};
+
+static KeySlot           s_pool[MTLS_KEYPOOL_SIZE];
+static mbedtls_ecp_group s_poolGrp;
+static TaskHandle_t      s_poolTask = nullptr;
+
+static MtlsHelloStats    s_hello = {};
+
+static void keypool_task( void* )
+{
+	for( ;; )
+	{
+		for( size_t i = 0; i < MTLS_KEYPOOL_SIZE; ++i )
+		{
+			KeySlot& k = s_pool[i];
+			if( k.state.load(std::memory_order_acquire) != KP_EMPTY ) continue;
+
+			const int rc = mbedtls_ecp_gen_keypair(&s_poolGrp, &k.d, &k.Q, esp_mbedtls_rng, nullptr);
+			if( rc != 0 )
+			{
+				DPRINT("[MTLS][POOL] gen_keypair failed rc=%d\n", rc);
+				continue;
+			}
+			k.state.store( KP_READY, std::memory_order_release );
+		}
+
+		// all full (or keygen failing) - wait for the next take
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+	}
+}
+
+bool mtls_keypool_begin()
+{
+	if( s_poolTask ) return( true );
+
+	ensureGroupInit();
+	mbedtls_ecp_group_init(&s_poolGrp);
+	if( mbedtls_ecp_group_load(&s_poolGrp, MBEDTLS_ECP_DP_SECP256R1) != 0 )
+	{
+		DPRINTLN("[MTLS][POOL] group_load failed - B0 keygen stays inline");
+		return( false );
+	}
+	for( size_t i = 0; i < MTLS_KEYPOOL_SIZE; ++i )
+	{
+		mbedtls_mpi_init(&s_pool[i].d);
+		mbedtls_ecp_point_init(&s_pool[i].Q);
+	}
+
+	if( xTaskCreatePinnedToCore( keypool_task, "mtls_keys", 6144, nullptr,
+									MTLS_KEYPOOL_PRIO, &s_poolTask, MTLS_KEYPOOL_CORE ) != pdPASS )
+	{
+		DPRINTLN("[MTLS][POOL] task create failed - B0 keygen stays inline");
+		s_poolTask = nullptr;
+		return( false );
+	}
+
+	DPRINT("[MTLS][POOL] keypair pool on core %d, %d slots\n", MTLS_KEYPOOL_CORE, MTLS_KEYPOOL_SIZE);
+	return( true );
+}
+
+// Move a ready keypair into s_priv/s_pub. False if none is ready.
+static bool keypool_take()
+{
+	if( !s_poolTask ) return( false );
+
+	for( size_t i = 0; i < MTLS_KEYPOOL_SIZE; ++i )
+	{
+		KeySlot& k = s_pool[i];
+		uint8_t expect = KP_READY;
+		if( !k.state.compare_exchange_strong(expect, KP_TAKEN, std::memory_order_acq_rel) ) continue;
+
+		const bool ok = mbedtls_mpi_copy(&s_priv, &k.d) == 0 &&
+						mbedtls_ecp_copy(&s_pub, &k.Q) == 0;
+
+		// don't leave the private half lying around once used
+		mbedtls_mpi_lset(&k.d, 0);
+		k.state.store( KP_EMPTY, std::memory_order_release );
+		xTaskNotifyGive( s_poolTask );
+
+		if( ok ) return( true );
+		DPRINTLN("[MTLS][POOL] copy failed");
+	}
+	return( false );
+}
+
+void mtls_getHelloStats( MtlsHelloStats& out )
+{
+	out = s_hello;
+}
+
+////////////////////////////////////////////////////////////////////
+// Per-purpose keys from a traffic secret (domain separation):
+//   K_enc = HMAC(secret, "ENC")
+//   K_mac = HMAC(secret, "MAC")
+//   K_iv  = HMAC(secret, "IVK")
+// and the record contexts of a set keyed with them. The secret of
+// epoch 0 is s_sessKey, both ways.
+////////////////////////////////////////////////////////////////////
+static void recKeysSet(RecKeys& k, const uint8_t secret[32], uint64_t epoch)
+{
+	uint8_t key[32];
+	recordCtxInit();
+
+	hmac(secret, 32, (const uint8_t*)"ENC", 3, key);
+	mbedtls_aes_setkey_enc(&k.aes, key, 256);
+	mbedtls_gcm_setkey(&k.gcm, MBEDTLS_CIPHER_ID_AES, key, 256);
+	hmac(secret, 32, (const uint8_t*)"MAC", 3, key);
+	hmacKeyedSet(k.hMac, key);
+	hmac(secret, 32, (const uint8_t*)"IVK", 3, key);
+	hmacKeyedSet(k.hIv, key);
+	memcpy(k.nonce, key, 12);
+	memset(key, 0, sizeof(key));
+
+	memcpy(k.secret, secret, 32);
+	k.epoch = epoch;
+}
+
+// After a full or a resumed handshake: K_mac for SFIN / RFIN and both
+// directions' record keys for epoch 0
+static void deriveRecordKeys()
+{
+	hmac(s_sessKey, 32, (const uint8_t*)"MAC", 3, s_kMac);
+	recKeysSet(*s_recTx, s_sessKey, 0);
+	recKeysSet(*s_recRx, s_sessKey, 0);
+	s_recRxNextOk = false;
+}
+
 ////////////////////////////////////////////////////////////////////
 // Derive session key from client's public key:
 //
@@ -373,17 +702,7 @@ static bool deriveSessionKey( const std::vector<uint8_t>& cliPub65 )
 
 	hkdf_sha256(getAppKey(), 32, shared, 32, info.data(), info.size(), s_sessKey);
 
-
-    // Derive per-purpose keys from sessKey (domain separation)
-    // K_enc = HMAC(sessKey, "ENC")
-    // K_mac = HMAC(sessKey, "MAC")
-    // K_iv  = HMAC(sessKey, "IVK")
-	uint8_t tmp[32];
-	hmac(s_sessKey, 32, (const uint8_t*)"ENC", 3, tmp); memcpy(s_kEnc, tmp, 32);
-	hmac(s_sessKey, 32, (const uint8_t*)"MAC", 3, tmp); memcpy(s_kMac, tmp, 32);
-	hmac(s_sessKey, 32, (const uint8_t*)"IVK", 3, tmp); memcpy(s_kIv,  tmp, 32);
-	memset(tmp, 0, sizeof(tmp));
-	
+	deriveRecordKeys();
 	return( true );
 }
 
@@ -397,6 +716,42 @@ static void mac16(const uint8_t* key, const uint8_t* msg, size_t n, uint8_t out1
 	memcpy(out16, full, 16);
 }
 
+////////////////////////////////////////////////////////////////////
+// Sequence number in the MAC/IV transcript, big-endian: seq2, or
+// seq4 when the session negotiated MTLS_REC_SEQ32 (the low 32 bits
+// with MTLS_REC_REKEY, the keys change every epoch). Returns the
+// number of bytes written.
+////////////////////////////////////////////////////////////////////
+static size_t putSeq(uint8_t* out, uint64_t seq)
+{
+	if( s_seqWide )
+	{
+		out[0] = (uint8_t)(seq >> 24);
+		out[1] = (uint8_t)(seq >> 16);
+		out += 2;
+	}
+	out[0] = (uint8_t)(seq >> 8);
+	out[1] = (uint8_t)seq;
+	return( s_seqWide ? 4 : 2 );
+}
+
+////////////////////////////////////////////////////////////////////
+// Record MAC: HMAC(K_mac, "ENCM"||sid||dir||seq||cipher)[0..15],
+// header built on the stack, cipher MACed where it is.
+////////////////////////////////////////////////////////////////////
+static void recordMac16(const RecKeys& k, uint8_t dir, uint64_t seq, const uint8_t* cipher, size_t n, uint8_t out16[16])
+{
+	uint8_t hdr[4+4+1+4] = {
+		'E','N','C','M',
+		(uint8_t)(s_sid>>24), (uint8_t)(s_sid>>16), (uint8_t)(s_sid>>8), (uint8_t)s_sid,
+		dir };
+	const size_t hlen = 4 + 4 + 1 + putSeq(hdr + 9, seq);
+
+	uint8_t full[32];
+	hmacKeyed2(k.hMac, hdr, hlen, cipher, n, full);
+	memcpy(out16, full, 16);
+}
+
 // Constant-time compare for 16-byte tags
 static bool ct_eq16(const uint8_t a[16], const uint8_t b[16])
 {
@@ -409,12 +764,13 @@ static bool ct_eq16(const uint8_t a[16], const uint8_t b[16])
 // Derive AES-CTR IV:
 //   iv16 = HMAC(K_iv, "IV1"||sid4||dir||seq2)[0..15]
 //
-// sid4 and seq2 are encoded big-endian in the MAC/IV transcript.
+// sid4 and seq2 are encoded big-endian in the MAC/IV transcript
+// (seq4 in MTLS_REC_SEQ32 sessions, see putSeq()).
 // dir = 'C' (client→dongle) or 'S' (dongle→client).
 ////////////////////////////////////////////////////////////////////
-static void ivFrom(uint8_t dir, uint16_t seq, uint8_t iv16[16])
+static void ivFrom(const RecKeys& k, uint8_t dir, uint64_t seq, uint8_t iv16[16])
 {
-	uint8_t buf[3+4+1+2]; // "IV"+sid+dir+seq
+	uint8_t buf[3+4+1+4]; // "IV"+sid+dir+seq
 	buf[0]='I'; 
 	buf[1]='V'; 
 	buf[2]='1';
@@ -422,10 +778,10 @@ static void ivFrom(uint8_t dir, uint16_t seq, uint8_t iv16[16])
 	buf[4]=(uint8_t)(s_sid>>16);
 	buf[5]=(uint8_t)(s_sid>>8);  
 	buf[6]=(uint8_t)(s_sid);
-	buf[7]=dir; buf[8]=(uint8_t)(seq>>8); 
-	buf[9]=(uint8_t)(seq);
+	buf[7]=dir;
+	const size_t len = 8 + putSeq(buf + 8, seq);
 	
-	uint8_t h[32]; hmac(s_kIv, 32, buf, sizeof(buf), h);
+	uint8_t h[32]; hmacKeyed2(k.hIv, buf, len, nullptr, 0, h);
 	memcpy(iv16, h, 16);
 }
 
@@ -449,6 +805,298 @@ static bool aesCtr(const uint8_t key[32], const uint8_t iv16[16],
 	return rc==0;
 }
 
+// Same with a record set's K_enc schedule
+static bool aesCtrRec(RecKeys& k, const uint8_t iv16[16], const uint8_t* in, uint8_t* out, size_t len)
+{
+	uint8_t nonce_counter[16];
+	memcpy(nonce_counter, iv16, 16);
+	uint8_t stream_block[16]; 
+	size_t nc_off = 0;
+	return( mbedtls_aes_crypt_ctr(&k.aes, len, &nc_off, nonce_counter, stream_block, in, out) == 0 );
+}
+
+////////////////////////////////////////////////////////////////////
+// Record modes (PROTO 1.16+)
+//
+// A client that wants AES-256-GCM records puts offer1 = MTLS_REC_GCM
+// after the B1 (or B6) MAC, and MACs it with the rest. The dongle
+// answers with the mode it picked after the B2 (B7) MAC, also MACed,
+// so neither byte can be changed or stripped on the way. No byte:
+// MTLS_REC_CTR, as before.
+//
+// GCM record: same B3 layout (seq2 | clen2 | cipher | tag16), with
+//   key   = K_enc
+//   nonce = K_iv[0..11] ^ (dir1 || 0^9 || seq2)
+//   aad   = seq2 || clen2 (the record header)
+// One AES pass with GHASH instead of HMAC(IV) + AES-CTR + HMAC(cipher).
+// A nonce repeats only after seq wraps, which ends the session anyway.
+//
+// Sequence numbers (PROTO 1.17+): MTLS_REC_SEQ32 or'ed into the offer
+// asks for 32-bit sequence numbers, the answer has it if granted. Only
+// the low 16 bits go on the wire (seq2 above); the receiver takes the
+// full number closest to the highest one it accepted so far (seqInFull)
+// and the transcripts use it: seq4 in the CTR IV / MAC, and
+// dir1 || 0^7 || seq4 in the GCM nonce (the same nonce as before while
+// seq < 65536). A session then lasts 2^32 records each way instead of
+// 65536 before it has to re-handshake.
+// Without the flag, seq2 everywhere as before.
+//
+// Key update (PROTO 1.18+): MTLS_REC_REKEY, only granted together with
+// MTLS_REC_SEQ32, moves each direction to new keys every
+// MTLS_REKEY_RECORDS records (see "Key update" below). Sequence numbers
+// are then 64-bit and never run out; the transcripts keep seq4.
+////////////////////////////////////////////////////////////////////
+static uint8_t pickRecMode( uint8_t offer )
+{
+	if( MTLS_REC_GCM_ENABLE && (offer & MTLS_REC_MODE_MASK) == MTLS_REC_GCM ) return( MTLS_REC_GCM );
+	return( MTLS_REC_CTR );
+}
+
+// The answer byte for an offer: mode picked | the flags granted.
+// Sets the session's record mode, sequence width and key update.
+static uint8_t acceptRecOffer( const uint8_t* offer )
+{
+	s_recMode = offer ? pickRecMode(*offer) : MTLS_REC_CTR;
+	s_seqWide = offer && MTLS_REC_SEQ32_ENABLE && (*offer & MTLS_REC_SEQ32);
+	s_rekey   = s_seqWide && MTLS_REC_REKEY_ENABLE && (*offer & MTLS_REC_REKEY);
+	return( (uint8_t)(s_recMode | (s_seqWide ? MTLS_REC_SEQ32 : 0) | (s_rekey ? MTLS_REC_REKEY : 0)) );
+}
+
+static void gcmNonce(const RecKeys& k, uint8_t dir, uint64_t seq, uint8_t n12[12])
+{
+	memcpy(n12, k.nonce, 12);
+	n12[0]  ^= dir;
+	n12[8]  ^= (uint8_t)(seq >> 24);
+	n12[9]  ^= (uint8_t)(seq >> 16);
+	n12[10] ^= (uint8_t)(seq >> 8);
+	n12[11] ^= (uint8_t)seq;
+}
+
+// Last sequence number a session may use before it has to re-handshake
+static uint64_t seqLast()
+{
+	if( s_rekey ) return( UINT64_MAX );
+	return( s_seqWide ? 0xFFFFFFFFu : 0xFFFFu );
+}
+
+////////////////////////////////////////////////////////////////////
+// Inbound replay window (RFC 4303 style): s_seqIn is one past the
+// highest sequence accepted, bit i of s_seqWin is set once
+// s_seqIn-1-i has been. A record ahead of s_seqIn is always new (the
+// ones skipped stay open in the window), one in the window is new if
+// its bit is clear, anything older is refused. So a lost or late
+// record no longer stops the session.
+//
+// seqInFull: full sequence number for seq2 from the wire, false if it
+// can't be one (before 0 / past the end).
+// seqInFresh: not seen yet and not too old. seqInMark: accepted, only
+// after the MAC / tag checked out.
+////////////////////////////////////////////////////////////////////
+static const uint32_t SEQ_WINDOW = 64;
+
+static bool seqInFull( uint16_t seq2, uint64_t& seq )
+{
+	if( !s_seqWide )
+	{
+		seq = seq2;
+		return( true );
+	}
+
+	// within -32768..+32767 of the next one expected
+	const int64_t s = (int64_t)s_seqIn + (int16_t)(uint16_t)(seq2 - (uint16_t)s_seqIn);
+	if( s < 0 || (uint64_t)s > seqLast() ) return( false );
+	seq = (uint64_t)s;
+	return( true );
+}
+
+static bool seqInFresh( uint64_t seq )
+{
+	if( seq >= s_seqIn ) return( true );
+
+	const uint64_t back = s_seqIn - 1 - seq;
+	return( back < SEQ_WINDOW && !(s_seqWin & ((uint64_t)1 << back)) );
+}
+
+static void seqInMark( uint64_t seq )
+{
+	if( seq >= s_seqIn )
+	{
+		const uint64_t shift = seq - s_seqIn + 1;
+		s_seqWin = (shift >= SEQ_WINDOW) ? 0 : (s_seqWin << shift);
+		s_seqWin |= 1;
+		s_seqIn = seq + 1;
+		return;
+	}
+
+	s_seqWin |= (uint64_t)1 << (s_seqIn - 1 - seq);
+}
+
+////////////////////////////////////////////////////////////////////
+// Key update (PROTO 1.18+, MTLS_REC_REKEY)
+//
+// Like TLS 1.3 KeyUpdate, but on a schedule both sides know instead
+// of a message: record seq of a direction is sealed with the keys of
+// epoch seq / MTLS_REKEY_RECORDS. Each epoch's traffic secret comes
+// from the one before,
+//
+//   secret_0   = sessKey32
+//   secret_e+1 = HKDF-Expand(secret_e, "MT1U"||dir, 32)
+//              = HMAC(secret_e, "MT1U"||dir||0x01)
+//
+// and K_enc / K_mac / K_iv from it as from sessKey32 (recKeysSet).
+// No ECDH and nothing on the air; an old secret is wiped once the
+// next one is in use, so a key read out later doesn't open earlier
+// records. With the replay window a message could be lost, a
+// schedule can't.
+//
+// Outbound moves on when seq crosses into the next epoch. Inbound
+// derives the next epoch's set when the first record of it comes in,
+// tries it and only keeps it if the record checks out; records still
+// left from the epoch before are refused then, like too old ones.
+// Costs a few HMACs and an AES/GCM setkey once per epoch.
+////////////////////////////////////////////////////////////////////
+static uint64_t recEpoch( uint64_t seq )
+{
+	return( s_rekey ? (seq / MTLS_REKEY_RECORDS) : 0 );
+}
+
+// next epoch's set from src (dst may be src)
+static void recKeysNext( RecKeys& dst, const RecKeys& src, uint8_t dir )
+{
+	const uint8_t info[4 + 1 + 1] = { 'M','T','1','U', dir, 0x01 };
+	uint8_t next[32];
+	hmac(src.secret, 32, info, sizeof(info), next);
+	recKeysSet(dst, next, src.epoch + 1);
+	memset(next, 0, sizeof(next));
+}
+
+// Outbound set for seq
+static RecKeys& recTxKeys( uint64_t seq )
+{
+	if( recEpoch(seq) != s_recTx->epoch )
+	{
+		recKeysNext(*s_recTx, *s_recTx, 'S');
+		s_keyUpdates++;
+		DPRINT("[MTLS] key update out, epoch %u\n", (unsigned)s_recTx->epoch);
+	}
+	return( *s_recTx );
+}
+
+// Inbound set for seq, nullptr if its epoch is gone
+static RecKeys* recRxKeys( uint64_t seq )
+{
+	const uint64_t e = recEpoch(seq);
+	if( e == s_recRx->epoch ) return( s_recRx );
+	if( e != s_recRx->epoch + 1 ) return( nullptr );
+
+	if( !s_recRxNextOk )
+	{
+		recKeysNext(*s_recRxNext, *s_recRx, 'C');
+		s_recRxNextOk = true;
+	}
+	return( s_recRxNext );
+}
+
+// A record of the next epoch checked out: it is the current one now
+static void recRxAdvance()
+{
+	RecKeys* old = s_recRx;
+	s_recRx       = s_recRxNext;
+	s_recRxNext   = old;
+	s_recRxNextOk = false;
+	recKeysWipe(*old);
+	s_keyUpdates++;
+	DPRINT("[MTLS] key update in, epoch %u\n", (unsigned)s_recRx->epoch);
+}
+
+static void recCount( uint32_t t0, size_t n )
+{
+	MtlsRecStats& st = s_recStats[s_recMode];
+	st.records++;
+	st.cryptoUs += micros() - t0;
+	st.airBytes += (uint32_t)(3 + 2 + 2 + n + 16);
+}
+
+// Encrypt n bytes at cipher in place and put the mac16 / tag right
+// after them. hdr4 = seq2 || clen2 as sent.
+static bool recordSeal(RecKeys& k, uint8_t dir, uint64_t seq, const uint8_t* hdr4, uint8_t* cipher, size_t n)
+{
+	const uint32_t t0 = micros();
+
+	if( s_recMode == MTLS_REC_GCM )
+	{
+		uint8_t nonce[12];
+		gcmNonce(k, dir, seq, nonce);
+		if( mbedtls_gcm_crypt_and_tag(&k.gcm, MBEDTLS_GCM_ENCRYPT, n, nonce, 12, hdr4, 4,
+										cipher, cipher, 16, cipher + n) != 0 ) return( false );
+	} else
+	{
+		uint8_t iv[16]; 
+		ivFrom(k, dir, seq, iv);
+		if( !aesCtrRec(k, iv, cipher, cipher, n) ) return( false );
+
+		// mac over ENCM||sid||dir||seq||cipher
+		recordMac16(k, dir, seq, cipher, n, cipher + n);
+	}
+
+	recCount(t0, n);
+	return( true );
+}
+
+// Check the mac16 / tag after the n bytes at cipher, then decrypt them
+// in place. False (bad MAC) leaves nothing usable behind.
+static bool recordOpen(RecKeys& k, uint8_t dir, uint64_t seq, const uint8_t* hdr4, uint8_t* cipher, size_t n)
+{
+	const uint32_t t0 = micros();
+	const uint8_t* tag = cipher + n;
+
+	if( s_recMode == MTLS_REC_GCM )
+	{
+		uint8_t nonce[12];
+		gcmNonce(k, dir, seq, nonce);
+		if( mbedtls_gcm_auth_decrypt(&k.gcm, n, nonce, 12, hdr4, 4, tag, 16, cipher, cipher) != 0 ) return( false );
+	} else
+	{
+		// MAC = HMAC(K_mac,"ENCM"||sid||dir||seq||cipher)[0..15]
+		uint8_t macExp[16]; 
+		recordMac16(k, dir, seq, cipher, n, macExp);
+		if( !ct_eq16(macExp, tag) ) return( false );
+
+		uint8_t iv[16]; 
+		ivFrom(k, dir, seq, iv);
+		if( !aesCtrRec(k, iv, cipher, cipher, n) ) return( false );
+	}
+
+	recCount(t0, n);
+	return( true );
+}
+
+uint8_t mtls_recMode()
+{
+	return( s_recMode );
+}
+
+uint8_t mtls_recSeqBits()
+{
+	if( s_rekey ) return( 64 );
+	return( s_seqWide ? 32 : 16 );
+}
+
+uint32_t mtls_keyUpdates()
+{
+	return( s_keyUpdates );
+}
+
+void mtls_getRecStats( MtlsRecStats out[MTLS_REC_MODES] )
+{
+	memcpy(out, s_recStats, sizeof(s_recStats));
+}
+
+void mtls_clearRecStats()
+{
+	memset(s_recStats, 0, sizeof(s_recStats));
+}
+
 ////////////////////////
 // Binary MTLS (B0..B3) IMPLEMENTATION 
 //////////////////////////////////////
@@ -468,8 +1116,9 @@ static bool get_srv_pub65(uint8_t out65[65])
 ////////////////////////////////////////////////////////////////////
 // mtls_sendHello_B0()
 //
-// Starts a handshake by generating a fresh sid + ephemeral P-256 keypair,
-// then caching a B0 payload for retransmit by mtls_tick().
+// Starts a handshake with a fresh sid + ephemeral P-256 keypair (from
+// the keypair pool when one is ready), then caches a B0 payload for
+// retransmit by mtls_tick().
 //
 // - B0 payload = srvPub65 || sid4(BE)
 // - B0 is not sent immediately here; mtls_tick() performs the actual send.
@@ -489,14 +1138,16 @@ bool mtls_sendHello_B0()
 		DPRINTLN("[MTLS][B0] unprovisioned (sending B0 anyway)");
 	}
 	
+	const uint32_t t0 = micros();
 	ensureGroupInit();
 	mtls_reset();
 
-	// sid + ephemeral
+	// sid + ephemeral (pre-generated if the pool has one)
 	s_sid = esp_random();
 	//String dummy; // for logs - removed this to tidy
 	//if( !genKeypair(dummy) ) 
-	if( !genKeypair() ) 
+	const bool fromPool = keypool_take();
+	if( !fromPool && !genKeypair() ) 
 	{
 		DPRINTLN("[MTLS][B0] genKeypair fail"); 
 		return false; 
@@ -519,6 +1170,13 @@ bool mtls_sendHello_B0()
 	s_b0Retries  = 0;
 	s_b0NextAtMs = millis() + 1;   // first retry after 300 ms - increased
 
+	const uint32_t us = micros() - t0;
+	s_hello.hellos++;
+	if( fromPool ) s_hello.poolHits++;
+	s_hello.lastUs = us;
+	if( us > s_hello.maxUs ) s_hello.maxUs = us;
+	DPRINT("[MTLS][B0] ready in %lu us (%s)\n", (unsigned long)us, fromPool ? "pool" : "keygen");
+
 	// top-level send via binary framing (sendFrame in commands.h will pick MTLS path only after active)
 	// commented this out here so it will run on a ticker instead
 	//bool ok = sendFrame(0xB0, pay, sizeof(pay));
@@ -531,7 +1189,7 @@ bool mtls_sendHello_B0()
 ////////////////////////////////////////////////////////////////////
 // mtls_tick()
 //
-// Called from loop(). Handles:
+// Called from the protocol task. Handles:
 //   - delayed B2 send (workaround for notify timing), then activates session
 //   - B0 retransmits while waiting for B1
 //
@@ -549,7 +1207,7 @@ void mtls_tick()
 		uint32_t now = millis();
 		if( now >= s_b2SendAtMs ) 
 		{
-			bool ok = sendFrame(0xB2, s_b2Mac, 16);
+			(void)sendFrame(s_b2Op, s_b2Pay, s_b2Len);
 			//if( ok ) 
 			//{
 				s_b2Pending = false;
@@ -558,8 +1216,9 @@ void mtls_tick()
 				// Now MTLS is active
 				s_active = true;
 				s_seqIn = s_seqOut = 0;
+				s_seqWin = 0;
 
-				DPRINTLN("[MTLS] ACTIVE (binary) (delayed B2)");
+				DPRINT("[MTLS] ACTIVE (binary) (delayed B%X)\n", (unsigned)(s_b2Op & 0x0F));
 				
 			//} else 
 			//{
@@ -591,7 +1250,7 @@ void mtls_tick()
 		//s_b0Retries++;
 		//s_b0NextAtMs = now + RETRY_GAP_MS;
 		// retry inc counter only if success??
-		bool ok = sendFrame(0xB0, s_lastB0.data(), (uint16_t)s_lastB0.size());
+		(void)sendFrame(0xB0, s_lastB0.data(), (uint16_t)s_lastB0.size());
 		//if( ok ) 
 		//{
 			s_b0Retries++;
@@ -612,26 +1271,190 @@ void mtls_tick()
 //
 // Build the MAC for B2 (server finished):
 //
-//   mac16 = HMAC(sessKey32, "SFIN"||sid4||srvPub65||cliPub65)[0..15]
+//   mac16 = HMAC(sessKey32, "SFIN"||sid4||srvPub65||cliPub65[||mode1])[0..15]
 //
 // The client uses the same formula to verify that both sides derived
-// the same sessKey32 and that the transcript matches.
+// the same sessKey32 and that the transcript matches. mode1 (the record
+// mode picked) only when the client offered one in B1.
 ////////////////////////////////////////////////////////////////////
-static void make_sfin_mac(uint8_t out16[16], const std::vector<uint8_t>& cli65) 
+static void make_sfin_mac(uint8_t out16[16], const std::vector<uint8_t>& cli65, const uint8_t* mode) 
 {
 	uint8_t srv65[65]; get_srv_pub65(srv65);
 	uint8_t sid4[4] = {
 			(uint8_t)((s_sid >> 24) & 0xFF), (uint8_t)((s_sid >> 16) & 0xFF),
 			(uint8_t)((s_sid >> 8) & 0xFF),  (uint8_t)( s_sid        & 0xFF)
 		};
-	std::vector<uint8_t> fin; fin.reserve(4+4+65+65);
+	std::vector<uint8_t> fin; fin.reserve(4+4+65+65+1);
 	fin.insert(fin.end(), {'S','F','I','N'});
 	fin.insert(fin.end(), sid4, sid4+4);
 	fin.insert(fin.end(), srv65, srv65+65);
 	fin.insert(fin.end(), cli65.begin(), cli65.end());
+	if( mode ) fin.push_back(*mode);
 	mac16(s_kMac, fin.data(), fin.size(), out16);
 }
 
+////////////////////////////////////////////////////////////////////
+// Session resumption tickets (PROTO 1.15+)
+//
+// A client with an active session asks for a ticket (B4 -> B5, inside
+// B3): a random id16. Both sides derive its secret from the session
+// that issued it:
+//
+//   RMS = HMAC(sessKey32, "RMS"||id16)
+//
+// On the next connection the client answers B0 with B6 instead of B1:
+//
+//   B6 RESUME  = id16 || cnonce16 || mac16 [|| offer1]
+//       mac16  = HMAC(RMS, "RSUM"||sid4||id16||cnonce16[||offer1])[0..15]
+//
+//   sessKey32  = HKDF(AppKey32, RMS, "MT1R"||sid4||id16||cnonce16||snonce16)
+//
+//   B7 RESUMED = snonce16 || nextId16 || life2(LE) || mac16 [|| mode1]
+//       mac16  = HMAC(K_mac, "RFIN"||sid4||id16||cnonce16||snonce16||nextId16||life2[||mode1])[0..15]
+//
+// offer1 / mode1: record mode, as in B1 / B2 (PROTO 1.16+).
+//
+// No ECDH on either side, just HMACs. B7 carries the next ticket (RMS
+// from the new sessKey), so a client keeps resuming without asking.
+//
+// Tickets are single use, live MTLS_TICKET_LIFE_S and are kept in RAM
+// only (MTLS_TICKET_SLOTS, oldest replaced): a reboot or an AppKey
+// reset ends them. A resumed session has no fresh ECDH, its forward
+// secrecy comes from the last full handshake - hence the short life.
+// Unknown / expired ticket: FF "NOTICKET", the B0 stays valid and the
+// client goes on with B1.
+////////////////////////////////////////////////////////////////////
+struct Ticket
+{
+	bool     used;
+	uint8_t  id[16];
+	uint8_t  rms[32];
+	uint32_t issuedMs;
+};
+
+static Ticket s_tickets[MTLS_TICKET_SLOTS];
+
+// New ticket for the current s_sessKey
+static const Ticket& ticketNew()
+{
+	const uint32_t now = millis();
+	Ticket* t = &s_tickets[0];
+	for( size_t i = 0; i < MTLS_TICKET_SLOTS; ++i )
+	{
+		Ticket& c = s_tickets[i];
+		if( !c.used ) { t = &c; break; }
+		if( (now - c.issuedMs) > (now - t->issuedMs) ) t = &c;
+	}
+
+	uint8_t msg[3 + 16];
+	esp_mbedtls_rng(nullptr, t->id, 16);
+	memcpy(msg, "RMS", 3);
+	memcpy(msg + 3, t->id, 16);
+	hmac(s_sessKey, 32, msg, sizeof(msg), t->rms);
+	t->issuedMs = now;
+	t->used     = true;
+	return( *t );
+}
+
+static Ticket* ticketFind( const uint8_t id[16] )
+{
+	for( size_t i = 0; i < MTLS_TICKET_SLOTS; ++i )
+	{
+		Ticket& t = s_tickets[i];
+		if( !t.used || !ct_eq16(t.id, id) ) continue;
+
+		if( (millis() - t.issuedMs) > (uint32_t)MTLS_TICKET_LIFE_S * 1000u )
+		{
+			memset(&t, 0, sizeof(t));
+			return( nullptr );
+		}
+		return( &t );
+	}
+	return( nullptr );
+}
+
+bool mtls_issueTicket( uint8_t out[18] )
+{
+	if( !s_active ) return( false );
+
+	const Ticket& t = ticketNew();
+	memcpy(out, t.id, 16);
+	out[16] = (uint8_t)(MTLS_TICKET_LIFE_S & 0xFF);
+	out[17] = (uint8_t)(MTLS_TICKET_LIFE_S >> 8);
+	return( true );
+}
+
+void mtls_forgetTickets()
+{
+	memset(s_tickets, 0, sizeof(s_tickets));
+}
+
+////////////////////////////////////////////////////////////////////
+// B6: resume with a ticket. Same outcome as a good B1 (B7 pending
+// instead of B2, B0 retries stopped). Returns false (nothing changed,
+// the B0 still stands) if the ticket is unknown or the MAC is bad.
+// offer: record mode byte after the B6 MAC, nullptr if none.
+////////////////////////////////////////////////////////////////////
+static bool resumeFromTicket( const uint8_t* p, const uint8_t* offer )
+{
+	const uint8_t* id     = p;
+	const uint8_t* cnonce = p + 16;
+	const uint8_t* macIn  = p + 32;
+
+	Ticket* t = ticketFind(id);
+	if( !t ) return( false );
+
+	uint8_t msg[4 + 4 + 16 + 16 + 16 + 16 + 2 + 1];
+	uint8_t* w = msg;
+	memcpy(w, "RSUM", 4); w += 4;
+	*w++ = (uint8_t)(s_sid >> 24); *w++ = (uint8_t)(s_sid >> 16);
+	*w++ = (uint8_t)(s_sid >> 8);  *w++ = (uint8_t)s_sid;
+	memcpy(w, id, 16);     w += 16;
+	memcpy(w, cnonce, 16); w += 16;
+
+	// the offer byte is only MACed here, snonce goes over it below
+	if( offer ) *w = *offer;
+
+	uint8_t macExp[16];
+	mac16(t->rms, msg, (size_t)(w - msg) + (offer ? 1 : 0), macExp);
+	if( !ct_eq16(macExp, macIn) ) return( false );
+
+	// single use
+	uint8_t rms[32];
+	memcpy(rms, t->rms, 32);
+	memset(t, 0, sizeof(*t));
+
+	// info = "MT1R"||sid4||id16||cnonce16||snonce16 (reuses the RSUM
+	// header: same sid/id/cnonce after the tag)
+	uint8_t snonce[16];
+	esp_mbedtls_rng(nullptr, snonce, 16);
+	memcpy(msg, "MT1R", 4);
+	memcpy(w, snonce, 16); w += 16;
+	hkdf_sha256(getAppKey(), 32, rms, 32, msg, (size_t)(w - msg), s_sessKey);
+	memset(rms, 0, sizeof(rms));
+	deriveRecordKeys();
+
+	// B7 = snonce16 || nextId16 || life2 || mac16, MAC input is the
+	// info above + nextId16 || life2 under the "RFIN" tag
+	const Ticket& nt = ticketNew();
+	memcpy(w, nt.id, 16); w += 16;
+	*w++ = (uint8_t)(MTLS_TICKET_LIFE_S & 0xFF);
+	*w++ = (uint8_t)(MTLS_TICKET_LIFE_S >> 8);
+	const uint8_t mode = acceptRecOffer(offer);
+	if( offer ) *w++ = mode;
+	memcpy(msg, "RFIN", 4);
+
+	memcpy(s_b2Pay, snonce, 16);
+	memcpy(s_b2Pay + 16, nt.id, 16);
+	s_b2Pay[32] = (uint8_t)(MTLS_TICKET_LIFE_S & 0xFF);
+	s_b2Pay[33] = (uint8_t)(MTLS_TICKET_LIFE_S >> 8);
+	mac16(s_kMac, msg, (size_t)(w - msg), s_b2Pay + 34);
+	s_b2Pay[50] = mode;
+	s_b2Op  = 0xB7;
+	s_b2Len = 16 + 16 + 2 + 16 + (offer ? 1 : 0);
+	return( true );
+}
+
 ////////////////////////////////////////////////////////////////////
 // mtls_tryConsumeOrDecryptFromBinary()
 //
@@ -646,26 +1469,30 @@ static void make_sfin_mac(uint8_t out16[16], const std::vector<uint8_t>& cli65)
 //       * return true (frame consumed)
 //
 //   - If op == B3 (encrypted record):
+//       * check seq against the replay window (seqInFresh)
 //       * verify MAC using sessKey32 and sid/dir='C'/seq
-//       * check seq == s_seqIn (replay protection)
 //       * AES-CTR decrypt cipher → outPlain
-//       * bump s_seqIn
+//       * mark seq in the window (seqInMark)
 //       * return true (frame consumed, inner app frame in outPlain)
 //
+//   - If op == B6 (RESUME): as B1, keys from a ticket instead of ECDH
+//
 //   - For any other op: return false so the caller can handle it.
 //
 ////////////////////////////////////////////////////////////////////
-bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t n, std::vector<uint8_t>& outPlain )
+bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, uint8_t* p, uint16_t n, uint8_t*& plain, uint16_t& plainLen )
 {
 	DPRINT("[B*] entry op=0x%02X n=%u\n", (unsigned)op, (unsigned)n);
-	outPlain.clear();
+	plain    = nullptr;
+	plainLen = 0;
 
 	/////////////////////////
 	// B1: KEYX (client→server)
 	/////////////////////////
 	if (op == 0xB1) 
 	{ 
-		if( n != (65 + 16) ) 
+		// cliPub65 || mac16 [|| offer1], the record mode offer from 1.16
+		if( n != (65 + 16) && n != (65 + 16 + 1) ) 
 		{ 
 			DPRINTLN("[MTLS][B1] len bad"); 
 			return true; // consumed, but invalid
@@ -675,6 +1502,7 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 		std::vector<uint8_t> cliPub(65); 
 		memcpy(cliPub.data(), p, 65);
 		const uint8_t* macIn = p + 65;
+		const uint8_t* offer = (n > 65 + 16) ? p + 65 + 16 : nullptr;
 
 		 // Recompute MAC over "KEYX"||sid||srv_pub||cli_pub using AppKey
 		uint8_t srv65[65]; 
@@ -689,11 +1517,12 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 			(uint8_t)((s_sid >> 8) & 0xFF),
 			(uint8_t)( s_sid        & 0xFF) };
 			
-		std::vector<uint8_t> msg; msg.reserve(4+4+65+65);
+		std::vector<uint8_t> msg; msg.reserve(4+4+65+65+1);
 		msg.insert(msg.end(), {'K','E','Y','X'});
 		msg.insert(msg.end(), sid4, sid4+4);
 		msg.insert(msg.end(), srv65, srv65+65);
 		msg.insert(msg.end(), cliPub.begin(), cliPub.end());
+		if( offer ) msg.push_back(*offer);
 		uint8_t macExp[16]; mac16(getAppKey(), msg.data(), msg.size(), macExp);
 
 		// debug
@@ -729,7 +1558,11 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 		s_b0NextAtMs = 0;		
 		
 		// Build B2 MAC now, but send it slightly later
-		make_sfin_mac(s_b2Mac, cliPub);
+		const uint8_t mode = acceptRecOffer(offer);
+		make_sfin_mac(s_b2Pay, cliPub, offer ? &mode : nullptr);
+		s_b2Pay[16]  = mode;
+		s_b2Op       = 0xB2;
+		s_b2Len      = offer ? 17 : 16;
 		s_b2Pending  = true;
 		s_b2SendAtMs = millis() + 50; //450;   // <-- delay in ms (tune 80..250)
 
@@ -738,6 +1571,40 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 		return( true );
 	}
 
+	/////////////////////////
+	// B6: RESUME (client→server), instead of B1
+	/////////////////////////
+	if( op == 0xB6 )
+	{
+		if( n != 16 + 16 + 16 && n != 16 + 16 + 16 + 1 )
+		{
+			DPRINTLN("[MTLS][B6] len bad");
+			return true;
+		}
+		if( s_active || s_b2Pending )
+		{
+			DPRINTLN("[MTLS][B6] not expecting a handshake");
+			return true;
+		}
+		if( !resumeFromTicket(p, (n > 48) ? p + 48 : nullptr) )
+		{
+			DPRINTLN("[MTLS][B6] NOTICKET");
+			const char* e="NOTICKET";
+			sendFrame(0xFF,(const uint8_t*)e,strlen(e));
+			return true;
+		}
+
+		s_lastB0.clear();
+		s_b0Retries = 0;
+		s_b0NextAtMs = 0;
+
+		s_b2Pending  = true;
+		s_b2SendAtMs = millis() + 50;
+
+		DPRINTLN("[MTLS] resumed, B7 pending (delay)");
+		return( true );
+	}
+
 	//////////////////////////
 	// B3: ENC record (client→server)
 	//////////////////////////////
@@ -758,77 +1625,56 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 			return true; 
 		}
 
-		uint16_t seq  = ((uint16_t)p[0] << 8) | (uint16_t)p[1];
+		uint16_t seq2 = ((uint16_t)p[0] << 8) | (uint16_t)p[1];
 		uint16_t clen = ((uint16_t)p[2] << 8) | (uint16_t)p[3];
 		if( n != (2+2+clen+16) ) 
 		{
 			DPRINTLN("[MTLS][B3] len mismatch"); 
 			return( true ); 
 		}
-		const uint8_t* cipher = p+4;
-		const uint8_t* macIn  = p+4+clen;
-
-		// Recompute MAC = HMAC(sessKey,"ENCM"||sid||'C'||seq||cipher)[0..15]
-		std::vector<uint8_t> macData; 
-		
-		macData.reserve(4+4+1+2+clen);
-		macData.insert(macData.end(), {'E','N','C','M'});
-		macData.push_back((uint8_t)(s_sid>>24)); 
-		macData.push_back((uint8_t)(s_sid>>16));
-		macData.push_back((uint8_t)(s_sid>>8));  
-		macData.push_back((uint8_t)s_sid);
-		macData.push_back('C'); 
-		macData.push_back((uint8_t)(seq>>8)); 
-		macData.push_back((uint8_t)seq);
-		macData.insert(macData.end(), cipher, cipher+clen);
-		
-		uint8_t macExp[16]; 
-		mac16(s_kMac, macData.data(), macData.size(), macExp);
-		
-		if( !ct_eq16(macExp, macIn) )  
-		{ 
-			DPRINTLN("[MTLS][B3] BADMAC"); 
-			const char* e="BADMAC"; 
-			sendFrame(0xFF,(const uint8_t*)e,strlen(e)); 
-			return true; 
-		}
+		uint8_t* cipher = p+4;
 
-		// Replay protection: require exact next sequence
-		if( seq != s_seqIn ) 
+		// Replay protection: sliding window, a record skipped or late
+		// is still taken, one seen already or too old is not
+		uint64_t seq = 0;
+		RecKeys* keys = nullptr;
+		if( !seqInFull(seq2, seq) || !seqInFresh(seq) || !(keys = recRxKeys(seq)) ) 
 		{
-			DPRINT("[MTLS][B3] REPLAY seq=%u expect=%u\n",(unsigned)seq,(unsigned)s_seqIn); 
+			DPRINT("[MTLS][B3] REPLAY seq=%u next=%u\n",(unsigned)seq2,(unsigned)s_seqIn); 
 			const char* e="REPLAY"; 
 			sendFrame(0xFF,(const uint8_t*)e,strlen(e)); 
 			return true; 
 		}
 
-		// MAC OK & seq OK → AES-CTR decrypt to outPlain
-		outPlain.resize(clen);
-		uint8_t iv[16]; 
-		ivFrom('C', seq, iv);
-		if( !aesCtr(s_kEnc, iv, cipher, outPlain.data(), clen) )
+		// Check the MAC / tag and decrypt in place (the caller owns the
+		// frame buffer; the cipher isn't needed afterwards)
+		if( !recordOpen(*keys, 'C', seq, p, cipher, clen) )  
 		{ 
-			DPRINTLN("[MTLS][B3] AES fail"); 
-			outPlain.clear(); 
+			DPRINTLN("[MTLS][B3] BADMAC"); 
+			const char* e="BADMAC"; 
+			sendFrame(0xFF,(const uint8_t*)e,strlen(e)); 
 			return true; 
 		}
 
-		++s_seqIn;
-		if( s_seqIn == 0 ) 
+		if( seq == seqLast() ) 
 		{
 			mtls_dropSessionAndRequireHandshake("seqIn wrapped");
 			return true; // consumed; session dropped
 		}
+		seqInMark(seq);
+		if( keys == s_recRxNext ) recRxAdvance();
 
-		// At this point outPlain holds the inner app frame:
-		// [OP|LENle|PAYLOAD]. The caller (commands.cpp) will
-		// recursively feed it back into dispatch_binary_frame().
+		// At this point the cipher bytes hold the inner app frame:
+		// [OP|LENle|PAYLOAD]. dispatch_binary_frame() handles it
+		// next, in the same pass.
+		plain    = cipher;
+		plainLen = clen;
 
 		// Debug (first 64B)
 //		String hx; 
 		// reuse toHex 
-//		toHex(outPlain.data(), std::min<size_t>(outPlain.size(),64), hx);
-//		DPRINT("[MTLS][B3] dec len=%u hex[64]=%s\n", (unsigned)outPlain.size(), hx.c_str());
+//		toHex(plain, std::min<size_t>(plainLen,64), hx);
+//		DPRINT("[MTLS][B3] dec len=%u hex[64]=%s\n", (unsigned)plainLen, hx.c_str());
 
 		return( true );
 	}
@@ -837,6 +1683,45 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 	return( false ); 
 }
 
+////////////////////////////////////////////////////////////////////
+// Outbound record buffer: [B3][LENle] seq2 | clen2 | cipher | mac16.
+// The plaintext frame is written at the cipher offset and encrypted in
+// place, so a reply costs no allocation.
+////////////////////////////////////////////////////////////////////
+static uint8_t s_txRec[3 + 4 + MTLS_TX_MAX + 16];
+static const size_t TX_REC_CIPHER = 3 + 4;
+
+static bool sendRecord_B3( size_t n )
+{
+	// Prevent IV / nonce reuse on sequence wrap (force re-handshake)
+	if( s_seqOut == seqLast() ) 
+	{
+		mtls_dropSessionAndRequireHandshake("seqOut wrap imminent");
+		return false;
+	}
+
+	// B3 payload: seq2 | clen2 | cipher | mac16
+	const size_t pay = 2 + 2 + n + 16;
+	s_txRec[0] = 0xB3;
+	s_txRec[1] = (uint8_t)(pay & 0xFF);
+	s_txRec[2] = (uint8_t)(pay >> 8);
+	s_txRec[3] = (uint8_t)(s_seqOut >> 8);
+	s_txRec[4] = (uint8_t)(s_seqOut & 0xFF);
+	s_txRec[5] = (uint8_t)((n >> 8) & 0xFF);
+	s_txRec[6] = (uint8_t)( n       & 0xFF);
+
+	// encrypt + MAC / tag in place, dir='S'
+	if( !recordSeal(recTxKeys(s_seqOut), 'S', s_seqOut, s_txRec + 3, s_txRec + TX_REC_CIPHER, n) ) return( false );
+
+	// SEND TOP-LEVEL: [0xB3][LENle][payload] — bypass sendFrame to avoid re-wrap
+	extern bool sendTX(const uint8_t* data, size_t len);
+	bool ok = sendTX(s_txRec, 3 + pay);
+
+	++s_seqOut;
+	
+	return( ok );
+}
+
 ////////////////////////////////////////////////////////////////////
 // mtls_wrapAndSendBytes_B3()
 //
@@ -847,7 +1732,8 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 //
 //  This function:
 //    - builds iv16 = HMAC(sessKey,"IV"||sid||'S'||seqOut)[0..15]
-//    - AES-CTR encrypts the entire app frame to `enc`
+//    - copies the app frame into the record buffer, AES-CTR encrypts
+//      it in place
 //    - builds MAC over ENCM||sid||'S'||seqOut||cipher
 //    - constructs B3 payload: seq2 | clen2 | cipher | mac16
 //    - wraps as [0xB3][LENle][payload] and sends via sendTX()
@@ -855,63 +1741,31 @@ bool mtls_tryConsumeOrDecryptFromBinary( uint8_t op, const uint8_t* p, uint16_t
 //  note: deliberately bypass sendFrame() here to avoid wrapping
 //  a B3 frame inside another app-level frame.
 //
+//  mtls_wrapAndSendFrame_B3() is the same for sendFrame(): header and
+//  payload go straight into the record buffer.
+//
 ////////////////////////////////////////////////////////////////////
 bool mtls_wrapAndSendBytes_B3(const uint8_t* plain, size_t n)
 {
-	if (!s_active) return( false );
+	if( !s_active ) return( false );
+	if( n > MTLS_TX_MAX ) return( false );
+
+	memcpy(s_txRec + TX_REC_CIPHER, plain, n);
+	return( sendRecord_B3(n) );
+}
 
-	// Prevent CTR IV reuse on 16-bit sequence wrap (force re-handshake)
-	if( s_seqOut == 0xFFFF ) 
+bool mtls_wrapAndSendFrame_B3(const uint8_t hdr[3], const uint8_t* payload, uint16_t n)
+{
+	if( !s_active ) return( false );
+	if( 3 + (size_t)n > MTLS_TX_MAX )
 	{
-		mtls_dropSessionAndRequireHandshake("seqOut wrap imminent");
-		return false;
+		DPRINT("[MTLS][TX] frame too big: %u\n", (unsigned)n);
+		return( false );
 	}
 
-	// Encrypt with dir='S'
-	std::vector<uint8_t> enc(n);
-	uint8_t iv[16]; ivFrom('S', s_seqOut, iv);
-	if( !aesCtr(s_kEnc, iv, plain, enc.data(), n) ) return( false );
-
-	// mac over ENCM||sid||'S'||seq||cipher
-	std::vector<uint8_t> macData; 
-	macData.reserve(4+4+1+2+n);
-	macData.insert(macData.end(), {'E','N','C','M'});
-	macData.push_back((uint8_t)(s_sid>>24)); 
-	macData.push_back((uint8_t)(s_sid>>16));
-	macData.push_back((uint8_t)(s_sid>>8));  
-	macData.push_back((uint8_t)s_sid);
-	macData.push_back('S'); 
-	macData.push_back((uint8_t)(s_seqOut>>8)); 
-	macData.push_back((uint8_t)s_seqOut);
-	macData.insert(macData.end(), enc.begin(), enc.end());
-
-	uint8_t mac[16]; 
-	mac16( s_kMac, macData.data(), macData.size(), mac );
-
-	// Build B3 payload: seq2 | clen2 | cipher | mac16
-	std::vector<uint8_t> pay; 
-	pay.reserve(2 + 2 + n + 16);
-	pay.push_back((uint8_t)(s_seqOut >> 8));
-	pay.push_back((uint8_t)(s_seqOut & 0xFF));
-	pay.push_back((uint8_t)((n >> 8) & 0xFF));
-	pay.push_back((uint8_t)( n       & 0xFF));
-	pay.insert(pay.end(), enc.begin(), enc.end());
-	pay.insert(pay.end(), mac, mac + 16);
-
-	// SEND TOP-LEVEL: [0xB3][LENle][payload] — bypass sendFrame to avoid re-wrap
-	std::vector<uint8_t> out; 
-	out.reserve(1 + 2 + pay.size());
-	out.push_back(0xB3);
-	out.push_back((uint8_t)(pay.size() & 0xFF));
-	out.push_back((uint8_t)(pay.size() >> 8));
-	out.insert(out.end(), pay.begin(), pay.end());
-
-	extern bool sendTX(const uint8_t* data, size_t len);
-	bool ok = sendTX(out.data(), (uint16_t)out.size());
-
-	++s_seqOut;
-	
-	return( ok );
+	memcpy(s_txRec + TX_REC_CIPHER, hdr, 3);
+	if( n ) memcpy(s_txRec + TX_REC_CIPHER + 3, payload, n);
+	return( sendRecord_B3(3 + (size_t)n) );
 }
 
 ////////////////////////////////////////////////////////////////////
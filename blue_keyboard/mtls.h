@@ -29,6 +29,11 @@
 //                   "SFIN"||sid||srvPub65||cliPub65)[0..15]
 //       (session becomes active)
 //
+//  Resumption (PROTO 1.15+): a client holding a ticket from an earlier
+//  session answers B0 with B6 RESUME instead of B1 and gets B7 RESUMED
+//  instead of B2; the session key then comes from the ticket secret
+//  and two fresh nonces via HKDF, no ECDH. Details in mtls.cpp.
+//
 //  Encrypted record format (B3):
 //       seq2 || clen2 || cipher[clen] || mac16
 //
@@ -38,6 +43,23 @@
 //                     "ENCM"||sid||dir||seq||cipher)[0..15]
 //    dir       = 'C' (client→dongle) or 'S' (dongle→client)
 //
+//  Record mode (PROTO 1.16+): a client may offer AES-256-GCM with one
+//  extra byte at the end of B1 (or B6); the dongle answers with the
+//  mode it picked at the end of B2 (B7). Same B3 layout, the mac16 is
+//  then the GCM tag and there is no HMAC at all. Without the byte the
+//  session stays on CTR + HMAC above (older apps). Details in mtls.cpp.
+//
+//  Sequence numbers (PROTO 1.17+): MTLS_REC_SEQ32 in the offer byte
+//  makes them 32-bit; still seq2 on the wire, the receiver rebuilds the
+//  rest. Either way inbound records pass a 64-record replay window
+//  instead of an exact-next check, so a record lost on the way no
+//  longer ends the session.
+//
+//  Key update (PROTO 1.18+): with MTLS_REC_REKEY also granted, each
+//  direction moves to keys ratcheted from the last ones (HMAC, no
+//  ECDH) every MTLS_REKEY_RECORDS records, so a session never runs out
+//  of sequence numbers and is not dropped for it.
+//
 //  Once MTLS is active:
 //    • All outbound application frames MUST be wrapped using B3
 //    • All inbound B3 records must be passed through the decrypt
@@ -46,9 +68,12 @@
 //  The caller drives the top-level pipe:
 //
 //     - On connect: call mtls_sendHello_B0()
+//       (from the protocol task, like everything here: B0 and the
+//       session wipe free and re-initialise the record contexts B3
+//       works with)
 //     - On notifications from the app: call mtls_tryConsumeOrDecryptFromBinary()
 //     - When sending application frames: call mtls_wrapAndSendBytes_B3()
-//     - In loop(): call mtls_tick() (in .cpp) for timeout/retry
+//     - In the protocol task: call mtls_tick() (in .cpp) for timeout/retry
 //
 ////////////////////////////////////////////////////////////////////
 #pragma once
@@ -56,6 +81,59 @@
 #include <string>
 #include <vector>
 
+// largest plaintext app frame ([OP][LENle][PAYLOAD]) sent as one B3
+#ifndef MTLS_TX_MAX
+#define MTLS_TX_MAX 4096
+#endif
+
+// session resumption tickets (B4..B7): how many the dongle keeps and
+// how long one is good for (seconds, sent as u16)
+#ifndef MTLS_TICKET_SLOTS
+#define MTLS_TICKET_SLOTS 4
+#endif
+#ifndef MTLS_TICKET_LIFE_S
+#define MTLS_TICKET_LIFE_S 1800
+#endif
+
+// record modes (B1/B2 and B6/B7 trailer byte, PROTO 1.16+)
+#define MTLS_REC_CTR   0      // AES-CTR + HMAC-SHA256 (the original)
+#define MTLS_REC_GCM   1      // AES-256-GCM
+#define MTLS_REC_MODES 2
+#define MTLS_REC_MODE_MASK 0x3F
+#define MTLS_REC_SEQ32 0x80   // flag: 32-bit sequence numbers (PROTO 1.17+)
+#define MTLS_REC_REKEY 0x40   // flag: key update per epoch (PROTO 1.18+)
+
+// records per key epoch with MTLS_REC_REKEY - part of the protocol,
+// both sides must agree on it
+#define MTLS_REKEY_RECORDS 65536
+
+// accept GCM when a client offers it (0 = always answer CTR)
+#ifndef MTLS_REC_GCM_ENABLE
+#define MTLS_REC_GCM_ENABLE 1
+#endif
+
+// grant 32-bit sequence numbers when a client asks (0 = always 16-bit)
+#ifndef MTLS_REC_SEQ32_ENABLE
+#define MTLS_REC_SEQ32_ENABLE 1
+#endif
+
+// grant key updates when a client asks (0 = never, the session is
+// dropped when its sequence numbers run out)
+#ifndef MTLS_REC_REKEY_ENABLE
+#define MTLS_REC_REKEY_ENABLE 1
+#endif
+
+// ephemeral keypairs kept ready for B0 (see mtls_keypool_begin())
+#ifndef MTLS_KEYPOOL_SIZE
+#define MTLS_KEYPOOL_SIZE 2
+#endif
+#ifndef MTLS_KEYPOOL_PRIO
+#define MTLS_KEYPOOL_PRIO 1
+#endif
+#ifndef MTLS_KEYPOOL_CORE
+#define MTLS_KEYPOOL_CORE 1
+#endif
+
 
 // -----------------------------------------------------------------
 // Session state helpers
@@ -70,7 +148,8 @@ bool mtls_isActive();
 //   - zeroes session key
 //   - resets inbound/outbound sequence counters
 //   - clears sid
-// Call this on disconnect or before sending a new B0.
+// Call this on disconnect or before sending a new B0, from the
+// protocol task (it frees and re-initialises the record contexts).
 void mtls_reset();
 
 
@@ -83,7 +162,8 @@ void mtls_reset();
 // The function:
 //   - checks that AppKey exists in NVS
 //   - generates a fresh session id (sid)
-//   - generates a fresh ephemeral P-256 keypair
+//   - takes a pre-generated ephemeral P-256 keypair from the pool
+//     (generates one right away if the pool is empty)
 //   - caches B0 for retransmission (handled inside mtls.cpp)
 //   - sends the frame using sendFrame()
 //
@@ -101,18 +181,25 @@ bool mtls_sendHello_B0();
 //   B1  → KEYX: verify MAC(AppKey), run ECDH, derive sessKey32,
 //               send B2 (SFIN), mark session active.
 //
+//   B6  → RESUME: look up the ticket, verify its MAC, derive sessKey32
+//               from it, send B7 (RESUMED + next ticket), mark session
+//               active. FF "NOTICKET" if it can't be used.
+//
 //   B3  → encrypted record: verify MAC(sessKey), check sequence,
-//               AES-CTR decrypt cipher → outPlain, increment seqIn.
-//               outPlain contains the inner application frame
-//               (OP|LEN|payload). Caller will re-dispatch it.
+//               AES-CTR decrypt the cipher in place, increment seqIn.
+//               plain/plainLen then point at the inner application
+//               frame(s) (OP|LEN|payload, PROTO 1.10+ may batch several
+//               back to back) inside p. Caller dispatches them.
 //
+// plainLen is 0 when there is no inner frame (B1, or a rejected B3).
 // Any non-MTLS opcode returns false so the caller can process it.
 //
 // Returns true if the frame was handled (whether successful or not).
 bool mtls_tryConsumeOrDecryptFromBinary(uint8_t op,
-                                        const uint8_t* p,
+                                        uint8_t* p,
                                         uint16_t n,
-                                        std::vector<uint8_t>& outPlain);
+                                        uint8_t*& plain,
+                                        uint16_t& plainLen);
 
 
 // -----------------------------------------------------------------
@@ -137,3 +224,70 @@ bool mtls_tryConsumeOrDecryptFromBinary(uint8_t op,
 // Returns false if called before handshake completes.
 bool mtls_wrapAndSendBytes_B3(const uint8_t* plain, size_t n);
 
+// Same, with the app frame given as header + payload (sendFrame()).
+// The record is built in a static buffer, so nothing is allocated;
+// frames longer than MTLS_TX_MAX are refused.
+bool mtls_wrapAndSendFrame_B3(const uint8_t hdr[3], const uint8_t* payload, uint16_t n);
+
+
+// -----------------------------------------------------------------
+// Session resumption (PROTO 1.15+)
+// -----------------------------------------------------------------
+
+// Issues a resumption ticket for the active session (B4 -> B5):
+//     out = id16 || lifetime in seconds (u16 LE)
+// The client derives the ticket secret from its session key itself.
+// Returns false without an active session.
+bool mtls_issueTicket(uint8_t out[18]);
+
+// Drops every ticket (AppKey reset).
+void mtls_forgetTickets();
+
+// -----------------------------------------------------------------
+// Ephemeral keypair pool
+// -----------------------------------------------------------------
+
+// Starts the low priority task that keeps MTLS_KEYPOOL_SIZE ephemeral
+// keypairs ready, so mtls_sendHello_B0() doesn't have to run the
+// P-256 keygen when a client subscribes. Call once from setup().
+// Returns false if the task could not be created (B0 then generates
+// its keypair inline, as before).
+bool mtls_keypool_begin();
+
+// B0 preparation time: from mtls_sendHello_B0() entry to the B0
+// payload being cached, ready for mtls_tick() to send.
+struct MtlsHelloStats
+{
+	uint32_t hellos;      // B0s prepared
+	uint32_t poolHits;    // ... with a keypair from the pool
+	uint32_t lastUs;
+	uint32_t maxUs;
+};
+
+void mtls_getHelloStats(MtlsHelloStats& out);
+
+// -----------------------------------------------------------------
+// Record mode / record crypto stats (PROTO 1.16+)
+// -----------------------------------------------------------------
+
+// Mode of the active session (MTLS_REC_*)
+uint8_t mtls_recMode();
+
+// Sequence number width of the active session: 16, 32 (PROTO 1.17+)
+// or 64 (key updates, PROTO 1.18+)
+uint8_t mtls_recSeqBits();
+
+// Key updates done in the active session, both directions
+uint32_t mtls_keyUpdates();
+
+// B3 records sent + received per mode: crypto time (encrypt + MAC, or
+// verify + decrypt) and bytes on air (whole B3 frames).
+struct MtlsRecStats
+{
+	uint32_t records;
+	uint32_t cryptoUs;
+	uint32_t airBytes;
+};
+
+void mtls_getRecStats(MtlsRecStats out[MTLS_REC_MODES]);
+void mtls_clearRecStats();
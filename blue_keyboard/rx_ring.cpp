@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////////////
+// rx_ring.cpp - SPSC ring of received BLE frames
+//
+// See rx_ring.h. head/tail are free-running byte indexes, the offset
+// is (index & mask). Records are 4-byte aligned so a wrap marker
+// (2 bytes) always fits in front of the end of the buffer.
+//
+// Record: [len u16][link u16][rx time us u32][frame bytes][pad to 4]
+////////////////////////////////////////////////////////////////////
+#include "rx_ring.h"
+#include <atomic>
+
+#define RX_RING_WRAP 0xFFFF
+#define RX_REC_HDR   8
+
+static_assert( (RX_RING_BYTES & (RX_RING_BYTES - 1)) == 0, "RX_RING_BYTES must be a power of 2" );
+static_assert( RX_RING_BYTES >= 2 * (RX_FRAME_MAX + RX_REC_HDR + 4), "RX_RING_BYTES too small for RX_FRAME_MAX" );
+static_assert( RX_FRAME_MAX < RX_RING_WRAP, "RX_FRAME_MAX too big" );
+static_assert( RX_REC_HDR + 3 <= RX_CREDIT_OVERHEAD, "RX_CREDIT_OVERHEAD below the record overhead" );
+
+static uint8_t               s_buf[RX_RING_BYTES] __attribute__((aligned(4)));
+static std::atomic<uint32_t> s_head{0};       // written by producer
+static std::atomic<uint32_t> s_tail{0};       // written by consumer
+static std::atomic<uint32_t> s_popped{0};     // frames popped, written by consumer
+static std::atomic<uint32_t> s_dropCredit{0}; // credit of dropped frames, written by producer
+static uint32_t              s_popCredit = 0; // credit of popped frames, consumer only
+static std::atomic<uint16_t> s_link{0};       // link generation, written by producer
+
+// producer only
+static uint32_t     s_pushed  = 0;
+static RxRingStats  s_stats   = {};
+static uint32_t     s_resHead = 0;    // head once the reserved record is committed
+static uint32_t     s_resUsed = 0;    // ring bytes in use then
+static uint32_t     s_resLen  = 0;    // frame length reserved
+
+static inline uint32_t rx_recSize( size_t len )
+{
+	return( (uint32_t)((RX_REC_HDR + len + 3) & ~(size_t)3) );
+}
+
+uint8_t* rx_ring_reserve( size_t len )
+{
+	if( len == 0 || len > RX_FRAME_MAX ) return( nullptr );
+
+	const uint32_t need = rx_recSize(len);
+	uint32_t head = s_head.load(std::memory_order_relaxed);
+	const uint32_t tail = s_tail.load(std::memory_order_acquire);
+
+	uint32_t off = head & (RX_RING_BYTES - 1);
+	const uint32_t toEnd = RX_RING_BYTES - off;
+	const uint32_t pad = (toEnd < need) ? toEnd : 0;
+
+	const uint32_t used = head - tail;
+	if( used + pad + need > RX_RING_BYTES )
+	{
+		s_stats.drops++;
+		s_dropCredit.fetch_add( (uint32_t)len + RX_CREDIT_OVERHEAD, std::memory_order_relaxed );
+		return( nullptr );
+	}
+
+	// doesn't fit before the end: skip the rest, start over at 0
+	// (the consumer can't see the marker before the commit)
+	if( pad )
+	{
+		const uint16_t w = RX_RING_WRAP;
+		memcpy(&s_buf[off], &w, 2);
+		head += pad;
+		off = 0;
+	}
+
+	const uint16_t l16  = (uint16_t)len;
+	const uint16_t link = s_link.load(std::memory_order_relaxed);
+	const uint32_t t    = micros();
+	memcpy(&s_buf[off], &l16, 2);
+	memcpy(&s_buf[off + 2], &link, 2);
+	memcpy(&s_buf[off + 4], &t, 4);
+
+	s_resHead = head + need;
+	s_resUsed = used + pad + need;
+	s_resLen  = (uint32_t)len;
+	return( &s_buf[off + RX_REC_HDR] );
+}
+
+void rx_ring_commit()
+{
+	s_head.store( s_resHead, std::memory_order_release );
+
+	// counters
+	s_pushed++;
+	s_stats.frames++;
+	const uint32_t waiting = s_pushed - s_popped.load(std::memory_order_relaxed);
+	if( waiting > s_stats.hwFrames ) s_stats.hwFrames = (uint16_t)waiting;
+	if( s_resUsed > s_stats.hwBytes ) s_stats.hwBytes = s_resUsed;
+}
+
+void rx_ring_cancel()
+{
+	s_dropCredit.fetch_add( s_resLen + RX_CREDIT_OVERHEAD, std::memory_order_relaxed );
+}
+
+bool rx_ring_push( const uint8_t* frame, size_t len )
+{
+	uint8_t* dst = rx_ring_reserve(len);
+	if( !dst ) return( false );
+
+	memcpy(dst, frame, len);
+	rx_ring_commit();
+	return( true );
+}
+
+void rx_ring_dropLink()
+{
+	s_link.fetch_add( 1, std::memory_order_relaxed );
+}
+
+uint16_t rx_ring_link()
+{
+	return( s_link.load(std::memory_order_relaxed) );
+}
+
+uint8_t* rx_ring_peek( size_t& len, uint32_t* rxUs, uint16_t* link )
+{
+	for( ;; )
+	{
+		const uint32_t tail = s_tail.load(std::memory_order_relaxed);
+		if( tail == s_head.load(std::memory_order_acquire) ) return( nullptr );
+
+		const uint32_t off = tail & (RX_RING_BYTES - 1);
+		uint16_t l16;
+		memcpy(&l16, &s_buf[off], 2);
+
+		if( l16 == RX_RING_WRAP )
+		{
+			s_tail.store( tail + (RX_RING_BYTES - off), std::memory_order_release );
+			continue;
+		}
+
+		len = l16;
+		if( link ) memcpy(link, &s_buf[off + 2], 2);
+		if( rxUs ) memcpy(rxUs, &s_buf[off + 4], 4);
+		return( &s_buf[off + RX_REC_HDR] );
+	}
+}
+
+void rx_ring_pop()
+{
+	size_t len = 0;
+	if( !rx_ring_peek(len) ) return;
+
+	const uint32_t tail = s_tail.load(std::memory_order_relaxed);
+	s_tail.store( tail + rx_recSize(len), std::memory_order_release );
+	s_popped.fetch_add( 1, std::memory_order_relaxed );
+	s_popCredit += (uint32_t)len + RX_CREDIT_OVERHEAD;
+}
+
+void rx_ring_getStats( RxRingStats& out )
+{
+	out = s_stats;
+}
+
+uint32_t rx_ring_creditFreed()
+{
+	return( s_popCredit + s_dropCredit.load(std::memory_order_relaxed) );
+}
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////
+//  RX frame ring — BLE writes queued for the protocol task
+//
+//  handleWrite() (NimBLE host task) validates a frame and pushes it,
+//  the protocol task pops and dispatches. Used to be a single slot, so a second
+//  write while the first was still waiting got "busy" and was lost
+//  (bursts of E0 fast-key taps, back-to-back commands).
+//
+//  Byte ring with a small header per frame:
+//    [len u16][link u16][rx time us u32][frame bytes][pad to 4]
+//  The time is when the frame's first byte came in (write -> HID
+//  latency, see hid_emitter_stamp()). link is the connection it came
+//  in on: rx_ring_dropLink() moves the generation on when the link
+//  drops, and the consumer discards what is left of the old one
+//  (its B3s would only earn the next client REPLAY/BADMAC errors, and
+//  their credit must be back before that client's CA).
+//  A frame never wraps - if it doesn't fit before the end, the rest of
+//  the buffer is skipped (len = RX_RING_WRAP) and it goes at offset 0.
+//  So the consumer can dispatch straight from the ring, no copy (B3 records
+//  are even decrypted in place); the slot is only released with
+//  rx_ring_pop() once nothing refers to it any more.
+//
+//  Producer is handleWrite() only, consumer is the protocol task only. No locks,
+//  just the two free-running byte indexes (same scheme as hid_emitter).
+//
+//  A frame bigger than one write is reassembled in place: handleWrite()
+//  reserves its record and fills it write by write (rx_ring_reserve /
+//  rx_ring_commit), so the only buffering is the ring itself.
+//
+//  When full the frame is dropped (caller answers "busy") and counted.
+//  A client using credit flow control (CA/CB, commands.h) never gets
+//  there: it keeps at most RX_CREDIT_WINDOW bytes in flight.
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <Arduino.h>
+
+// ring size in bytes, must be a power of 2 and hold two max frames
+#ifndef RX_RING_BYTES
+#define RX_RING_BYTES 16384
+#endif
+
+// largest frame accepted, [OP][LENle][PAYLOAD]
+#ifndef RX_FRAME_MAX
+#define RX_FRAME_MAX 4096
+#endif
+
+// a frame split over several writes is dropped when the next piece
+// doesn't come within this time (ms)
+#ifndef RX_ASM_TIMEOUT_MS
+#define RX_ASM_TIMEOUT_MS 1000
+#endif
+
+// frames the protocol task dispatches per pass before mtls_tick() etc.
+#ifndef RX_DISPATCH_PER_LOOP
+#define RX_DISPATCH_PER_LOOP 8
+#endif
+
+// Credit flow control: a frame in flight costs its length plus
+// RX_CREDIT_OVERHEAD (record header + padding). The window leaves room
+// for the end of the buffer skipped in front of a record that doesn't
+// fit there, so a client within it never finds the ring full.
+#define RX_CREDIT_OVERHEAD 12
+#define RX_CREDIT_WINDOW   (RX_RING_BYTES - RX_FRAME_MAX - RX_CREDIT_OVERHEAD)
+
+struct RxRingStats
+{
+	uint32_t frames;      // frames queued so far
+	uint32_t drops;       // frames dropped, ring full
+	uint16_t hwFrames;    // most frames waiting at once
+	uint32_t hwBytes;     // most ring bytes in use at once
+};
+
+// Producer (handleWrite only). False if the frame doesn't fit (dropped).
+bool rx_ring_push(const uint8_t* frame, size_t len);
+
+// Producer, for a frame that arrives in pieces (several BLE writes):
+// reserve room for len bytes, fill it as the pieces come in, then
+// commit. Nothing is visible to the consumer before the commit; a
+// reservation that is never committed just goes away with the next one.
+// nullptr if it doesn't fit (counted as a drop).
+uint8_t* rx_ring_reserve(size_t len);
+void rx_ring_commit();
+
+// Producer: the reserved frame will never be completed (sender gave up
+// on it); only gives its credit back, the room is reused anyway.
+void rx_ring_cancel();
+
+// Producer: the link dropped, frames queued so far belong to an old one
+void rx_ring_dropLink();
+
+// Consumer (protocol task only). Oldest frame or nullptr; stays valid
+// (and writable) until rx_ring_pop(). rxUs: micros() it came in at,
+// link: generation it came in with (compare with rx_ring_link()).
+uint8_t* rx_ring_peek(size_t& len, uint32_t* rxUs = nullptr, uint16_t* link = nullptr);
+void rx_ring_pop();
+
+// Current link generation (any task)
+uint16_t rx_ring_link();
+
+void rx_ring_getStats(RxRingStats& out);
+
+// Credit given back so far: cost of the frames popped, dropped or
+// cancelled. Free running (wraps), read by the consumer.
+uint32_t rx_ring_creditFreed();
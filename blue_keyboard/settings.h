@@ -37,9 +37,28 @@
 
 
 // Protocol / firmware identifiers 
-#define PROTO_VER "1.6"
+#define PROTO_VER "1.18"
 #define FW_VER    "2.1.0"
 
+// -----------------------------------------------------------------------------
+// Protocol task: RX frames, MTLS, commands, HID translation. Kept off
+// the NimBLE host core (0) and above loop() (UI, prio 1), so TFT drawing
+// and LED blinks don't delay typing. The HID emitter is in hid_emitter.h.
+// -----------------------------------------------------------------------------
+#ifndef PROTO_TASK_CORE
+#define PROTO_TASK_CORE  1
+#endif
+#ifndef PROTO_TASK_PRIO
+#define PROTO_TASK_PRIO  3
+#endif
+#ifndef PROTO_TASK_STACK
+#define PROTO_TASK_STACK 8192
+#endif
+// sleep when idle, woken early by handleWrite(); mtls_tick() runs at least this often
+#ifndef PROTO_IDLE_MS
+#define PROTO_IDLE_MS    10
+#endif
+
 /////////////////////////////
 // *** DEBUG ***
 #define DEBUG_ENABLED 1
@@ -105,7 +124,7 @@ static const char* const NVS_KEY_APPKEY_SET = "app_key_set"; // 0/1
 ////////////////////////////////////////////////////////////////////
 // Keyboard layout (stored as uint8_t enum in NVS)
 ////////////////////////////////////////////////////////////////////
-static void loadLayoutFromNVS()
+[[maybe_unused]] static void loadLayoutFromNVS()
 {
     ensurePrefsOpenRW();
     uint8_t raw = gPrefs.getUChar(
@@ -130,7 +149,7 @@ static void saveLayoutToNVS(KeyboardLayout id)
 // true  = pairing window open (any central can pair)
 // false = locked to already-bonded centrals only
 ////////////////////////////////////////////////////////////////////
-static bool getAllowPairing()
+[[maybe_unused]] static bool getAllowPairing()
 {
     return( g_allowPairing );
 }
@@ -142,14 +161,14 @@ static void savePairingFlagToNVS(bool allow)
     g_allowPairing = allow;
 }
 
-static void loadPairingFlagFromNVS()
+[[maybe_unused]] static void loadPairingFlagFromNVS()
 {
     ensurePrefsOpenRW();
     uint8_t v = gPrefs.getUChar(NVS_KEY_ALLOWPAIR, 1);
     g_allowPairing = (v != 0);
 }
 
-static void setAllowPairing(bool allow)
+[[maybe_unused]] static void setAllowPairing(bool allow)
 {
     savePairingFlagToNVS(allow);
 }
@@ -196,12 +215,12 @@ static void loadAllowMultiDeviceFromNVS()
     g_allowMultiDev = (v != 0);
 }
 
-static void setAllowMultiAppProvisioning(bool allow)
+[[maybe_unused]] static void setAllowMultiAppProvisioning(bool allow)
 {
     saveAllowMultiAppToNVS(allow);
 }
 
-static void setAllowMultiDevicePairing(bool allow)
+[[maybe_unused]] static void setAllowMultiDevicePairing(bool allow)
 {
     saveAllowMultiDeviceToNVS(allow);
 }
@@ -230,9 +249,9 @@ static void loadOrGenAppKeyForMTLS()
     gPrefs.putBytes( NVS_KEY_APPKEY, g_appKey, 32 );
 }
 
-static const uint8_t* getAppKey() { return g_appKey; }
+[[maybe_unused]] static const uint8_t* getAppKey() { return g_appKey; }
 static bool isAppKeyMarkedSet()   { return g_appKeySet; }
-static void markAppKeySet()       
+[[maybe_unused]] static void markAppKeySet()       
 {
 	ensurePrefsOpenRW(); 
 	gPrefs.putUChar(NVS_KEY_APPKEY_SET, 1); 
@@ -376,7 +395,7 @@ static inline void clearBlePasskey()
 // - Loads or generates MTLS AppKey.
 // Call once from setup().
 ////////////////////////////////////////////////////////////////////
-static void initSettings()
+[[maybe_unused]] static void initSettings()
 {
     ensurePrefsOpenRW();
 	(void)loadOrGenBlePasskey();
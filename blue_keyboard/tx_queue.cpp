@@ -0,0 +1,144 @@
+////////////////////////////////////////////////////////////////////
+// tx_queue.cpp - ring of notification chunks waiting for the controller
+//
+// See tx_queue.h. head/tail are free-running byte indexes, the offset
+// is (index & mask). Records are 4-byte aligned so a wrap marker
+// (2 bytes) always fits in front of the end of the buffer.
+//
+// Record: [len u16][link u16][chunk bytes][pad to 4]
+////////////////////////////////////////////////////////////////////
+#include "tx_queue.h"
+#include <atomic>
+
+#define TX_QUEUE_WRAP 0xFFFF
+#define TX_REC_HDR    4
+
+static_assert( (TX_QUEUE_BYTES & (TX_QUEUE_BYTES - 1)) == 0, "TX_QUEUE_BYTES must be a power of 2" );
+static_assert( TX_QUEUE_BYTES >= 2 * (TX_FRAME_MAX + TX_REC_HDR + 4), "TX_QUEUE_BYTES too small for TX_FRAME_MAX" );
+
+static uint8_t               s_buf[TX_QUEUE_BYTES] __attribute__((aligned(4)));
+static uint32_t              s_head   = 0;
+static uint32_t              s_tail   = 0;
+static uint16_t              s_chunks = 0;    // chunks waiting
+static std::atomic<uint16_t> s_link{0};       // bumped by tx_queue_dropLink()
+static TxQueueStats          s_stats  = {};
+
+static inline uint32_t tx_recSize( size_t len )
+{
+	return( (uint32_t)((TX_REC_HDR + len + 3) & ~(size_t)3) );
+}
+
+// room a record of len bytes takes at head, wrap padding included
+static inline uint32_t tx_recRoom( uint32_t head, size_t len )
+{
+	const uint32_t need  = tx_recSize(len);
+	const uint32_t toEnd = TX_QUEUE_BYTES - (head & (TX_QUEUE_BYTES - 1));
+	return( (toEnd < need) ? toEnd + need : need );
+}
+
+bool tx_queue_push( const uint8_t* frame, size_t len, uint16_t chunkMax )
+{
+	if( len == 0 || len > TX_FRAME_MAX || chunkMax == 0 ) return( false );
+
+	// all chunks or none
+	uint32_t head = s_head;
+	for( size_t off = 0; off < len; off += chunkMax )
+	{
+		const size_t n = (len - off < chunkMax) ? (len - off) : chunkMax;
+		head += tx_recRoom(head, n);
+	}
+	if( head - s_tail > TX_QUEUE_BYTES )
+	{
+		s_stats.drops++;
+		return( false );
+	}
+
+	const uint16_t link = s_link.load(std::memory_order_relaxed);
+	for( size_t off = 0; off < len; off += chunkMax )
+	{
+		const size_t n = (len - off < chunkMax) ? (len - off) : chunkMax;
+		uint32_t o = s_head & (TX_QUEUE_BYTES - 1);
+
+		// doesn't fit before the end: skip the rest, start over at 0
+		if( TX_QUEUE_BYTES - o < tx_recSize(n) )
+		{
+			const uint16_t w = TX_QUEUE_WRAP;
+			memcpy(&s_buf[o], &w, 2);
+			s_head += TX_QUEUE_BYTES - o;
+			o = 0;
+		}
+
+		const uint16_t l16 = (uint16_t)n;
+		memcpy(&s_buf[o], &l16, 2);
+		memcpy(&s_buf[o + 2], &link, 2);
+		memcpy(&s_buf[o + TX_REC_HDR], frame + off, n);
+		s_head += tx_recSize(n);
+		s_chunks++;
+	}
+
+	// counters
+	s_stats.frames++;
+	if( s_chunks > s_stats.hwChunks ) s_stats.hwChunks = s_chunks;
+	if( s_head - s_tail > s_stats.hwBytes ) s_stats.hwBytes = s_head - s_tail;
+	return( true );
+}
+
+const uint8_t* tx_queue_peek( size_t& len )
+{
+	const uint16_t link = s_link.load(std::memory_order_relaxed);
+
+	while( s_tail != s_head )
+	{
+		const uint32_t o = s_tail & (TX_QUEUE_BYTES - 1);
+		uint16_t l16, l;
+		memcpy(&l16, &s_buf[o], 2);
+
+		if( l16 == TX_QUEUE_WRAP )
+		{
+			s_tail += TX_QUEUE_BYTES - o;
+			continue;
+		}
+
+		memcpy(&l, &s_buf[o + 2], 2);
+		if( l != link )
+		{
+			s_tail += tx_recSize(l16);
+			s_chunks--;
+			s_stats.stale++;
+			continue;
+		}
+
+		len = l16;
+		return( &s_buf[o + TX_REC_HDR] );
+	}
+	return( nullptr );
+}
+
+void tx_queue_pop()
+{
+	size_t len = 0;
+	if( !tx_queue_peek(len) ) return;
+
+	s_tail += tx_recSize(len);
+	s_chunks--;
+}
+
+void tx_queue_busy()
+{
+	s_stats.busy++;
+}
+
+uint16_t tx_queue_depth()
+{
+	return( s_chunks );
+}
+
+void tx_queue_dropLink()
+{
+	s_link.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void tx_queue_getStats( TxQueueStats& out )
+{
+	out = s_stats;
+}
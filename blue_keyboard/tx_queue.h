@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////
+//  TX queue — notifications waiting for the controller
+//
+//  sendTX() used to notify() each (MTU-3) chunk right away and, when
+//  the controller had no buffer (mbufs) left, retry up to three times
+//  with delay(2..6 ms) before giving up on the whole frame. That blocked
+//  dispatch for the length of a large reply and still lost frames on a
+//  busy link.
+//
+//  Now sendTX() splits a frame into chunks and queues them here, then
+//  drains as many as the controller takes. What is left goes out once
+//  notifications complete: the TX characteristic's onStatus() wakes
+//  the protocol task, which drains again (protoPass()). So a large
+//  reply streams at link speed and the caller never waits.
+//
+//  Byte ring with a small header per chunk:
+//    [len u16][link u16][chunk bytes][pad to 4]
+//  A chunk never wraps - if it doesn't fit before the end, the rest of
+//  the buffer is skipped (len = TX_QUEUE_WRAP) and it goes at offset 0,
+//  so it can be handed to notify() straight from the ring.
+//
+//  Producer and consumer are both the protocol task (sendTX() and the
+//  drain), so no locks. Only tx_queue_dropLink() comes from the NimBLE
+//  host task: it moves the link generation on, and chunks queued for an
+//  older link are dropped instead of sent, so a new connection never
+//  gets the tail of a frame meant for the last one.
+//
+//  A frame goes in whole or not at all (a partial one would break the
+//  client's framing); when it doesn't fit it is dropped and counted.
+////////////////////////////////////////////////////////////////////
+#pragma once
+#include <Arduino.h>
+
+// ring size in bytes, must be a power of 2 and hold two max frames
+#ifndef TX_QUEUE_BYTES
+#define TX_QUEUE_BYTES 16384
+#endif
+
+// largest frame queued, [OP][LENle][PAYLOAD]
+#ifndef TX_FRAME_MAX
+#define TX_FRAME_MAX 4096
+#endif
+
+struct TxQueueStats
+{
+	uint32_t frames;      // frames queued so far
+	uint32_t drops;       // frames dropped, queue full
+	uint32_t stale;       // chunks dropped, link went away first
+	uint32_t busy;        // notify() refused (no controller buffer), retried later
+	uint16_t hwChunks;    // most chunks waiting at once
+	uint32_t hwBytes;     // most queue bytes in use at once
+};
+
+// Queue a frame as chunks of at most chunkMax bytes for the current
+// link. False if it doesn't fit (dropped, nothing queued).
+bool tx_queue_push(const uint8_t* frame, size_t len, uint16_t chunkMax);
+
+// Oldest chunk of the current link or nullptr; chunks of an older link
+// are dropped on the way. Stays valid until tx_queue_pop().
+const uint8_t* tx_queue_peek(size_t& len);
+void tx_queue_pop();
+
+// notify() didn't take the chunk at the front, counted in busy
+void tx_queue_busy();
+
+// chunks waiting
+uint16_t tx_queue_depth();
+
+// Link dropped: whatever is still queued is stale (any task)
+void tx_queue_dropLink();
+
+void tx_queue_getStats(TxQueueStats& out);